@@ -0,0 +1,193 @@
+#ifndef HOLEYC_ARENA_HPP
+#define HOLEYC_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace holeyc{
+
+/**
+* A bump allocator that owns the tokens and AST nodes of a single
+* compilation. Objects are carved out of large chunks and are all
+* destroyed together when the arena is released, instead of being
+* new'd (and leaked) one at a time.
+**/
+class Arena{
+public:
+	Arena() : myChunks(nullptr), myCur(nullptr), myEnd(nullptr),
+	  myCleanups(nullptr){}
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+	~Arena(){ release(); }
+
+	/**
+	* Construct a T inside the arena. If T needs its destructor
+	* run (e.g. it holds a std::string) the arena remembers to
+	* do so on release.
+	**/
+	template <typename T, typename... Args>
+	T * make(Args&&... args){
+		void * mem = allocate(sizeof(T), alignof(T));
+		T * obj = new (mem) T(std::forward<Args>(args)...);
+		if (!std::is_trivially_destructible<T>::value){
+			void * cMem = allocate(sizeof(Cleanup), alignof(Cleanup));
+			Cleanup * cleanup = new (cMem) Cleanup;
+			cleanup->destroy = &destroy<T>;
+			cleanup->obj = obj;
+			cleanup->next = myCleanups;
+			myCleanups = cleanup;
+		}
+		return obj;
+	}
+
+	void * allocate(size_t size, size_t align){
+		size_t pad = padding(myCur, align);
+		if (myCur == nullptr
+		  || static_cast<size_t>(myEnd - myCur) < pad + size){
+			grow(size + align);
+			pad = padding(myCur, align);
+		}
+		char * res = myCur + pad;
+		myCur = res + size;
+		return res;
+	}
+
+	/**
+	* Take ownership of everything in other, leaving it empty. Lets
+	* work done in a private arena (e.g. on another thread) outlive it.
+	**/
+	void adopt(Arena& other){
+		if (other.myChunks != nullptr){
+			Chunk * tail = other.myChunks;
+			while (tail->next != nullptr){ tail = tail->next; }
+			if (myChunks == nullptr){
+				myChunks = other.myChunks;
+				myCur = other.myCur;
+				myEnd = other.myEnd;
+			} else {
+				//Keep our current chunk at the head
+				tail->next = myChunks->next;
+				myChunks->next = other.myChunks;
+			}
+		}
+		if (other.myCleanups != nullptr){
+			Cleanup * tail = other.myCleanups;
+			while (tail->next != nullptr){ tail = tail->next; }
+			tail->next = myCleanups;
+			myCleanups = other.myCleanups;
+		}
+		other.myChunks = nullptr;
+		other.myCleanups = nullptr;
+		other.myCur = nullptr;
+		other.myEnd = nullptr;
+	}
+
+	/** Destroy everything in the arena, newest first **/
+	void release(){
+		while (myCleanups != nullptr){
+			Cleanup * cleanup = myCleanups;
+			myCleanups = cleanup->next;
+			cleanup->destroy(cleanup->obj);
+		}
+		while (myChunks != nullptr){
+			Chunk * next = myChunks->next;
+			std::free(myChunks);
+			myChunks = next;
+		}
+		myCur = nullptr;
+		myEnd = nullptr;
+	}
+
+private:
+	struct Chunk{
+		Chunk * next;
+	};
+
+	struct Cleanup{
+		void (*destroy)(void *);
+		void * obj;
+		Cleanup * next;
+	};
+
+	static const size_t CHUNK_SIZE = 64 * 1024;
+
+	template <typename T>
+	static void destroy(void * obj){
+		static_cast<T *>(obj)->~T();
+	}
+
+	static size_t padding(const char * ptr, size_t align){
+		std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(ptr);
+		return (align - addr % align) % align;
+	}
+
+	void grow(size_t minSize){
+		size_t size = sizeof(Chunk) + minSize;
+		if (size < CHUNK_SIZE){ size = CHUNK_SIZE; }
+		void * mem = std::malloc(size);
+		if (mem == nullptr){ throw std::bad_alloc(); }
+		Chunk * chunk = static_cast<Chunk *>(mem);
+		chunk->next = myChunks;
+		myChunks = chunk;
+		myCur = static_cast<char *>(mem) + sizeof(Chunk);
+		myEnd = static_cast<char *>(mem) + size;
+	}
+
+	Chunk * myChunks;
+	char * myCur;
+	char * myEnd;
+	Cleanup * myCleanups;
+};
+
+/**
+* A growable array whose storage is carved out of an Arena. The AST
+* uses it for its child lists so that siblings sit next to each other
+* in memory. When it outgrows its storage the old block is simply
+* abandoned to the arena, which at most doubles the space it uses.
+* Only meant for trivially copyable elements, such as node pointers.
+**/
+template <typename T>
+class ArenaVector{
+	static_assert(std::is_trivially_copyable<T>::value,
+		"ArenaVector elements are copied bitwise");
+public:
+	ArenaVector(Arena& arenaIn)
+	: myArena(&arenaIn), myData(nullptr), mySize(0), myCap(0){}
+
+	void push_back(const T& val){
+		if (mySize == myCap){ grow(); }
+		myData[mySize++] = val;
+	}
+
+	size_t size() const { return mySize; }
+	bool empty() const { return mySize == 0; }
+	T& operator[](size_t i){ return myData[i]; }
+	const T& operator[](size_t i) const { return myData[i]; }
+	T * begin(){ return myData; }
+	T * end(){ return myData + mySize; }
+	const T * begin() const { return myData; }
+	const T * end() const { return myData + mySize; }
+
+private:
+	void grow(){
+		size_t cap = myCap == 0 ? 4 : myCap * 2;
+		void * mem = myArena->allocate(sizeof(T) * cap, alignof(T));
+		T * data = static_cast<T *>(mem);
+		for (size_t i = 0; i < mySize; i++){ data[i] = myData[i]; }
+		myData = data;
+		myCap = cap;
+	}
+
+	Arena * myArena;
+	T * myData;
+	size_t mySize;
+	size_t myCap;
+};
+
+} //End namespace holeyc
+
+#endif
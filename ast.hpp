@@ -1,9 +1,10 @@
 #ifndef HOLEYC_AST_HPP
 #define HOLEYC_AST_HPP
 
-#include <ostream>
-#include <list>
-#include "tokens.hpp"
+#include <cstdint>
+#include "arena.hpp"
+#include "intern.hpp"
+#include "writer.hpp"
 
 // **********************************************************************
 // ASTnode class (base class for all other kinds of nodes)
@@ -70,14 +71,50 @@ class NotNode;
 class FnDeclNode;
 class VarDeclNode;
 class FormalDeclNode;
+class AstEncoder;
+class SemSymbol;
+
+/**
+* One tag per concrete node class, used where a node has to be 
+* identified by something other than its C++ type (e.g. in a 
+* serialized AST). The values are part of the AST file format, so
+* new kinds go at the end.
+**/
+enum class NodeKind : uint16_t {
+	Program, VarDecl, FnDecl, FormalDecl,
+	IntType, IntPtr, BoolType, BoolPtr, CharType, CharPtr, VoidType,
+	AssignStmt, PostDecStmt, PostIncStmt, FromConsoleStmt,
+	ToConsoleStmt, IfStmt, IfElseStmt, WhileStmt, ReturnStmt, CallStmt,
+	AssignExp, CallExp,
+	Minus, Plus, Times, Divide, And, Or,
+	Equals, NotEquals, Greater, GreaterEq, Less, LessEq,
+	Not, Neg,
+	NullPtr, IntLit, StrLit, CharLit, True, False,
+	LVal, Index, Deref, Ref, ID,
+	NumKinds
+};
+
+/**
+* The type of an expression or a variable, as the type checker sees
+* it (see typecheck.cpp). Unchecked is what an expression has until
+* it is checked, and Error what it has if its type could not be
+* worked out, so that each mistake is reported only once.
+**/
+enum class DataType : uint8_t {
+	Unchecked, Error, Void, Int, Bool, Char, IntPtr, BoolPtr, CharPtr,
+	Null, Fn
+};
 
 
 class ASTNode{
 public:
-	ASTNode(size_t lineIn, size_t colIn)
-	: l(lineIn), c(colIn){
+	ASTNode(NodeKind kindIn, size_t lineIn, size_t colIn)
+	: myKind(kindIn), myDataType(DataType::Unchecked), 
+	  l(static_cast<uint32_t>(lineIn)), 
+	  c(static_cast<uint32_t>(colIn)){
 	}
-	virtual void unparse(std::ostream& out, int indent) = 0;
+	/** Which concrete class this node is (see AstVisitor) **/
+	NodeKind kind(){ return myKind; }
 	size_t line(){ return l; }
 	size_t col() { return c; }
 
@@ -93,40 +130,53 @@ public:
 	}
 
 private:
-	size_t l; /// The line at which the node starts in the input file
-	size_t c; /// The column at which the node starts in the input file
+	friend class ExpNode;
+
+	//Positions are 32-bit, as in the token stream, so that the kind
+	// fits beside them without growing every node
+	NodeKind myKind;
+	//Only an ExpNode has a type, but it is kept here, where it 
+	// fits in what would otherwise be padding
+	DataType myDataType;
+	uint32_t l; /// The line at which the node starts in the input file
+	uint32_t c; /// The column at which the node starts in the input file
 };
 
 ///////////////////////
 //Children of ASTNode//
 ///////////////////////
 class ExpNode : public ASTNode{
+public:
+	/** The type the type checker gave this expression **/
+	DataType dataType(){ return myDataType; }
+	void setDataType(DataType typeIn){ myDataType = typeIn; }
 protected:
-	ExpNode(size_t l, size_t c) : ASTNode(l, c){}
+	ExpNode(NodeKind kind, size_t l, size_t c) : ASTNode(kind, l, c){}
 };
 
 class ProgramNode : public ASTNode{
 public:
-	ProgramNode(std::list<DeclNode *> * globalsIn) : ASTNode(1, 1), myGlobals(globalsIn){}
-	void unparse(std::ostream& out, int indent) override;
+	ProgramNode(ArenaVector<DeclNode*>* globalsIn) : ASTNode(NodeKind::Program, 1, 1), myGlobals(globalsIn){}
+	ArenaVector<DeclNode*>* globals(){ return myGlobals; }
 private:
-	std::list<DeclNode * > * myGlobals;
+	ArenaVector<DeclNode*>* myGlobals;
 };
 
 class StmtNode : public ASTNode{
 public:
-	StmtNode(size_t l, size_t c) : ASTNode(l ,c) {}
-	virtual void unparse(std::ostream& out, int indent) = 0;
+	StmtNode(NodeKind kind, size_t l, size_t c) : ASTNode(kind, l ,c) {}
 };
 
 class IDNode : public ExpNode{
 public:
-	IDNode(IDToken * token) : ExpNode(token->line(), token->col()), myStrVal(token->value()){
-		myStrVal = token->value();
-	}
-	void unparse(std::ostream& out, int indent);
+	IDNode(size_t l, size_t c, Symbol symIn) : ExpNode(NodeKind::ID, l, c), mySym(symIn), mySemSym(nullptr){}
+	Symbol sym(){ return mySym; }
+	/** The declaration this names, once name analysis has run **/
+	SemSymbol * semSymbol(){ return mySemSym; }
+	void attachSymbol(SemSymbol * symIn){ mySemSym = symIn; }
 private:
-	std::string myStrVal;
+	Symbol mySym;
+	SemSymbol * mySemSym;
 };
 
 /**  \class TypeNode
@@ -136,11 +186,11 @@ private:
 **/
 class TypeNode : public ASTNode{
 protected:
-	TypeNode(size_t lineIn, size_t colIn, bool refIn) 
-	: ASTNode(lineIn, colIn), myIsReference(refIn){
+	TypeNode(NodeKind kindIn, size_t lineIn, size_t colIn, bool refIn) 
+	: ASTNode(kindIn, lineIn, colIn), myIsReference(refIn){
 	}
 public:
-	virtual void unparse(std::ostream& out, int indent) = 0;
+	bool isReference(){ return myIsReference; }
 	//TODO: consider adding an isRef to use in unparse to 
 	// indicate if this is a reference type
 private:
@@ -149,10 +199,11 @@ private:
 
 class LValNode : public ExpNode{
 public:
-	LValNode(IDNode* id) : ExpNode(id->line(), id->col()), myId(id){}
-	void unparse(std::ostream& out, int indent);
+	LValNode(IDNode* id) : LValNode(NodeKind::LVal, id){}
+	IDNode* id(){ return myId; }
 
-private:
+protected:
+	LValNode(NodeKind kind, IDNode* id) : ExpNode(kind, id->line(), id->col()), myId(id){}
 	IDNode* myId;
 };
 
@@ -161,8 +212,10 @@ private:
 ///////////////////////
 class AssignExpNode : public ExpNode{
 public:
-	AssignExpNode(LValNode* lVal, ExpNode* srcExp) : ExpNode(lVal->line(), lVal->col()), myLVal(lVal), myExp(srcExp){}
-	void unparse(std::ostream& out, int indent);
+	AssignExpNode(LValNode* lVal, ExpNode* srcExp) : ExpNode(NodeKind::AssignExp, lVal->line(), lVal->col()), myLVal(lVal), myExp(srcExp){}
+	LValNode* lval(){ return myLVal; }
+	ExpNode* exp(){ return myExp; }
+	void setExp(ExpNode* expIn){ myExp = expIn; }
 private:
 	LValNode* myLVal;
 	ExpNode* myExp;
@@ -170,71 +223,73 @@ private:
 
 class BinaryExpNode : public ExpNode{
 public:
-	BinaryExpNode(ExpNode* lhs, ExpNode* rhs) : ExpNode(lhs->line(), lhs->col()){}
-	virtual void unparse(std::ostream& out, int indent) = 0;
+	BinaryExpNode(NodeKind kind, ExpNode* lhs, ExpNode* rhs) : ExpNode(kind, lhs->line(), lhs->col()), myLhs(lhs), myRhs(rhs){}
+	ExpNode* lhs(){ return myLhs; }
+	ExpNode* rhs(){ return myRhs; }
+	void setLhs(ExpNode* lhsIn){ myLhs = lhsIn; }
+	void setRhs(ExpNode* rhsIn){ myRhs = rhsIn; }
+protected:
+	ExpNode* myLhs;
+	ExpNode* myRhs;
 };
 
 class CallExpNode : public ExpNode{
 public:
-	CallExpNode(IDNode* id, std::list<ExpNode*>* paramList) : ExpNode(id->line(), id->col()), myId(id), myParams(paramList){}
-	void unparse(std::ostream& out, int indent);
+	CallExpNode(IDNode* id, ArenaVector<ExpNode*>* paramList) : ExpNode(NodeKind::CallExp, id->line(), id->col()), myId(id), myParams(paramList){}
+	IDNode* id(){ return myId; }
+	ArenaVector<ExpNode*>* args(){ return myParams; }
 
 private:
 	IDNode* myId;
-	std::list<ExpNode*>* myParams;
+	ArenaVector<ExpNode*>* myParams;
 };
 
 class NullPtrNode : public ExpNode{
 public:
-	NullPtrNode(size_t l, size_t c) : ExpNode(l, c){}
-	void unparse(std::ostream& out, int indent);
+	NullPtrNode(size_t l, size_t c) : ExpNode(NodeKind::NullPtr, l, c){}
 };
 
 class CharLitNode : public ExpNode{
 public:
-	CharLitNode(size_t l, size_t c, CharLitToken* charIn) : ExpNode(l, c){
-		myChar = charIn->val();
-	}
-	void unparse(std::ostream& out, int indent);
+	CharLitNode(size_t l, size_t c, char charIn) : ExpNode(NodeKind::CharLit, l, c), myChar(charIn){}
+	char value(){ return myChar; }
 private:
 	char myChar;
 };
 
 class IntLitNode : public ExpNode{
 public:
-	IntLitNode(size_t l, size_t c, IntLitToken* intIn) : ExpNode(l, c){
-		myInt = intIn->num();
-	}
-	void unparse(std::ostream& out, int indent);
+	IntLitNode(size_t l, size_t c, int intIn) : ExpNode(NodeKind::IntLit, l, c), myInt(intIn){}
+	int value(){ return myInt; }
 private:
 	int myInt;
 };
 
 class StrLitNode : public ExpNode{
 public:
-	StrLitNode(size_t l, size_t c, StrToken* strIn) : ExpNode(l, c){
-		myStr = strIn->str();
-	}
-	void unparse(std::ostream& out, int indent);
+	StrLitNode(size_t l, size_t c, Symbol strIn) : ExpNode(NodeKind::StrLit, l, c), myStr(strIn){}
+	Symbol str(){ return myStr; }
 private:
-	std::string myStr;
+	Symbol myStr;
 };
 
 class TrueNode : public ExpNode{
 public:
-	TrueNode(Token* token) : ExpNode(token->line(), token->col()){}
-	void unparse(std::ostream& out, int indent);
+	TrueNode(size_t l, size_t c) : ExpNode(NodeKind::True, l, c){}
 };
 
 class FalseNode : public ExpNode{
 public:
-	FalseNode(Token* token) : ExpNode(token->line(), token->col()){}
-	void unparse(std::ostream& out, int indent);
+	FalseNode(size_t l, size_t c) : ExpNode(NodeKind::False, l, c){}
 };
 
 class UnaryExpNode : public ExpNode{
 public:
-	UnaryExpNode(ExpNode* exp) : ExpNode(exp->line(), exp->col()){}
+	UnaryExpNode(NodeKind kind, ExpNode* exp) : ExpNode(kind, exp->line(), exp->col()), myExp(exp){}
+	ExpNode* exp(){ return myExp; }
+	void setExp(ExpNode* expIn){ myExp = expIn; }
+protected:
+	ExpNode* myExp;
 };
 
 ////////////////////////
@@ -243,16 +298,16 @@ public:
 
 class AssignStmtNode : public StmtNode{
 public:
-	AssignStmtNode(AssignExpNode* assignment) : StmtNode(assignment->line(), assignment->col()), myAssign(assignment){}
-	void unparse(std::ostream& out, int indent);
+	AssignStmtNode(AssignExpNode* assignment) : StmtNode(NodeKind::AssignStmt, assignment->line(), assignment->col()), myAssign(assignment){}
+	AssignExpNode* assign(){ return myAssign; }
 private:
 	AssignExpNode* myAssign;
 };
 
 class CallStmtNode : public StmtNode{
 public:
-	CallStmtNode(CallExpNode* call) : StmtNode(call->line(), call->col()), myCall(call){}
-	void unparse(std::ostream& out, int indent);
+	CallStmtNode(CallExpNode* call) : StmtNode(NodeKind::CallStmt, call->line(), call->col()), myCall(call){}
+	CallExpNode* call(){ return myCall; }
 
 private:
 	CallExpNode* myCall;
@@ -260,14 +315,22 @@ private:
 
 class DeclNode : public StmtNode{
 public:
-	DeclNode(size_t l, size_t c) : StmtNode(l, c) {}
-	virtual void unparse(std::ostream& out, int indent) = 0;
+	DeclNode(NodeKind kind, size_t l, size_t c) : StmtNode(kind, l, c), myHash(0) {}
+
+	/** 
+	* For a top-level declaration parsed incrementally (-i), a hash 
+	* of its tokens; otherwise 0
+	**/
+	uint64_t hash(){ return myHash; }
+	void setHash(uint64_t hashIn){ myHash = hashIn; }
+private:
+	uint64_t myHash;
 };
 
 class FromConsoleStmtNode : public StmtNode{
 public:
-	FromConsoleStmtNode(LValNode* lVal) : StmtNode(lVal->line(), lVal->col()), myLVal(lVal){}
-	void unparse(std::ostream& out, int indent);
+	FromConsoleStmtNode(LValNode* lVal) : StmtNode(NodeKind::FromConsoleStmt, lVal->line(), lVal->col()), myLVal(lVal){}
+	LValNode* lval(){ return myLVal; }
 
 private:
 	LValNode* myLVal;
@@ -275,29 +338,34 @@ private:
 
 class IfElseStmtNode : public StmtNode{
 public:
-	IfElseStmtNode(ExpNode* exp, std::list<StmtNode*>* trueList, std::list<StmtNode*>* falseList) : StmtNode(exp->line(), exp->col()),
+	IfElseStmtNode(ExpNode* exp, ArenaVector<StmtNode*>* trueList, ArenaVector<StmtNode*>* falseList) : StmtNode(NodeKind::IfElseStmt, exp->line(), exp->col()),
 		myExp(exp), myTList(trueList), myFList(falseList){}
-	void unparse(std::ostream& out, int indent);
+	ExpNode* exp(){ return myExp; }
+	void setExp(ExpNode* expIn){ myExp = expIn; }
+	ArenaVector<StmtNode*>* thenBody(){ return myTList; }
+	ArenaVector<StmtNode*>* elseBody(){ return myFList; }
 private:
 	ExpNode* myExp;
-	std::list<StmtNode*>* myTList;
-	std::list<StmtNode*>* myFList;
+	ArenaVector<StmtNode*>* myTList;
+	ArenaVector<StmtNode*>* myFList;
 };
 
 class IfStmtNode : public StmtNode{
 public:
-	IfStmtNode(ExpNode* exp, std::list<StmtNode*>* stmtList) : StmtNode(exp->line(), exp->col()), myExp(exp), myStmtList(stmtList){}
-	void unparse(std::ostream& out, int indent);
+	IfStmtNode(ExpNode* exp, ArenaVector<StmtNode*>* stmtList) : StmtNode(NodeKind::IfStmt, exp->line(), exp->col()), myExp(exp), myStmtList(stmtList){}
+	ExpNode* exp(){ return myExp; }
+	void setExp(ExpNode* expIn){ myExp = expIn; }
+	ArenaVector<StmtNode*>* body(){ return myStmtList; }
 
 private:
 	ExpNode* myExp;
-	std::list<StmtNode*>* myStmtList;
+	ArenaVector<StmtNode*>* myStmtList;
 };
 
 class PostDecStmtNode : public StmtNode{
 public:
-	PostDecStmtNode(ExpNode* decId) : StmtNode(decId->line(), decId->col()), myExp(decId){}
-	void unparse(std::ostream& out, int indent);
+	PostDecStmtNode(ExpNode* decId) : StmtNode(NodeKind::PostDecStmt, decId->line(), decId->col()), myExp(decId){}
+	ExpNode* exp(){ return myExp; }
 
 private:
 	ExpNode* myExp;
@@ -305,8 +373,8 @@ private:
 
 class PostIncStmtNode : public StmtNode{
 public:
-	PostIncStmtNode(ExpNode* incId) : StmtNode(incId->line(), incId->col()), myExp(incId){}
-	void unparse(std::ostream& out, int indent);
+	PostIncStmtNode(ExpNode* incId) : StmtNode(NodeKind::PostIncStmt, incId->line(), incId->col()), myExp(incId){}
+	ExpNode* exp(){ return myExp; }
 private:
 	ExpNode* myExp;
 };
@@ -314,9 +382,11 @@ private:
 class ReturnStmtNode : public StmtNode{
 public:
 	// The issue is right here.  When no values are passed, returnId = nullptr, then we try to call nullptr->line() which seg faults
-	ReturnStmtNode(ExpNode* returnId, bool emptyIn) : StmtNode(returnId->line(), returnId->col()), myExp(returnId), empty(emptyIn){}
-	ReturnStmtNode(size_t l, size_t c, bool emptyIn) : StmtNode(l, c), empty(emptyIn){}
-	void unparse(std::ostream& out, int indent);
+	ReturnStmtNode(ExpNode* returnId, bool emptyIn) : StmtNode(NodeKind::ReturnStmt, returnId->line(), returnId->col()), myExp(returnId), empty(emptyIn){}
+	ReturnStmtNode(size_t l, size_t c, bool emptyIn) : StmtNode(NodeKind::ReturnStmt, l, c), myExp(nullptr), empty(emptyIn){}
+	/** The returned expression, or null for a bare return **/
+	ExpNode* exp(){ return empty ? nullptr : myExp; }
+	void setExp(ExpNode* expIn){ myExp = expIn; }
 
 private:
 	ExpNode* myExp;
@@ -325,8 +395,9 @@ private:
 
 class ToConsoleStmtNode : public StmtNode{
 public:
-	ToConsoleStmtNode(ExpNode* exp) : StmtNode(exp->line(), exp->col()), myExp(exp){}
-	void unparse(std::ostream& out, int indent);
+	ToConsoleStmtNode(ExpNode* exp) : StmtNode(NodeKind::ToConsoleStmt, exp->line(), exp->col()), myExp(exp){}
+	ExpNode* exp(){ return myExp; }
+	void setExp(ExpNode* expIn){ myExp = expIn; }
 
 private:
 	ExpNode* myExp;
@@ -334,12 +405,14 @@ private:
 
 class WhileStmtNode : public StmtNode{
 public:
-	WhileStmtNode(ExpNode* condition, std::list<StmtNode*>* body) : StmtNode(condition->line(), condition->col()),
+	WhileStmtNode(ExpNode* condition, ArenaVector<StmtNode*>* body) : StmtNode(NodeKind::WhileStmt, condition->line(), condition->col()),
 		myExp(condition), myStmtList(body){}
-	void unparse(std::ostream& out, int indent);
+	ExpNode* exp(){ return myExp; }
+	void setExp(ExpNode* expIn){ myExp = expIn; }
+	ArenaVector<StmtNode*>* body(){ return myStmtList; }
 private:
 	ExpNode* myExp;
-	std::list<StmtNode*>* myStmtList;
+	ArenaVector<StmtNode*>* myStmtList;
 };
 
 ////////////////////////
@@ -348,44 +421,37 @@ private:
 
 class BoolTypeNode : public TypeNode{
 public:
-	BoolTypeNode(size_t l, size_t c, bool refIn) : TypeNode(l, c, refIn){}
-	void unparse(std::ostream& out, int indent);
+	BoolTypeNode(size_t l, size_t c, bool refIn) : TypeNode(NodeKind::BoolType, l, c, refIn){}
 };
 
 class BoolPtrNode : public TypeNode{
 public:
-	BoolPtrNode(size_t l, size_t c, bool refIn) : TypeNode(l, c, refIn){}
-	void unparse(std::ostream& out, int indent);
+	BoolPtrNode(size_t l, size_t c, bool refIn) : TypeNode(NodeKind::BoolPtr, l, c, refIn){}
 };
 
 class CharTypeNode : public TypeNode{
 public:
-	CharTypeNode(size_t l, size_t c, bool refIn) : TypeNode(l, c, refIn){}
-	void unparse(std::ostream& out, int indent);
+	CharTypeNode(size_t l, size_t c, bool refIn) : TypeNode(NodeKind::CharType, l, c, refIn){}
 };
 
 class CharPtrNode : public TypeNode{
 public:
-	CharPtrNode(size_t l, size_t c, bool refIn) : TypeNode(l, c, refIn){}
-	void unparse(std::ostream& out, int indent);
+	CharPtrNode(size_t l, size_t c, bool refIn) : TypeNode(NodeKind::CharPtr, l, c, refIn){}
 };
 
 class IntTypeNode : public TypeNode{
 public:
-	IntTypeNode(size_t l, size_t c, bool isRefIn): TypeNode(l, c, isRefIn){}
-	void unparse(std::ostream& out, int indent);
+	IntTypeNode(size_t l, size_t c, bool isRefIn): TypeNode(NodeKind::IntType, l, c, isRefIn){}
 };
 
 class IntPtrNode : public TypeNode{
 public:
-	IntPtrNode(size_t l, size_t c, bool isRefIn): TypeNode(l, c, isRefIn){}
-	void unparse(std::ostream& out, int indent);
+	IntPtrNode(size_t l, size_t c, bool isRefIn): TypeNode(NodeKind::IntPtr, l, c, isRefIn){}
 };
 
 class VoidTypeNode : public TypeNode{
 public:
-	VoidTypeNode(size_t l, size_t c, bool refIn) : TypeNode(l, c, refIn){}
-	void unparse(std::ostream& out, int indent);
+	VoidTypeNode(size_t l, size_t c, bool refIn) : TypeNode(NodeKind::VoidType, l, c, refIn){}
 };
 
 /////////////////////////////
@@ -394,122 +460,62 @@ public:
 
 class AndNode : public BinaryExpNode{
 public: 
-	AndNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(lhs, rhs), myLhs(lhs), myRhs(rhs){}
-	void unparse(std::ostream& out, int indent);
-
-private:
-	ExpNode* myLhs;
-	ExpNode* myRhs;
+	AndNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(NodeKind::And, lhs, rhs){}
 };
 
 class DivideNode : public BinaryExpNode{
 public: 
-	DivideNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(lhs, rhs), myLhs(lhs), myRhs(rhs){}
-	void unparse(std::ostream& out, int indent);
-
-private:
-	ExpNode* myLhs;
-	ExpNode* myRhs;
+	DivideNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(NodeKind::Divide, lhs, rhs){}
 };
 
 class EqualsNode : public BinaryExpNode{
 public: 
-	EqualsNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(lhs, rhs), myLhs(lhs), myRhs(rhs){}
-	void unparse(std::ostream& out, int indent);
-
-private:
-	ExpNode* myLhs;
-	ExpNode* myRhs;
+	EqualsNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(NodeKind::Equals, lhs, rhs){}
 };
 
 class GreaterEqNode : public BinaryExpNode{
 public: 
-	GreaterEqNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(lhs, rhs), myLhs(lhs), myRhs(rhs){}
-	void unparse(std::ostream& out, int indent);
-
-private:
-	ExpNode* myLhs;
-	ExpNode* myRhs;
+	GreaterEqNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(NodeKind::GreaterEq, lhs, rhs){}
 };
 
 class GreaterNode : public BinaryExpNode{
 public: 
-	GreaterNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(lhs, rhs), myLhs(lhs), myRhs(rhs){}
-	void unparse(std::ostream& out, int indent);
-
-private:
-	ExpNode* myLhs;
-	ExpNode* myRhs;
+	GreaterNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(NodeKind::Greater, lhs, rhs){}
 };
 
 class LessEqNode : public BinaryExpNode{
 public: 
-	LessEqNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(lhs, rhs), myLhs(lhs), myRhs(rhs){}
-	void unparse(std::ostream& out, int indent);
-
-private:
-	ExpNode* myLhs;
-	ExpNode* myRhs;
+	LessEqNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(NodeKind::LessEq, lhs, rhs){}
 };
 
 class LessNode : public BinaryExpNode{
 public: 
-	LessNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(lhs, rhs), myLhs(lhs), myRhs(rhs){}
-	void unparse(std::ostream& out, int indent);
-
-private:
-	ExpNode* myLhs;
-	ExpNode* myRhs;
+	LessNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(NodeKind::Less, lhs, rhs){}
 };
 
 class MinusNode : public BinaryExpNode{
 public: 
-	MinusNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(lhs, rhs), myLhs(lhs), myRhs(rhs){}
-	void unparse(std::ostream& out, int indent);
-
-private:
-	ExpNode* myLhs;
-	ExpNode* myRhs;
+	MinusNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(NodeKind::Minus, lhs, rhs){}
 };
 
 class NotEqualsNode : public BinaryExpNode{
 public: 
-	NotEqualsNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(lhs, rhs), myLhs(lhs), myRhs(rhs){}
-	void unparse(std::ostream& out, int indent);
-
-private:
-	ExpNode* myLhs;
-	ExpNode* myRhs;
+	NotEqualsNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(NodeKind::NotEquals, lhs, rhs){}
 };
 
 class OrNode : public BinaryExpNode{
 public: 
-	OrNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(lhs, rhs), myLhs(lhs), myRhs(rhs){}
-	void unparse(std::ostream& out, int indent);
-
-private:
-	ExpNode* myLhs;
-	ExpNode* myRhs;
+	OrNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(NodeKind::Or, lhs, rhs){}
 };
 
 class PlusNode : public BinaryExpNode{
 public: 
-	PlusNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(lhs, rhs), myLhs(lhs), myRhs(rhs){}
-	void unparse(std::ostream& out, int indent);
-
-private:
-	ExpNode* myLhs;
-	ExpNode* myRhs;
+	PlusNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(NodeKind::Plus, lhs, rhs){}
 };
 
 class TimesNode : public BinaryExpNode{
 public: 
-	TimesNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(lhs, rhs), myLhs(lhs), myRhs(rhs){}
-	void unparse(std::ostream& out, int indent);
-
-private:
-	ExpNode* myLhs;
-	ExpNode* myRhs;
+	TimesNode(ExpNode* lhs, ExpNode* rhs) : BinaryExpNode(NodeKind::Times, lhs, rhs){}
 };
 
 ////////////////////////////
@@ -518,27 +524,21 @@ private:
 
 class DerefNode : public LValNode{
 public:
-	DerefNode(IDNode* accessId) : LValNode(accessId), myId(accessId){}
-	void unparse(std::ostream& out, int indent);
-private:
-	IDNode * myId;
+	DerefNode(IDNode* accessId) : LValNode(NodeKind::Deref, accessId){}
 };
 
 class RefNode : public LValNode{
 public:
-	RefNode(IDNode* accessId) : LValNode(accessId), myId(accessId) {}
-	void unparse(std::ostream& out, int indent);
-private:
-	IDNode * myId;
+	RefNode(IDNode* accessId) : LValNode(NodeKind::Ref, accessId) {}
 };
 
 class IndexNode : public LValNode{
 public:
-	IndexNode(IDNode* accessId, ExpNode* offset) : LValNode(accessId), myId(accessId), myExp(offset){}
-	void unparse(std::ostream& out, int indent);
+	IndexNode(IDNode* accessId, ExpNode* offset) : LValNode(NodeKind::Index, accessId), myExp(offset){}
+	ExpNode* exp(){ return myExp; }
+	void setExp(ExpNode* expIn){ myExp = expIn; }
 
 private:
-	IDNode* myId;
 	ExpNode* myExp;
 };
 
@@ -548,33 +548,28 @@ private:
 
 class NegNode : public UnaryExpNode{
 public:
-	NegNode(ExpNode* exp) : UnaryExpNode(exp), myExp(exp){}
-	void unparse(std::ostream& out, int indent);
-
-private:
-	ExpNode* myExp;
+	NegNode(ExpNode* exp) : UnaryExpNode(NodeKind::Neg, exp){}
 };
 
 class NotNode : public UnaryExpNode{
 public:
-	NotNode(ExpNode* exp) : UnaryExpNode(exp), myExp(exp){}
-	void unparse(std::ostream& out, int indent);
-
-private:
-	ExpNode* myExp;
+	NotNode(ExpNode* exp) : UnaryExpNode(NodeKind::Not, exp){}
 };
 
 class FnDeclNode : public DeclNode{
 public:
-	FnDeclNode(TypeNode* type, IDNode* id, std::list<FormalDeclNode*>* params, std::list<StmtNode*>* body):
-	DeclNode(type->line(), type->col()), myType(type), myId(id), myParams(params), myBody(body){}
-	void unparse(std::ostream& out, int indent);
+	FnDeclNode(TypeNode* type, IDNode* id, ArenaVector<FormalDeclNode*>* params, ArenaVector<StmtNode*>* body):
+	DeclNode(NodeKind::FnDecl, type->line(), type->col()), myType(type), myId(id), myParams(params), myBody(body){}
+	TypeNode* type(){ return myType; }
+	IDNode* id(){ return myId; }
+	ArenaVector<FormalDeclNode*>* params(){ return myParams; }
+	ArenaVector<StmtNode*>* body(){ return myBody; }
 
 private:
 	TypeNode* myType;
 	IDNode* myId;
-	std::list<FormalDeclNode*>* myParams;
-	std::list<StmtNode*>* myBody;
+	ArenaVector<FormalDeclNode*>* myParams;
+	ArenaVector<StmtNode*>* myBody;
 };
 
 /** A variable declaration. Note that this class is intended to 
@@ -591,8 +586,9 @@ private:
 **/
 class VarDeclNode : public DeclNode{
 public:
-	VarDeclNode(size_t l, size_t c, TypeNode * type, IDNode * id) : DeclNode(type->line(), type->col()), myType(type), myId(id){}
-	void unparse(std::ostream& out, int indent);
+	VarDeclNode(size_t l, size_t c, TypeNode * type, IDNode * id) : DeclNode(NodeKind::VarDecl, type->line(), type->col()), myType(type), myId(id){}
+	TypeNode* type(){ return myType; }
+	IDNode* id(){ return myId; }
 private:
 	TypeNode * myType;
 	IDNode * myId;
@@ -600,14 +596,25 @@ private:
 
 class FormalDeclNode : public DeclNode{
 public:
-	FormalDeclNode(TypeNode* type, IDNode* id) : DeclNode(type->line(), type->col()), myType(type), myId(id){}
-	void unparse(std::ostream& out, int indent);
+	FormalDeclNode(TypeNode* type, IDNode* id) : DeclNode(NodeKind::FormalDecl, type->line(), type->col()), myType(type), myId(id){}
+	TypeNode* type(){ return myType; }
+	IDNode* id(){ return myId; }
 
 private:
 	TypeNode * myType;
 	IDNode * myId;
 };
 
+/** 
+* Write node back out as source (see unparse.cpp). With names, each
+* identifier that name analysis linked is followed by its type, in
+* braces.
+**/
+void unparse(ASTNode * node, Writer& out, bool names = false);
+
+/** Add node's subtree to enc; returns the record of node **/
+uint32_t serialize(ASTNode * node, AstEncoder& enc);
+
 } //End namespace holeyc
 
 #endif
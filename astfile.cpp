@@ -0,0 +1,489 @@
+#include <cstring>
+#include "astfile.hpp"
+#include "errors.hpp"
+
+namespace holeyc{
+
+static const size_t HEADER_WORDS = 8;
+
+static void badAstFile(){
+	throw new InternalError("Bad AST file");
+}
+
+uint32_t AstEncoder::add(NodeKind kind, ASTNode * node, uint32_t value,
+	const uint32_t * kids, size_t count){
+	uint32_t at = static_cast<uint32_t>(myWords.size());
+	myWords.push_back(static_cast<uint32_t>(kind));
+	myWords.push_back(static_cast<uint32_t>(node->line()));
+	myWords.push_back(static_cast<uint32_t>(node->col()));
+	myWords.push_back(value);
+	myWords.push_back(static_cast<uint32_t>(count));
+	for (size_t k = 0; k < count; k++){
+		int32_t rel = static_cast<int32_t>(kids[k]) - static_cast<int32_t>(at);
+		myWords.push_back(static_cast<uint32_t>(rel));
+	}
+	myNodes++;
+	myKindCounts[static_cast<size_t>(kind)]++;
+	return at;
+}
+
+uint32_t AstEncoder::symbol(Symbol sym){
+	uint32_t next = static_cast<uint32_t>(mySymStarts.size());
+	auto found = mySymNums.emplace(sym.id(), next);
+	if (found.second){
+		mySymStarts.push_back(static_cast<uint32_t>(myStrings.size()));
+		myStrings += sym.text();
+	}
+	return found.first->second;
+}
+
+void AstEncoder::write(Writer& out, uint32_t root){
+	uint32_t header[HEADER_WORDS] = {
+		AstFile::MAGIC,
+		AstFile::VERSION,
+		static_cast<uint32_t>(myNodes),
+		static_cast<uint32_t>(myWords.size()),
+		root,
+		static_cast<uint32_t>(mySymStarts.size()),
+		static_cast<uint32_t>(myStrings.size()),
+		0,
+	};
+	uint32_t stringsEnd = static_cast<uint32_t>(myStrings.size());
+	out.write(reinterpret_cast<const char *>(header), sizeof(header));
+	out.write(reinterpret_cast<const char *>(myWords.data()), 
+		myWords.size() * sizeof(uint32_t));
+	out.write(reinterpret_cast<const char *>(mySymStarts.data()), 
+		mySymStarts.size() * sizeof(uint32_t));
+	out.write(reinterpret_cast<const char *>(&stringsEnd), 
+		sizeof(stringsEnd));
+	out << myStrings;
+}
+
+bool AstFile::isAstFile(const char * data, size_t size){
+	uint32_t magic;
+	if (size < sizeof(magic)){ return false; }
+	memcpy(&magic, data, sizeof(magic));
+	return magic == MAGIC;
+}
+
+AstFile::AstFile(const char * data, size_t size){
+	uint32_t header[HEADER_WORDS];
+	if (size < sizeof(header)){ badAstFile(); }
+	memcpy(header, data, sizeof(header));
+	if (header[0] != MAGIC || header[1] != VERSION){ badAstFile(); }
+	myNodes = header[2];
+	myWords = header[3];
+	myRoot = header[4];
+	mySymbols = header[5];
+	size_t stringBytes = header[6];
+
+	size_t need = sizeof(header) + myWords * sizeof(uint32_t)
+		+ (mySymbols + 1) * sizeof(uint32_t) + stringBytes;
+	if (size < need){ badAstFile(); }
+
+	//Every array is 4-byte aligned relative to data, which is a mapping
+	const char * pos = data + sizeof(header);
+	myRecords = reinterpret_cast<const uint32_t *>(pos);
+	pos += myWords * sizeof(uint32_t);
+	mySymStarts = reinterpret_cast<const uint32_t *>(pos);
+	pos += (mySymbols + 1) * sizeof(uint32_t);
+	myStrings = pos;
+
+	for (size_t s = 0; s < mySymbols; s++){
+		if (mySymStarts[s] > mySymStarts[s + 1]){ badAstFile(); }
+	}
+	if (mySymStarts[mySymbols] != stringBytes){ badAstFile(); }
+	check();
+}
+
+/*
+Make sure that every record, child offset and symbol is in bounds, so
+that nodes can be followed without any further checks.
+*/
+void AstFile::check() const {
+	std::vector<bool> starts(myWords, false);
+	size_t count = 0;
+	size_t pos = 0;
+	while (pos < myWords){
+		if (myWords - pos < Node::HEADER){ badAstFile(); }
+		const uint32_t * rec = myRecords + pos;
+		if (rec[0] >= static_cast<uint32_t>(NodeKind::NumKinds)){
+			badAstFile();
+		}
+		size_t kids = rec[4];
+		if (kids > myWords - pos - Node::HEADER){ badAstFile(); }
+		for (size_t k = 0; k < kids; k++){
+			int32_t rel = static_cast<int32_t>(rec[Node::HEADER + k]);
+			if (rel >= 0 || static_cast<size_t>(-rel) > pos){
+				badAstFile();
+			}
+			if (!starts[pos - static_cast<size_t>(-rel)]){ badAstFile(); }
+		}
+		NodeKind kind = static_cast<NodeKind>(rec[0]);
+		if ((kind == NodeKind::ID || kind == NodeKind::StrLit) 
+		  && rec[3] >= mySymbols){
+			badAstFile();
+		}
+		starts[pos] = true;
+		pos += Node::HEADER + kids;
+		count++;
+	}
+	if (count != myNodes || myRoot >= myWords || !starts[myRoot]){
+		badAstFile();
+	}
+	if (root().kind() != NodeKind::Program){ badAstFile(); }
+}
+
+namespace {
+
+/* Turns the records of an AST file back into nodes */
+class Builder{
+public:
+	//symbols is how many symbols to remember once interned, if any
+	Builder(Arena& arena, size_t symbols) 
+	: myArena(arena), mySyms(symbols), 
+	  myFromLine(0), myToLine(0), myFromCol(0), myToCol(0){}
+
+	/* 
+	Move what is built so that a node at (fromLine, fromCol) ends up
+	at (toLine, toCol). Later lines keep their columns.
+	*/
+	void move(size_t fromLine, size_t fromCol, size_t toLine, size_t toCol){
+		myFromLine = fromLine;
+		myFromCol = fromCol;
+		myToLine = toLine;
+		myToCol = toCol;
+	}
+
+	DeclNode * topDecl(AstFile::Node n){
+		ASTNode * node = build(n);
+		need(isDecl(node));
+		return static_cast<DeclNode *>(node);
+	}
+
+	ProgramNode * program(AstFile::Node n){
+		need(n.kind() == NodeKind::Program);
+		return static_cast<ProgramNode *>(build(n));
+	}
+
+private:
+	//Where a node is in the file, and how many of its children are built
+	struct Frame{
+		AstFile::Node node;
+		size_t built;
+	};
+
+	static void need(bool ok){
+		if (!ok){ badAstFile(); }
+	}
+
+	/*
+	Build the subtree at top, each node after its children. This 
+	works from stacks of its own rather than recursing, so any depth
+	of nesting can be read back.
+	*/
+	ASTNode * build(AstFile::Node top){
+		myFrames.clear();
+		myBuilt.clear();
+		myFrames.push_back(Frame{top, 0});
+		while (!myFrames.empty()){
+			Frame& frame = myFrames.back();
+			AstFile::Node n = frame.node;
+			if (frame.built < n.size()){
+				//frame is invalid once another is pushed
+				AstFile::Node kid = n.child(frame.built++);
+				myFrames.push_back(Frame{kid, 0});
+				continue;
+			}
+			myFrames.pop_back();
+			size_t first = myBuilt.size() - n.size();
+			ASTNode * node = make(n, myBuilt.data() + first);
+			myBuilt.resize(first);
+			myBuilt.push_back(node);
+		}
+		return myBuilt.back();
+	}
+
+	size_t line(AstFile::Node n){
+		if (myFromLine == 0){ return n.line(); }
+		need(n.line() >= myFromLine);
+		return n.line() - myFromLine + myToLine;
+	}
+
+	size_t col(AstFile::Node n){
+		if (myFromLine == 0 || n.line() != myFromLine){ return n.col(); }
+		need(n.col() >= myFromCol);
+		return n.col() - myFromCol + myToCol;
+	}
+
+	/*
+	What a child may be. The kinds of each sort are contiguous in
+	NodeKind.
+	*/
+	static bool isType(ASTNode * node){
+		return node->kind() >= NodeKind::IntType 
+			&& node->kind() <= NodeKind::VoidType;
+	}
+
+	static bool isDecl(ASTNode * node){
+		return node->kind() == NodeKind::VarDecl
+			|| node->kind() == NodeKind::FnDecl;
+	}
+
+	static bool isStmt(ASTNode * node){
+		return node->kind() == NodeKind::VarDecl
+			|| (node->kind() >= NodeKind::AssignStmt 
+			&& node->kind() <= NodeKind::CallStmt);
+	}
+
+	static bool isExp(ASTNode * node){
+		return node->kind() >= NodeKind::AssignExp
+			&& node->kind() <= NodeKind::ID;
+	}
+
+	static bool isLVal(ASTNode * node){
+		return node->kind() >= NodeKind::LVal 
+			&& node->kind() <= NodeKind::Ref;
+	}
+
+	static bool is(ASTNode * node, NodeKind kind){
+		return node->kind() == kind;
+	}
+
+	template <typename T>
+	T * exp(ASTNode * node){
+		need(isExp(node));
+		return static_cast<T *>(node);
+	}
+
+	IDNode * id(ASTNode * node){
+		need(is(node, NodeKind::ID));
+		return static_cast<IDNode *>(node);
+	}
+
+	TypeNode * type(ASTNode * node){
+		need(isType(node));
+		return static_cast<TypeNode *>(node);
+	}
+
+	LValNode * lval(ASTNode * node){
+		need(isLVal(node));
+		return static_cast<LValNode *>(node);
+	}
+
+	Symbol symbol(AstFile::Node n){
+		size_t len;
+		if (mySyms.empty()){
+			const char * text = n.text(&len);
+			return Symbol::intern(text, len);
+		}
+		Symbol& sym = mySyms[n.value()];
+		if (sym.isNone()){
+			const char * text = n.text(&len);
+			sym = Symbol::intern(text, len);
+		}
+		return sym;
+	}
+
+	ArenaVector<StmtNode *> * stmts(ASTNode ** kids, size_t from, size_t to){
+		auto list = myArena.make<ArenaVector<StmtNode *>>(myArena);
+		for (size_t k = from; k < to; k++){
+			need(isStmt(kids[k]));
+			list->push_back(static_cast<StmtNode *>(kids[k]));
+		}
+		return list;
+	}
+
+	template <typename T>
+	ExpNode * binary(AstFile::Node n, ASTNode ** kids){
+		need(n.size() == 2);
+		return myArena.make<T>(exp<ExpNode>(kids[0]), exp<ExpNode>(kids[1]));
+	}
+
+	template <typename T>
+	ExpNode * unary(AstFile::Node n, ASTNode ** kids){
+		need(n.size() == 1);
+		return myArena.make<T>(exp<ExpNode>(kids[0]));
+	}
+
+	template <typename T>
+	TypeNode * typeNode(AstFile::Node n){
+		need(n.size() == 0);
+		return myArena.make<T>(line(n), col(n), n.value() != 0);
+	}
+
+	/* The node for n, whose children have been built as kids */
+	ASTNode * make(AstFile::Node n, ASTNode ** kids){
+		size_t size = n.size();
+		size_t l = line(n);
+		size_t c = col(n);
+		switch (n.kind()){
+		case NodeKind::Program: {
+			auto decls = myArena.make<ArenaVector<DeclNode *>>(myArena);
+			for (size_t k = 0; k < size; k++){
+				need(isDecl(kids[k]));
+				decls->push_back(static_cast<DeclNode *>(kids[k]));
+			}
+			return myArena.make<ProgramNode>(decls);
+		}
+		case NodeKind::VarDecl:
+			need(size == 2);
+			return myArena.make<VarDeclNode>(l, c, type(kids[0]), 
+				id(kids[1]));
+		case NodeKind::FnDecl: {
+			need(size >= 2 && n.value() <= size - 2);
+			size_t bodyStart = 2 + n.value();
+			auto formals = myArena.make<ArenaVector<FormalDeclNode *>>(
+				myArena);
+			for (size_t k = 2; k < bodyStart; k++){
+				need(is(kids[k], NodeKind::FormalDecl));
+				formals->push_back(static_cast<FormalDeclNode *>(kids[k]));
+			}
+			return myArena.make<FnDeclNode>(type(kids[0]), id(kids[1]),
+				formals, stmts(kids, bodyStart, size));
+		}
+		case NodeKind::FormalDecl:
+			need(size == 2);
+			return myArena.make<FormalDeclNode>(type(kids[0]), 
+				id(kids[1]));
+		case NodeKind::IntType: return typeNode<IntTypeNode>(n);
+		case NodeKind::IntPtr: return typeNode<IntPtrNode>(n);
+		case NodeKind::BoolType: return typeNode<BoolTypeNode>(n);
+		case NodeKind::BoolPtr: return typeNode<BoolPtrNode>(n);
+		case NodeKind::CharType: return typeNode<CharTypeNode>(n);
+		case NodeKind::CharPtr: return typeNode<CharPtrNode>(n);
+		case NodeKind::VoidType: return typeNode<VoidTypeNode>(n);
+		case NodeKind::AssignStmt:
+			need(size == 1 && is(kids[0], NodeKind::AssignExp));
+			return myArena.make<AssignStmtNode>(
+				exp<AssignExpNode>(kids[0]));
+		case NodeKind::PostDecStmt:
+			need(size == 1);
+			return myArena.make<PostDecStmtNode>(exp<ExpNode>(kids[0]));
+		case NodeKind::PostIncStmt:
+			need(size == 1);
+			return myArena.make<PostIncStmtNode>(exp<ExpNode>(kids[0]));
+		case NodeKind::FromConsoleStmt:
+			need(size == 1);
+			return myArena.make<FromConsoleStmtNode>(lval(kids[0]));
+		case NodeKind::ToConsoleStmt:
+			need(size == 1);
+			return myArena.make<ToConsoleStmtNode>(exp<ExpNode>(kids[0]));
+		case NodeKind::IfStmt:
+			need(size >= 1);
+			return myArena.make<IfStmtNode>(exp<ExpNode>(kids[0]), 
+				stmts(kids, 1, size));
+		case NodeKind::IfElseStmt: {
+			need(size >= 1 && n.value() <= size - 1);
+			size_t elseStart = 1 + n.value();
+			return myArena.make<IfElseStmtNode>(exp<ExpNode>(kids[0]), 
+				stmts(kids, 1, elseStart), stmts(kids, elseStart, size));
+		}
+		case NodeKind::WhileStmt:
+			need(size >= 1);
+			return myArena.make<WhileStmtNode>(exp<ExpNode>(kids[0]), 
+				stmts(kids, 1, size));
+		case NodeKind::ReturnStmt:
+			need(size <= 1);
+			if (size == 0){
+				return myArena.make<ReturnStmtNode>(l, c, true);
+			}
+			return myArena.make<ReturnStmtNode>(exp<ExpNode>(kids[0]), 
+				false);
+		case NodeKind::CallStmt:
+			need(size == 1 && is(kids[0], NodeKind::CallExp));
+			return myArena.make<CallStmtNode>(exp<CallExpNode>(kids[0]));
+		case NodeKind::AssignExp:
+			need(size == 2);
+			return myArena.make<AssignExpNode>(lval(kids[0]), 
+				exp<ExpNode>(kids[1]));
+		case NodeKind::CallExp: {
+			need(size >= 1);
+			auto args = myArena.make<ArenaVector<ExpNode *>>(myArena);
+			for (size_t k = 1; k < size; k++){
+				args->push_back(exp<ExpNode>(kids[k]));
+			}
+			return myArena.make<CallExpNode>(id(kids[0]), args);
+		}
+		case NodeKind::Minus: return binary<MinusNode>(n, kids);
+		case NodeKind::Plus: return binary<PlusNode>(n, kids);
+		case NodeKind::Times: return binary<TimesNode>(n, kids);
+		case NodeKind::Divide: return binary<DivideNode>(n, kids);
+		case NodeKind::And: return binary<AndNode>(n, kids);
+		case NodeKind::Or: return binary<OrNode>(n, kids);
+		case NodeKind::Equals: return binary<EqualsNode>(n, kids);
+		case NodeKind::NotEquals: return binary<NotEqualsNode>(n, kids);
+		case NodeKind::Greater: return binary<GreaterNode>(n, kids);
+		case NodeKind::GreaterEq: return binary<GreaterEqNode>(n, kids);
+		case NodeKind::Less: return binary<LessNode>(n, kids);
+		case NodeKind::LessEq: return binary<LessEqNode>(n, kids);
+		case NodeKind::Not: return unary<NotNode>(n, kids);
+		case NodeKind::Neg: return unary<NegNode>(n, kids);
+		case NodeKind::NullPtr:
+			need(size == 0);
+			return myArena.make<NullPtrNode>(l, c);
+		case NodeKind::IntLit: 
+			need(size == 0);
+			return myArena.make<IntLitNode>(l, c, n.intVal());
+		case NodeKind::StrLit: 
+			need(size == 0);
+			return myArena.make<StrLitNode>(l, c, symbol(n));
+		case NodeKind::CharLit: 
+			need(size == 0);
+			return myArena.make<CharLitNode>(l, c, n.charVal());
+		case NodeKind::True:
+			need(size == 0);
+			return myArena.make<TrueNode>(l, c);
+		case NodeKind::False:
+			need(size == 0);
+			return myArena.make<FalseNode>(l, c);
+		case NodeKind::LVal:
+			need(size == 1);
+			return myArena.make<LValNode>(id(kids[0]));
+		case NodeKind::Deref:
+			need(size == 1);
+			return myArena.make<DerefNode>(id(kids[0]));
+		case NodeKind::Ref:
+			need(size == 1);
+			return myArena.make<RefNode>(id(kids[0]));
+		case NodeKind::Index:
+			need(size == 2);
+			return myArena.make<IndexNode>(id(kids[0]), 
+				exp<ExpNode>(kids[1]));
+		case NodeKind::ID:
+			need(size == 0);
+			return myArena.make<IDNode>(l, c, symbol(n));
+		case NodeKind::NumKinds:
+			break;
+		}
+		badAstFile();
+		return nullptr;
+	}
+
+	Arena& myArena;
+	std::vector<Symbol> mySyms;
+	size_t myFromLine; //0 if nothing is moved
+	size_t myToLine;
+	size_t myFromCol;
+	size_t myToCol;
+	std::vector<Frame> myFrames;
+	std::vector<ASTNode *> myBuilt;
+};
+
+} //End anonymous namespace
+
+ProgramNode * AstFile::build(Arena& arena) const {
+	//Each symbol is interned once, not once per use
+	Builder builder(arena, mySymbols);
+	return builder.program(root());
+}
+
+DeclNode * AstFile::buildDecl(
+	Node n, Arena& arena, size_t line, size_t col
+) const {
+	Builder builder(arena, 0);
+	builder.move(n.line(), n.col(), line, col);
+	return builder.topDecl(n);
+}
+
+} //End namespace holeyc
@@ -0,0 +1,164 @@
+#ifndef HOLEYC_ASTFILE_HPP
+#define HOLEYC_ASTFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "arena.hpp"
+#include "ast.hpp"
+#include "writer.hpp"
+
+namespace holeyc{
+
+/**
+* Builds the binary form of an AST (written by -a). Nodes are added
+* by serialize() (see serialize.cpp), children before parents,
+* and get back the position of their record to hand to their parent.
+**/
+class AstEncoder{
+public:
+	AstEncoder() : myNodes(0), myKindCounts(){}
+
+	/** Add a record for node, whose children have records kids **/
+	uint32_t add(NodeKind kind, ASTNode * node, uint32_t value,
+		std::initializer_list<uint32_t> kids){
+		return add(kind, node, value, kids.begin(), kids.size());
+	}
+	uint32_t add(NodeKind kind, ASTNode * node, uint32_t value,
+		const std::vector<uint32_t>& kids){
+		return add(kind, node, value, kids.data(), kids.size());
+	}
+	uint32_t add(NodeKind kind, ASTNode * node, uint32_t value,
+		const uint32_t * kids, size_t count);
+
+	/** The file's own number for sym **/
+	uint32_t symbol(Symbol sym);
+
+	/** Write the file, with root as its root node **/
+	void write(Writer& out, uint32_t root);
+
+	/** How many nodes of kind have been added **/
+	size_t count(NodeKind kind) const {
+		return myKindCounts[static_cast<size_t>(kind)];
+	}
+
+private:
+	std::vector<uint32_t> myWords;
+	size_t myNodes;
+	size_t myKindCounts[static_cast<size_t>(NodeKind::NumKinds)];
+	std::unordered_map<uint32_t, uint32_t> mySymNums;
+	std::vector<uint32_t> mySymStarts;
+	std::string myStrings;
+};
+
+/**
+* An AST saved in binary, read in place from a buffer such as an
+* mmapped file. There are no pointers: a node is a record of 32-bit
+* native-endian words, and it finds its children by their distance
+* (always backwards) from itself, so the file is usable wherever it
+* is mapped. The layout is:
+*
+*   header   8 x u32: magic "HCAS", version, nodes, record words,
+*            root record, symbols, string bytes, unused
+*   records  per node: kind, line, column, value, child count, and
+*            then the offset of each child, in words, from the start
+*            of this record
+*   symStarts, strings   as in a token file (see tokfile.hpp)
+*
+* Children are in source order. Lists are flattened into the
+* children, and value says where one list stops if a node has two:
+*
+*   Program      decls...
+*   VarDecl      type, id
+*   FnDecl       type, id, formals..., stmts...   value: # formals
+*   FormalDecl   type, id
+*   <types>      -                                value: is a ref
+*   AssignStmt   assignExp        PostDec/PostIncStmt   exp
+*   FromConsole  lval             ToConsoleStmt         exp
+*   IfStmt       exp, stmts...    WhileStmt             exp, stmts...
+*   IfElseStmt   exp, stmts..., stmts...          value: # in then
+*   ReturnStmt   [exp]            CallStmt              callExp
+*   AssignExp    lval, exp        CallExp               id, args...
+*   <binary>     lhs, rhs         Not, Neg              exp
+*   LVal, Deref, Ref   id         Index                 id, exp
+*   ID, StrLit   -                                value: symbol
+*   IntLit, CharLit    -                          value: the value
+*   NullPtr, True, False   -
+**/
+class AstFile{
+public:
+	static const uint32_t MAGIC = 0x53414348; //"HCAS"
+	static const uint32_t VERSION = 1;
+
+	/** A node of the file, used in place **/
+	class Node{
+	public:
+		NodeKind kind() const { return static_cast<NodeKind>(myRec[0]); }
+		size_t line() const { return myRec[1]; }
+		size_t col() const { return myRec[2]; }
+		uint32_t value() const { return myRec[3]; }
+		size_t size() const { return myRec[4]; }
+		Node child(size_t k) const {
+			int32_t rel = static_cast<int32_t>(myRec[HEADER + k]);
+			return Node(myFile, myRec + rel);
+		}
+		int intVal() const { return static_cast<int>(value()); }
+		char charVal() const { return static_cast<char>(value()); }
+		/** The spelling of an ID or StrLit **/
+		const char * text(size_t * len) const {
+			return myFile->symbolText(value(), len);
+		}
+	private:
+		friend class AstFile;
+		static const size_t HEADER = 5;
+		Node(const AstFile * file, const uint32_t * rec)
+		: myFile(file), myRec(rec){}
+
+		const AstFile * myFile;
+		const uint32_t * myRec;
+	};
+
+	/** Whether the size bytes at data start like an AST file **/
+	static bool isAstFile(const char * data, size_t size);
+
+	/** A view of an AST file. Throws if it is malformed **/
+	AstFile(const char * data, size_t size);
+
+	Node root() const { return Node(this, myRecords + myRoot); }
+	size_t nodes() const { return myNodes; }
+	size_t symbols() const { return mySymbols; }
+	const char * symbolText(uint32_t sym, size_t * len) const {
+		*len = mySymStarts[sym + 1] - mySymStarts[sym];
+		return myStrings + mySymStarts[sym];
+	}
+
+	/** 
+	* Rebuild the tree as ordinary nodes in arena, for the passes
+	* that need them
+	**/
+	ProgramNode * build(Arena& arena) const;
+
+	/** 
+	* Rebuild just the declaration n (a child of the root), moved 
+	* to start at line and col
+	**/
+	DeclNode * buildDecl(Node n, Arena& arena, size_t line, size_t col) const;
+
+private:
+	void check() const;
+
+	size_t myNodes;
+	size_t myWords;
+	size_t myRoot;
+	size_t mySymbols;
+	const uint32_t * myRecords;
+	const uint32_t * mySymStarts;
+	const char * myStrings;
+};
+
+} //End namespace holeyc
+
+#endif
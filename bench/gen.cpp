@@ -0,0 +1,365 @@
+/*
+Writes a synthetic, syntactically and type correct HoleyC program 
+of about a given size to stdout, for benchmarking holeycc. The 
+output depends only on the arguments, so runs are comparable.
+The lexical shape is the exception: it is a jumble of tokens, good
+and bad, for checking the scanners against each other. The nested 
+and blocks shapes take a depth in place of a size, and are for 
+checking that nothing goes deeper into the C++ stack as the program
+nests deeper.
+
+Usage: gen <shape> <bytes> [seed]
+  globals   mostly global variable declarations
+  long      a few functions with very long bodies
+  deep      deeply nested expressions and blocks
+  literals  code dominated by int, char and string literals
+  mixed     a bit of everything
+  lexical   tokens and lexical errors in no particular order
+  nested    expressions nested <depth> deep (both ways round), and
+            a chain of <depth> statements
+  blocks    while loops nested <depth> deep
+*/
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+/* xorshift64*: small, fast, and the same everywhere */
+class Rng{
+public:
+	Rng(uint64_t seed) : myState(seed * 2654435761u + 1){}
+	uint64_t next(){
+		myState ^= myState >> 12;
+		myState ^= myState << 25;
+		myState ^= myState >> 27;
+		return myState * 2685821657736338717ull;
+	}
+	size_t below(size_t n){ return static_cast<size_t>(next() % n); }
+	bool chance(size_t percent){ return below(100) < percent; }
+private:
+	uint64_t myState;
+};
+
+class Generator{
+public:
+	Generator(uint64_t seed, size_t depthIn, size_t percentLits)
+	: myRng(seed), myDepth(depthIn), myLitPercent(percentLits), 
+	  myFns(0), myGlobals(0){}
+
+	size_t size() const { return myOut.size(); }
+
+	void flush(){
+		fwrite(myOut.data(), 1, myOut.size(), stdout);
+		myWritten += myOut.size();
+		myOut.clear();
+	}
+
+	size_t written() const { return myWritten + myOut.size(); }
+
+	/* Every program starts with globals its functions can use */
+	void prelude(){
+		for (int k = 0; k < 8; k++){ global(); }
+		myOut += "bool flag;\nchar letter;\ncharptr text;\nintptr cells;\n";
+	}
+
+	void global(){
+		myOut += "int g" + std::to_string(myGlobals++) + ";\n";
+	}
+
+	/* int fN(int a, int b, bool c) { ... return exp; } */
+	void function(size_t stmts){
+		myOut += "int f" + std::to_string(myFns) 
+			+ "(int a, int b, bool c) {\n";
+		myOut += "\tint x;\n\tint y;\n\tchar ch;\n\tbool ok;\n";
+		for (size_t k = 0; k < stmts; k++){ stmt(1, 0); }
+		myOut += "\treturn ";
+		intExp(0);
+		myOut += ";\n}\n";
+		myFns++;
+	}
+
+	/* Tokens, whitespace and lexical errors, every corner of holeyc.l */
+	void noise(){
+		static const char * const FRAGMENTS[] = {
+			"int", "intptr", "bool", "boolptr", "char", "charptr", 
+			"void", "if", "else", "while", "return", "true", "false",
+			"FROMCONSOLE", "TOCONSOLE", "NULLPTR", "intx", "in", "_if",
+			"If", "NULLPTRS", "charptr_", "x9", "_", "a_b_C",
+			"0", "007", "2147483647", "2147483648", "9999999999", 
+			"00000000001", "123456789012345", "12ab",
+			"@", "^", "[", "]", "{", "}", "(", ")", ";", ",", "+", "++",
+			"+++", "-", "--", "*", "/", "!", "!=", "&&", "&", "||", "|",
+			"==", "=", "===", "<", "<=", ">", ">=",
+			"'a", "'\\n", "'\\t", "'\\\\", "'\\\t", "'\\ ", 
+			"'\\", "'\\q", "'\\'", "'\t", "' ", "'\n", "'\r\n",
+			"'\r", "'\\\r", "'\\\n", "'", "''",
+			"\"\"", "\"abc\"", "\"a\\nb\\tc\\'d\\\"e\\\\\"",
+			"\"bad\\qescape\"", "\"unterminated", "\"bad\\q",
+			"\"\\'\\\"\n", "\"a\\qb\\\"c\"d", "\"a\\qb\\\"cd\"",
+			"\"a\\q\\z\"", "\"a\\q\\", "\"end\\", "\"x\\\r\n",
+			"\"tab\tin\"", "\"hash # not a comment\"",
+			" ", "  ", "\t", " \t \t ", "                                 ",
+			"\n", "\r\n", "\r", "# a comment", "#", "#\\ \"' x\r",
+			"$", "~", "`", "?", ":", ".", "\\", "\x01", "\x7f", "\xc3\xa9",
+			"\xff",
+		};
+		const size_t count = sizeof(FRAGMENTS) / sizeof(FRAGMENTS[0]);
+		for (int k = 0; k < 64; k++){
+			myOut += FRAGMENTS[myRng.below(count)];
+			if (myRng.chance(30)){ myOut += ' '; }
+			if (myRng.chance(5)){ myOut += '\n'; }
+		}
+		myOut += '\n';
+	}
+
+	/* One function whose expressions nest depth deep */
+	void nested(size_t depth){
+		myOut += "int f0(int a, bool c) {\n\tint x;\n\tbool ok;\n";
+		//Nested to the right: (1 + (1 + (... + 1)))
+		myOut += "\tx = ";
+		for (size_t k = 0; k < depth; k++){ myOut += "(1 + "; }
+		myOut += "1";
+		myOut.append(depth, ')');
+		//Nested to the left: a - 1 - 1 - ... - 1
+		myOut += ";\n\tx = a";
+		for (size_t k = 0; k < depth; k++){ myOut += " - 1"; }
+		myOut += ";\n\tok = ";
+		myOut.append(depth, '!');
+		myOut += "c;\n";
+		for (size_t k = 0; k < depth; k++){ myOut += "\tx++;\n"; }
+		myOut += "\treturn x;\n}\n";
+	}
+
+	/* 
+	One function whose loops nest depth deep. They are not indented,
+	or the program would grow with the square of the depth.
+	*/
+	void blocks(size_t depth){
+		myOut += "int f0(int a, bool c) {\n\tint x;\n";
+		for (size_t k = 0; k < depth; k++){ myOut += "while (c) {\n"; }
+		myOut += "x++;\n";
+		for (size_t k = 0; k < depth; k++){ myOut += "}\n"; }
+		myOut += "\treturn x;\n}\n";
+	}
+
+private:
+	void indent(size_t level){ myOut.append(level, '\t'); }
+
+	void stmt(size_t level, size_t nest){
+		indent(level);
+		size_t pick = myRng.below(nest + 2 < myDepth ? 12 : 9);
+		switch (pick){
+		case 0: case 1: case 2:
+			myOut += myRng.chance(50) ? "x = " : "y = ";
+			intExp(0);
+			myOut += ";\n";
+			break;
+		case 3:
+			myOut += "ok = ";
+			boolExp(0);
+			myOut += ";\n";
+			break;
+		case 4:
+			myOut += myRng.chance(50) ? "x++;\n" : "y--;\n";
+			break;
+		case 5:
+			myOut += "TOCONSOLE ";
+			if (myRng.chance(myLitPercent)){ strLit(); }
+			else { intExp(0); }
+			myOut += ";\n";
+			break;
+		case 6:
+			myOut += "ch = ";
+			charLit();
+			myOut += ";\n";
+			break;
+		case 7:
+			myOut += "FROMCONSOLE x;\n";
+			break;
+		case 8:
+			myOut += "cells[";
+			intExp(0);
+			myOut += "] = ";
+			intExp(0);
+			myOut += ";\n";
+			break;
+		case 9: case 10: case 11: {
+			const char * head = pick == 11 ? "while (" : "if (";
+			myOut += head;
+			boolExp(0);
+			myOut += ") {\n";
+			size_t body = 1 + myRng.below(3);
+			for (size_t k = 0; k < body; k++){ stmt(level + 1, nest + 1); }
+			indent(level);
+			if (pick == 10){
+				myOut += "} else {\n";
+				for (size_t k = 0; k < body; k++){ 
+					stmt(level + 1, nest + 1); 
+				}
+				indent(level);
+			}
+			myOut += "}\n";
+			break;
+		}
+		}
+	}
+
+	void intExp(size_t depth){
+		//Deep programs rarely stop early
+		size_t stop = myDepth > 8 ? 2 : 35;
+		if (depth >= myDepth || myRng.chance(depth == 0 ? 10 : stop)){
+			intTerm();
+			return;
+		}
+		static const char * ops[] = { " + ", " - ", " * ", " / " };
+		bool paren = myRng.chance(40);
+		if (paren){ myOut += "("; }
+		//Past a few levels only one side goes deeper, so that the
+		//size grows with the depth rather than exponentially
+		bool wide = depth < 3;
+		bool leftDeep = myRng.chance(50);
+		if (wide || leftDeep){ intExp(depth + 1); } else { intTerm(); }
+		myOut += ops[myRng.below(4)];
+		if (wide || !leftDeep){ intExp(depth + 1); } else { intTerm(); }
+		if (paren){ myOut += ")"; }
+	}
+
+	void intTerm(){
+		if (myRng.chance(myLitPercent)){
+			myOut += std::to_string(myRng.below(100000));
+			return;
+		}
+		switch (myRng.below(6)){
+		case 0: myOut += "a"; break;
+		case 1: myOut += "b"; break;
+		case 2: myOut += "x"; break;
+		case 3: myOut += "@cells"; break;
+		case 4:
+			if (myFns > 0){
+				myOut += "f" + std::to_string(myRng.below(myFns)) + "(";
+				myOut += "x, " + std::to_string(myRng.below(10)) 
+					+ ", ok)";
+				break;
+			}
+			myOut += "y";
+			break;
+		default: 
+			myOut += "g" + std::to_string(myRng.below(myGlobals)); 
+			break;
+		}
+	}
+
+	void boolExp(size_t depth){
+		if (depth + 1 >= myDepth || myRng.chance(30)){
+			static const char * cmps[] = { 
+				" < ", " <= ", " > ", " >= ", " == ", " != " 
+			};
+			intExp(myDepth > 2 ? myDepth - 2 : 0);
+			myOut += cmps[myRng.below(6)];
+			intExp(myDepth > 2 ? myDepth - 2 : 0);
+			return;
+		}
+		switch (myRng.below(5)){
+		case 0: myOut += myRng.chance(50) ? "true" : "false"; return;
+		case 1: myOut += "c"; return;
+		case 2: 
+			myOut += "!";
+			myOut += myRng.chance(50) ? "ok" : "flag";
+			return;
+		default: break;
+		}
+		myOut += "(";
+		boolExp(depth + 1);
+		myOut += myRng.chance(50) ? " && " : " || ";
+		boolExp(depth + 1);
+		myOut += ")";
+	}
+
+	void charLit(){
+		static const char * specials[] = { "'\\n", "'\\t", "'\\\\" };
+		if (myRng.chance(10)){
+			myOut += specials[myRng.below(3)];
+			return;
+		}
+		myOut += '\'';
+		myOut += static_cast<char>('a' + myRng.below(26));
+	}
+
+	void strLit(){
+		size_t len = 4 + myRng.below(40);
+		myOut += '"';
+		for (size_t k = 0; k < len; k++){
+			if (myRng.chance(5)){ 
+				myOut += myRng.chance(50) ? "\\n" : "\\\""; 
+				continue;
+			}
+			myOut += static_cast<char>(" abcdefghijklmnopqrstuvwxyz"[myRng.below(27)]);
+		}
+		myOut += '"';
+	}
+
+	Rng myRng;
+	size_t myDepth;
+	size_t myLitPercent;
+	size_t myFns;
+	size_t myGlobals;
+	size_t myWritten = 0;
+	std::string myOut;
+};
+
+static void usage(){
+	fprintf(stderr, "Usage: gen globals|long|deep|literals|mixed|lexical"
+		" <bytes> [seed]\n       gen nested|blocks <depth>\n");
+	exit(1);
+}
+
+int main(int argc, char ** argv){
+	if (argc < 3){ usage(); }
+	std::string shape = argv[1];
+	size_t target = strtoull(argv[2], nullptr, 10);
+	uint64_t seed = argc > 3 ? strtoull(argv[3], nullptr, 10) : 665;
+
+	size_t depth = 4;
+	size_t lits = 30;
+	size_t stmtsPerFn = 20;
+	size_t globalsPerFn = 1;
+	if (shape == "globals"){
+		globalsPerFn = 200;
+		stmtsPerFn = 5;
+	} else if (shape == "long"){
+		stmtsPerFn = 2000;
+		globalsPerFn = 0;
+	} else if (shape == "deep"){
+		depth = 200;
+		stmtsPerFn = 10;
+	} else if (shape == "literals"){
+		lits = 90;
+	} else if (shape == "lexical"){
+		Generator gen(seed, depth, lits);
+		while (gen.written() < target){
+			gen.noise();
+			if (gen.size() > (1 << 20)){ gen.flush(); }
+		}
+		gen.flush();
+		return 0;
+	} else if (shape == "nested" || shape == "blocks"){
+		Generator gen(seed, depth, lits);
+		if (shape == "nested"){ gen.nested(target); }
+		else { gen.blocks(target); }
+		gen.flush();
+		return 0;
+	} else if (shape != "mixed"){
+		usage();
+	}
+
+	Generator gen(seed, depth, lits);
+	gen.prelude();
+	while (gen.written() < target){
+		for (size_t k = 0; k < globalsPerFn; k++){ gen.global(); }
+		gen.function(stmtsPerFn);
+		if (gen.size() > (1 << 20)){ gen.flush(); }
+	}
+	gen.flush();
+	return 0;
+}
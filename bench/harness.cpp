@@ -0,0 +1,174 @@
+/*
+Times holeycc on each given input and prints the results as JSON.
+
+Usage: harness <holeycc> <input>...
+
+Each input is lexed, parsed and unparsed by holeycc --stats, REPEAT
+times, and the run with the least total wall time is reported. The
+phase times, token and node counts and peak RSS are the ones that
+run printed; the peak RSS of each phase is the process's by the
+end of that phase.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static const int REPEAT = 3;
+
+struct PhaseStats{
+	double wall = 0;
+	double cpu = 0;
+	long peakRssKb = 0;
+};
+
+struct RunStats{
+	PhaseStats lex;
+	PhaseStats parse;
+	PhaseStats unparse;
+	double total = 0;
+	unsigned long tokens = 0;
+	unsigned long nodes = 0;
+	long peakRssKb = 0;
+};
+
+/* Run holeycc with args and return what it wrote to stderr */
+static std::string runOnce(const std::string& holeycc, 
+	const std::vector<std::string>& args){
+	int pipeFds[2];
+	if (pipe(pipeFds) != 0){ perror("pipe"); exit(1); }
+	pid_t pid = fork();
+	if (pid < 0){ perror("fork"); exit(1); }
+	if (pid == 0){
+		int devNull = open("/dev/null", O_WRONLY);
+		dup2(devNull, STDOUT_FILENO);
+		dup2(pipeFds[1], STDERR_FILENO);
+		close(pipeFds[0]);
+		std::vector<char *> argv;
+		argv.push_back(const_cast<char *>(holeycc.c_str()));
+		for (const std::string& arg : args){
+			argv.push_back(const_cast<char *>(arg.c_str()));
+		}
+		argv.push_back(nullptr);
+		execv(holeycc.c_str(), argv.data());
+		_exit(127);
+	}
+	close(pipeFds[1]);
+	std::string err;
+	char buf[4096];
+	ssize_t got;
+	while ((got = read(pipeFds[0], buf, sizeof(buf))) > 0){
+		err.append(buf, static_cast<size_t>(got));
+	}
+	close(pipeFds[0]);
+	int status;
+	if (waitpid(pid, &status, 0) < 0){ perror("waitpid"); exit(1); }
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+		fprintf(stderr, "holeycc failed:\n%s", err.c_str());
+		exit(1);
+	}
+	return err;
+}
+
+/* Pick the numbers out of the summary printed by --stats */
+static RunStats parseStats(const std::string& text){
+	RunStats res;
+	size_t pos = 0;
+	while (pos < text.size()){
+		size_t end = text.find('\n', pos);
+		if (end == std::string::npos){ end = text.size(); }
+		std::string line = text.substr(pos, end - pos);
+		pos = end + 1;
+		char name[32];
+		double wall, cpu;
+		long long heapKb;
+		long rssKb;
+		if (sscanf(line.c_str(), "%31s %lf %lf %lld %ld", name, &wall, &cpu,
+			&heapKb, &rssKb) == 5){
+			PhaseStats phase;
+			phase.wall = wall;
+			phase.cpu = cpu;
+			phase.peakRssKb = rssKb;
+			if (strcmp(name, "lex") == 0){ res.lex = phase; }
+			else if (strcmp(name, "parse") == 0){ res.parse = phase; }
+			else if (strcmp(name, "unparse") == 0){ res.unparse = phase; }
+			else if (strcmp(name, "total") == 0){ res.total = wall; }
+			continue;
+		}
+		sscanf(line.c_str(), "tokens %lu", &res.tokens);
+		sscanf(line.c_str(), "nodes %lu", &res.nodes);
+		sscanf(line.c_str(), "peak RSS %ld", &res.peakRssKb);
+	}
+	if (res.nodes == 0){
+		fprintf(stderr, "no stats from holeycc (did the input parse?)\n");
+		exit(1);
+	}
+	return res;
+}
+
+static size_t fileSize(const std::string& path){
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0){
+		fprintf(stderr, "missing %s\n", path.c_str());
+		exit(1);
+	}
+	return static_cast<size_t>(info.st_size);
+}
+
+/* A phase's rate of work, never dividing by 0 */
+static double rate(double amount, double seconds){
+	return amount / (seconds > 1e-9 ? seconds : 1e-9);
+}
+
+static void printPhase(const char * name, const PhaseStats& phase,
+	const char * rateName, double rateVal, bool last){
+	printf("      \"%s\": { \"seconds\": %.6f, \"cpu_seconds\": %.6f, "
+		"\"%s\": %.3f, \"peak_rss_kb\": %ld }%s\n", name, phase.wall,
+		phase.cpu, rateName, rateVal, phase.peakRssKb, last ? "" : ",");
+}
+
+int main(int argc, char ** argv){
+	if (argc < 3){
+		fprintf(stderr, "Usage: harness <holeycc> <input>...\n");
+		return 1;
+	}
+	std::string holeycc = argv[1];
+
+	printf("{\n  \"holeycc\": \"%s\",\n  \"repeat\": %d,\n", 
+		holeycc.c_str(), REPEAT);
+	printf("  \"inputs\": [\n");
+	for (int i = 2; i < argc; i++){
+		std::string input = argv[i];
+		std::string unpFile = input + ".bench.unp";
+		RunStats best;
+		for (int k = 0; k < REPEAT; k++){
+			RunStats run = parseStats(runOnce(holeycc, 
+				{input, "-u", unpFile, "--stats"}));
+			if (k == 0 || run.total < best.total){ best = run; }
+		}
+		size_t unparsed = fileSize(unpFile);
+		unlink(unpFile.c_str());
+
+		printf("    {\n");
+		printf("      \"input\": \"%s\",\n", input.c_str());
+		printf("      \"bytes\": %zu,\n", fileSize(input));
+		printf("      \"tokens\": %lu,\n", best.tokens);
+		printf("      \"nodes\": %lu,\n", best.nodes);
+		printf("      \"unparse_bytes\": %zu,\n", unparsed);
+		printf("      \"peak_rss_kb\": %ld,\n", best.peakRssKb);
+		printPhase("scan", best.lex, "tokens_per_sec", 
+			rate(best.tokens, best.lex.wall), false);
+		printPhase("parse", best.parse, "nodes_per_sec", 
+			rate(best.nodes, best.parse.wall), false);
+		printPhase("unparse", best.unparse, "mb_per_sec", 
+			rate(unparsed / 1e6, best.unparse.wall), true);
+		printf("    }%s\n", i + 1 < argc ? "," : "");
+	}
+	printf("  ]\n}\n");
+	return 0;
+}
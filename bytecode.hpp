@@ -0,0 +1,117 @@
+#ifndef HOLEYC_BYTECODE_HPP
+#define HOLEYC_BYTECODE_HPP
+
+#include <cstdint>
+#include <istream>
+#include <vector>
+#include "ast.hpp"
+
+namespace holeyc{
+
+/*
+Every opcode, in order, for the enum and for the interpreter's jump
+table. In the comments, R is the current function's registers, M
+the memory that pointers point into, fp where the function's
+memory starts, and K an immediate operand. Ints wrap at 32 bits.
+*/
+#define HOLEYC_OPS(X) \
+	X(MOVE)   /* R[a] = R[b] */ \
+	X(LOADK)  /* R[a] = K(b) */ \
+	X(LOADA)  /* R[a] = the address of M[b] */ \
+	X(LOADG)  /* R[a] = M[b] */ \
+	X(STOREG) /* M[a] = R[b] */ \
+	X(LOADF)  /* R[a] = M[fp + b] */ \
+	X(STOREF) /* M[fp + a] = R[b] */ \
+	X(ADDRF)  /* R[a] = fp + b */ \
+	X(LOADP)  /* R[a] = M[R[b]] */ \
+	X(STOREP) /* M[R[a]] = R[b] */ \
+	X(LOADX)  /* R[a] = M[R[b] + R[c]] */ \
+	X(STOREX) /* M[R[a] + R[b]] = R[c] */ \
+	X(ADD)    /* R[a] = R[b] + R[c] */ \
+	X(SUB) X(MUL) X(DIV) \
+	X(ADDK)   /* R[a] = R[b] + K(c) */ \
+	X(MULK) X(DIVK) \
+	X(RSUBK)  /* R[a] = K(c) - R[b] */ \
+	X(NEG)    /* R[a] = -R[b] */ \
+	X(NOT)    /* R[a] = !R[b] */ \
+	X(INC)    /* R[a] = R[a] + 1 */ \
+	X(DEC) \
+	X(EQ)     /* R[a] = R[b] == R[c] */ \
+	X(NE) X(LT) X(LE) \
+	X(EQK)    /* R[a] = R[b] == K(c) */ \
+	X(NEK) X(LTK) X(LEK) X(GTK) X(GEK) \
+	X(JMP)    /* go to a */ \
+	X(JT)     /* if R[b], go to a */ \
+	X(JF)     /* if !R[b], go to a */ \
+	X(JEQ)    /* if R[b] == R[c], go to a */ \
+	X(JNE) X(JLT) X(JLE) \
+	X(JEQK)   /* if R[b] == K(c), go to a */ \
+	X(JNEK) X(JLTK) X(JLEK) X(JGTK) X(JGEK) \
+	X(CALL)   /* call function a, whose registers start at R[b] */ \
+	X(RET)    /* return R[a], into the caller's R[b] of the CALL */ \
+	X(RETV)   /* return from a void function */ \
+	X(WRITEI) /* put out R[a] as an int */ \
+	X(WRITEB) X(WRITEC) \
+	X(WRITES) /* put out the chars at M[R[a]], up to a 0 */ \
+	X(READI)  /* R[a] = an int read from the console */ \
+	X(READB) X(READC)
+
+#define HOLEYC_OP_ENUM(name) name,
+/** What an instruction does (see HOLEYC_OPS) **/
+enum class Op : uint8_t { HOLEYC_OPS(HOLEYC_OP_ENUM) NUM_OPS };
+#undef HOLEYC_OP_ENUM
+
+/**
+* One instruction of register bytecode. Registers are numbered from
+* the start of the running function's own, so a call just moves
+* the window to where the caller put the arguments.
+**/
+struct Instr{
+	Op op;
+	int32_t a;
+	int32_t b;
+	int32_t c;
+};
+
+/**
+* A whole program, lowered from its AST (see lower.cpp), ready to be
+* run by runBytecode (see vm.cpp)
+**/
+struct Bytecode{
+	struct Function{
+		uint32_t entry; //index of the first instruction
+		uint32_t params; //passed in the first registers
+		uint32_t locals; //registers, params included, that start at 0
+		uint32_t regs; //registers in all, temporaries included
+		uint32_t cells; //memory for locals whose address is taken
+	};
+
+	std::vector<Instr> code;
+	//Where in the source each instruction came from, for errors
+	std::vector<uint32_t> lines;
+	std::vector<uint32_t> cols;
+	std::vector<Function> fns;
+	//What memory starts out as: 0 (where NULLPTR points), then the
+	// globals, then the chars of each string literal
+	std::vector<int64_t> statics;
+	uint32_t main;
+};
+
+/**
+* Lower program, whose names and types have been checked, to out.
+* Returns false, having reported why, if it cannot be run.
+**/
+bool lowerProgram(ProgramNode * program, Bytecode& out);
+
+/**
+* Run code's main, reading console input from in and writing console
+* output to Report::out(). Returns what main returns (0 if it is
+* void), or 1 if the program fails at run time, having reported
+* why. The number of instructions run is added to executed.
+**/
+int runBytecode(const Bytecode& code, std::istream& in,
+	uint64_t& executed);
+
+} //End namespace holeyc
+
+#endif
@@ -0,0 +1,206 @@
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "buildstamp.hh"
+#include "cache.hpp"
+#include "errors.hpp"
+#include "hash.hpp"
+#include "source.hpp"
+#include "writer.hpp"
+
+namespace holeyc{
+
+/* 
+Part of every key. The build stamp (see the makefile) is a checksum
+of every source, so that an entry is only ever replayed by a build
+of holeycc from the same sources as the one that made it.
+*/
+static const char VERSION[] = "holeycc-p3 " HOLEYC_BUILD;
+
+/*
+An entry is a header of MAGIC, FORMAT, the exit status, the number of
+chunks and the sizes of the flags and the input; then the flags and
+the input; then each chunk, as its target, its size and its data.
+*/
+static const uint32_t MAGIC = 0x45434348; //"HCCE"
+static const uint32_t FORMAT = 2;
+static const size_t HEADER_WORDS = 6;
+
+/* Records what is written to a stream, then passes it on */
+class CacheEntry::TeeBuf : public std::streambuf{
+public:
+	TeeBuf(CacheEntry& entryIn, Target targetIn, std::ostream& destIn)
+	: myEntry(entryIn), myTarget(targetIn), myDest(destIn){}
+protected:
+	std::streamsize xsputn(const char * data, std::streamsize len) override {
+		myEntry.add(myTarget, data, static_cast<size_t>(len));
+		myDest.write(data, len);
+		return len;
+	}
+	int_type overflow(int_type ch) override {
+		if (traits_type::eq_int_type(ch, traits_type::eof())){ 
+			return traits_type::not_eof(ch); 
+		}
+		char c = traits_type::to_char_type(ch);
+		xsputn(&c, 1);
+		return ch;
+	}
+	int sync() override {
+		myDest.flush();
+		return 0;
+	}
+private:
+	CacheEntry& myEntry;
+	Target myTarget;
+	std::ostream& myDest;
+};
+
+CacheEntry::CacheEntry(std::ostream& out, std::ostream& err)
+: myStatus(0), mySpoiled(false),
+  myOutBuf(new TeeBuf(*this, OUT, out)),
+  myErrBuf(new TeeBuf(*this, ERR, err)),
+  myOut(new std::ostream(myOutBuf.get())),
+  myErr(new std::ostream(myErrBuf.get())){
+}
+
+CacheEntry::CacheEntry() : myStatus(0), mySpoiled(false){}
+
+CacheEntry::~CacheEntry(){}
+
+void CacheEntry::add(Target target, const char * data, size_t len){
+	//Console text comes in many small writes; keep them together
+	bool console = target == OUT || target == ERR;
+	if (console && !myChunks.empty() && myChunks.back().target == target){
+		myChunks.back().data.append(data, len);
+		return;
+	}
+	myChunks.push_back(Chunk{target, std::string(data, len)});
+}
+
+CompileCache::CompileCache(const char * dirIn) : myDir(dirIn){
+	if (mkdir(dirIn, 0777) != 0 && errno != EEXIST){
+		std::string msg = "Bad cache directory ";
+		msg += dirIn;
+		throw new InternalError(msg.c_str());
+	}
+}
+
+CompileCache::Key CompileCache::key(const char * data, size_t size, 
+	const std::string& flags){
+	Key key{"", VERSION, data, size};
+	key.flags += '\n';
+	key.flags += flags;
+	Hash64 hash;
+	hash.add(key.flags.data(), key.flags.size());
+	hash.add(data, size);
+	char name[64];
+	snprintf(name, sizeof(name), "%016llx-%llx", 
+		static_cast<unsigned long long>(hash.value()), 
+		static_cast<unsigned long long>(size));
+	key.name = name;
+	return key;
+}
+
+std::string CompileCache::path(const Key& key) const {
+	return myDir + "/" + key.name;
+}
+
+bool CompileCache::load(const Key& key, CacheEntry& entry) const {
+	std::string entryPath = path(key);
+	std::unique_ptr<SourceFile> file;
+	try {
+		file.reset(new SourceFile(entryPath.c_str()));
+	} catch (InternalError * e){
+		//Not cached yet
+		delete e;
+		return false;
+	}
+
+	const char * pos = file->data();
+	const char * end = pos + file->size();
+	uint32_t header[HEADER_WORDS];
+	if (file->size() < sizeof(header)){ return false; }
+	memcpy(header, pos, sizeof(header));
+	pos += sizeof(header);
+	if (header[0] != MAGIC || header[1] != FORMAT){ return false; }
+
+	//Only a hash names the entry, so it may be for another input
+	if (header[4] != key.flags.size() || header[5] != key.size){ 
+		return false; 
+	}
+	if (static_cast<size_t>(end - pos) < key.flags.size() + key.size){ 
+		return false; 
+	}
+	if (memcmp(pos, key.flags.data(), key.flags.size()) != 0){ 
+		return false; 
+	}
+	pos += key.flags.size();
+	if (key.size != 0 && memcmp(pos, key.data, key.size) != 0){ 
+		return false; 
+	}
+	pos += key.size;
+
+	std::vector<CacheEntry::Chunk> chunks;
+	for (uint32_t k = 0; k < header[3]; k++){
+		uint32_t chunkHeader[2];
+		if (static_cast<size_t>(end - pos) < sizeof(chunkHeader)){ 
+			return false; 
+		}
+		memcpy(chunkHeader, pos, sizeof(chunkHeader));
+		pos += sizeof(chunkHeader);
+		if (chunkHeader[0] >= CacheEntry::NUM_TARGETS){ return false; }
+		if (static_cast<size_t>(end - pos) < chunkHeader[1]){ return false; }
+		CacheEntry::Target target = 
+			static_cast<CacheEntry::Target>(chunkHeader[0]);
+		entry.add(target, pos, chunkHeader[1]);
+		pos += chunkHeader[1];
+	}
+	entry.setStatus(static_cast<int>(header[2]));
+	return true;
+}
+
+void CompileCache::store(const Key& key, const CacheEntry& entry) const {
+	if (entry.spoiled()){ return; }
+
+	//Unique among every process and thread sharing the directory
+	static std::atomic<unsigned int> counter(0);
+	char tmpName[64];
+	snprintf(tmpName, sizeof(tmpName), "/.tmp-%ld-%u", 
+		static_cast<long>(getpid()), counter.fetch_add(1));
+	std::string tmpPath = myDir + tmpName;
+
+	try {
+		Writer out(tmpPath.c_str());
+		uint32_t header[HEADER_WORDS] = {
+			MAGIC, FORMAT, static_cast<uint32_t>(entry.status()),
+			static_cast<uint32_t>(entry.chunks().size()),
+			static_cast<uint32_t>(key.flags.size()),
+			static_cast<uint32_t>(key.size)
+		};
+		out.write(reinterpret_cast<const char *>(header), sizeof(header));
+		out << key.flags;
+		if (key.size != 0){ out.write(key.data, key.size); }
+		for (const CacheEntry::Chunk& chunk : entry.chunks()){
+			uint32_t chunkHeader[2] = {
+				chunk.target, static_cast<uint32_t>(chunk.data.size())
+			};
+			out.write(reinterpret_cast<const char *>(chunkHeader), 
+				sizeof(chunkHeader));
+			out << chunk.data;
+		}
+		out.flush();
+	} catch (InternalError * e){
+		//The cache is only an optimization
+		delete e;
+		unlink(tmpPath.c_str());
+		return;
+	}
+	if (rename(tmpPath.c_str(), path(key).c_str()) != 0){
+		unlink(tmpPath.c_str());
+	}
+}
+
+} //End namespace holeyc
@@ -0,0 +1,107 @@
+#ifndef HOLEYC_CACHE_HPP
+#define HOLEYC_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace holeyc{
+
+/**
+* Everything one compilation put out, in order: what it wrote to
+* stdout and stderr and the contents of each output file, so that 
+* it can be replayed exactly. Files are recorded by their role 
+* rather than their path.
+**/
+class CacheEntry{
+public:
+	enum Target : uint32_t {
+		OUT, ERR, TOKENS, TOKEN_BIN, AST, UNPARSE, NAMES, NUM_TARGETS
+	};
+
+	struct Chunk{
+		Target target;
+		std::string data;
+	};
+
+	/** 
+	* Record the console output sent to the returned streams, 
+	* which also pass it on to out and err
+	**/
+	CacheEntry(std::ostream& out, std::ostream& err);
+	CacheEntry();
+	~CacheEntry();
+
+	std::ostream& out(){ return *myOut; }
+	std::ostream& err(){ return *myErr; }
+
+	void add(Target target, const char * data, size_t len);
+	const std::vector<Chunk>& chunks() const { return myChunks; }
+
+	int status() const { return myStatus; }
+	void setStatus(int statusIn){ myStatus = statusIn; }
+
+	/** 
+	* Whether the output depends on more than the input and flags
+	* (e.g. an output file could not be opened), so it must not be
+	* replayed
+	**/
+	bool spoiled() const { return mySpoiled; }
+	void spoil(){ mySpoiled = true; }
+
+private:
+	class TeeBuf;
+
+	std::vector<Chunk> myChunks;
+	int myStatus;
+	bool mySpoiled;
+	std::unique_ptr<TeeBuf> myOutBuf;
+	std::unique_ptr<TeeBuf> myErrBuf;
+	std::unique_ptr<std::ostream> myOut;
+	std::unique_ptr<std::ostream> myErr;
+};
+
+/**
+* A directory of earlier compilations (-C), named by a hash of the
+* input bytes, the flags that affect the output and the build of
+* holeycc. An entry also keeps the input and flags themselves, and is
+* only replayed if they are the same, so inputs whose hashes collide
+* never get each other's output. Entries are written to a temporary
+* file and renamed into place, so any number of holeycc processes can
+* share a directory and never see half an entry.
+**/
+class CompileCache{
+public:
+	/** What an entry is the compilation of **/
+	struct Key{
+		std::string name; //of the entry's file: a hash of the rest
+		std::string flags; //with the build of holeycc
+		const char * data;
+		size_t size;
+	};
+
+	CompileCache(const char * dirIn);
+
+	/** The key for compiling these bytes with these flags **/
+	static Key key(const char * data, size_t size, 
+		const std::string& flags);
+
+	/** Fill entry from the cache; false if there is no such entry **/
+	bool load(const Key& key, CacheEntry& entry) const;
+
+	/** Save entry, unless it is spoiled **/
+	void store(const Key& key, const CacheEntry& entry) const;
+
+private:
+	std::string path(const Key& key) const;
+
+	std::string myDir;
+};
+
+} //End namespace holeyc
+
+#endif
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <utility>
+#include "diagnostics.hpp"
+#include "errors.hpp"
+
+namespace holeyc{
+
+static Diagnostics *& currentDiags(){
+	static thread_local Diagnostics * diags = nullptr;
+	return diags;
+}
+
+Diagnostics::Diagnostics(std::ostream * outIn, size_t maxErrorsIn)
+: myOut(outIn), myMaxErrors(maxErrorsIn), myErrors(0), myShown(0),
+  myHidden(0), myPrev(currentDiags()){
+	currentDiags() = this;
+}
+
+Diagnostics::~Diagnostics(){
+	flush();
+	currentDiags() = myPrev;
+}
+
+void Diagnostics::report(Severity severity, size_t l, size_t c,
+	const std::string& msg){
+	//Nothing comes after [l,c] and before itself
+	add(Diagnostic{severity, l, c, l, c, msg});
+}
+
+void Diagnostics::reportSyntax(size_t l, size_t c, size_t fromL,
+	size_t fromC, const std::string& msg){
+	add(Diagnostic{FATAL, l, c, fromL, fromC, msg});
+}
+
+void Diagnostics::add(const Diagnostic& diag){
+	Diagnostics * diags = currentDiags();
+	if (diags == nullptr){
+		std::string text;
+		format(text, diag);
+		Report::err() << text << std::flush;
+		return;
+	}
+	if (diag.severity == FATAL){ diags->myErrors++; }
+	diags->myDiags.push_back(diag);
+}
+
+Diagnostics * Diagnostics::current(){
+	return currentDiags();
+}
+
+void Diagnostics::moveTo(Diagnostics& other){
+	for (Diagnostic& diag : myDiags){
+		other.myDiags.push_back(std::move(diag));
+	}
+	other.myErrors += myErrors;
+	myErrors = 0;
+	myDiags.clear();
+}
+
+void Diagnostics::format(std::string& out, const Diagnostic& diag){
+	out += diag.severity == FATAL ? "FATAL [" : "*WARNING* [";
+	out += std::to_string(diag.line);
+	out += ",";
+	out += std::to_string(diag.col);
+	out += "]: ";
+	out += diag.msg;
+	out += "\n";
+}
+
+/*
+Whether sorted diagnostic i says the same as one before it at the
+same position
+*/
+bool Diagnostics::isRepeat(size_t i) const {
+	const Diagnostic& diag = myDiags[i];
+	for (size_t k = i; k > 0; k--){
+		const Diagnostic& prev = myDiags[k - 1];
+		if (prev.line != diag.line || prev.col != diag.col){ break; }
+		if (prev.severity == diag.severity && prev.msg == diag.msg){
+			return true;
+		}
+	}
+	return false;
+}
+
+void Diagnostics::flush(){
+	if (myOut == nullptr){
+		myDiags.clear();
+		return;
+	}
+	if (myDiags.empty() && myHidden == 0){ return; }
+
+	//Stable, so that what is reported first at a position stays first
+	std::stable_sort(myDiags.begin(), myDiags.end(),
+		[](const Diagnostic& a, const Diagnostic& b){
+			if (a.line != b.line){ return a.line < b.line; }
+			return a.col < b.col;
+		});
+
+	std::string text;
+	const Diagnostic * lastError = nullptr;
+	for (size_t i = 0; i < myDiags.size(); i++){
+		const Diagnostic& diag = myDiags[i];
+		if (isRepeat(i)){ continue; }
+		if (diag.severity == FATAL){
+			bool followOn = lastError != nullptr
+				&& (lastError->line > diag.fromLine
+				|| (lastError->line == diag.fromLine
+				&& lastError->col > diag.fromCol));
+			lastError = &diag;
+			if (followOn){ continue; }
+			if (myMaxErrors != 0 && myShown == myMaxErrors){
+				myHidden++;
+				continue;
+			}
+			myShown++;
+		}
+		format(text, diag);
+	}
+	if (myHidden != 0){
+		text += "Too many errors: " + std::to_string(myHidden)
+			+ " more not shown\n";
+		myHidden = 0;
+	}
+	myDiags.clear();
+	*myOut << text << std::flush;
+}
+
+} //End namespace holeyc
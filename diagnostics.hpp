@@ -0,0 +1,88 @@
+#ifndef HOLEYC_DIAGNOSTICS_HPP
+#define HOLEYC_DIAGNOSTICS_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace holeyc{
+
+/**
+* Collects the errors and warnings reported (through Report::fatal
+* and Report::warn) on one thread while it is alive, instead of
+* letting each one be written as it happens. On flush they are
+* sorted by position, repeats (the same message again at the same
+* position) and syntax errors that follow on from an earlier error
+* (see reportSyntax) are dropped, at most maxErrors errors are kept,
+* and the lot is written to the output in one go.
+*
+* Diagnostics nest: the newest one on a thread gets the reports, and
+* reports made with none alive are written straight to Report::err().
+**/
+class Diagnostics{
+public:
+	enum Severity{ FATAL, WARN };
+
+	/**
+	* Collect until destroyed, then flush to out, or drop everything
+	* if out is null. A maxErrors of 0 means no limit.
+	**/
+	Diagnostics(std::ostream * outIn, size_t maxErrorsIn);
+	Diagnostics(const Diagnostics&) = delete;
+	~Diagnostics();
+
+	/** Report to the current thread's Diagnostics, if any **/
+	static void report(Severity severity, size_t l, size_t c,
+		const std::string& msg);
+
+	/**
+	* Report a syntax error at [l,c], in a statement that starts
+	* after [fromL,fromC]. If another error comes between the two,
+	* this one is taken to be the parser's recovery from it, e.g. a
+	* token left over from an illegal character, and is dropped.
+	**/
+	static void reportSyntax(size_t l, size_t c, size_t fromL,
+		size_t fromC, const std::string& msg);
+
+	/** The current thread's newest Diagnostics, or null **/
+	static Diagnostics * current();
+
+	/**
+	* Hand what has been collected so far over to other, e.g. that
+	* of the thread that shared out the work this thread is doing.
+	* Nothing else may be using other meanwhile.
+	**/
+	void moveTo(Diagnostics& other);
+
+	/** How many errors have been reported here, shown or not **/
+	size_t errors() const { return myErrors; }
+
+	/** Write out (and forget) what has been collected so far **/
+	void flush();
+private:
+	struct Diagnostic{
+		Severity severity;
+		size_t line;
+		size_t col;
+		size_t fromLine; //an error after here makes this a follow-on
+		size_t fromCol;
+		std::string msg;
+	};
+
+	static void add(const Diagnostic& diag);
+	static void format(std::string& out, const Diagnostic& diag);
+	bool isRepeat(size_t i) const;
+
+	std::ostream * myOut;
+	size_t myMaxErrors;
+	size_t myErrors;
+	size_t myShown;
+	size_t myHidden;
+	std::vector<Diagnostic> myDiags;
+	Diagnostics * myPrev;
+};
+
+} //End namespace holeyc
+
+#endif
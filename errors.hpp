@@ -7,6 +7,7 @@
 #define TODO(x) throw new ToDoError(CODELOC #x);
 
 #include <iostream>
+#include "diagnostics.hpp"
 
 namespace holeyc{
 
@@ -28,13 +29,30 @@ private:
 
 class Report{
 public:
+	/**
+	* The streams the current thread reports to. They are std::cout
+	* and std::cerr unless redirected, which batch compilation does
+	* so that each input's output can be collected separately.
+	**/
+	static std::ostream& out(){ return *outStream(); }
+	static std::ostream& err(){ return *errStream(); }
+
+	static void redirect(std::ostream * outIn, std::ostream * errIn){
+		outStream() = outIn;
+		errStream() = errIn;
+	}
+
+	/**
+	* Report an error or a warning at [l,c]. The thread's current
+	* Diagnostics holds on to it, or if there is none it is written
+	* out right away.
+	**/
 	static void fatal(
 		size_t l, 
 		size_t c, 
 		const char * msg
 	){
-		std::cerr << "FATAL [" << l << "," << c << "]: " 
-		<< msg  << std::endl;
+		Diagnostics::report(Diagnostics::FATAL, l, c, msg);
 	}
 
 	static void fatal(
@@ -50,8 +68,7 @@ public:
 		size_t c,
 		const char * msg
 	){
-		std::cerr << "*WARNING* [" << l << "," << c << "]: " 
-		<< msg  << std::endl;
+		Diagnostics::report(Diagnostics::WARN, l, c, msg);
 	}
 
 	static void warn(
@@ -61,6 +78,17 @@ public:
 	){
 		warn(l,c,msg.c_str());
 	}
+
+private:
+	static std::ostream *& outStream(){
+		static thread_local std::ostream * stream = &std::cout;
+		return stream;
+	}
+
+	static std::ostream *& errStream(){
+		static thread_local std::ostream * stream = &std::cerr;
+		return stream;
+	}
 };
 
 }
@@ -0,0 +1,597 @@
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "errors.hpp"
+#include "fastscan.hpp"
+#include "grammar.hh"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HOLEYC_X86_RUNS 1
+#endif
+
+namespace holeyc{
+
+using TokenKind = holeyc::Parser::token;
+
+namespace {
+
+bool isBlank(char c){ return c == ' ' || c == '\t'; }
+bool isDigit(char c){ return c >= '0' && c <= '9'; }
+bool isLetter(char c){
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+bool isIdentChar(char c){ return isLetter(c) || isDigit(c) || c == '_'; }
+bool isNotNewline(char c){ return c != '\n'; }
+bool isStrBody(char c){ return c != '"' && c != '\\' && c != '\n'; }
+bool isEscapee(char c){
+	return c == 'n' || c == 't' || c == '\'' || c == '"' || c == '\\';
+}
+
+/*
+Each kind of Runs finds where a run of bytes in some class, starting
+at i, stops: the index of the first byte at or after i that is out
+of the class, or n.
+*/
+template <bool (*InClass)(char)>
+size_t scalarRun(const char * p, size_t i, size_t n){
+	while (i < n && InClass(p[i])){ i++; }
+	return i;
+}
+
+struct ScalarRuns{
+	static size_t blanks(const char * p, size_t i, size_t n){
+		return scalarRun<isBlank>(p, i, n);
+	}
+	static size_t digits(const char * p, size_t i, size_t n){
+		return scalarRun<isDigit>(p, i, n);
+	}
+	static size_t ident(const char * p, size_t i, size_t n){
+		return scalarRun<isIdentChar>(p, i, n);
+	}
+	static size_t comment(const char * p, size_t i, size_t n){
+		return scalarRun<isNotNewline>(p, i, n);
+	}
+	static size_t strBody(const char * p, size_t i, size_t n){
+		return scalarRun<isStrBody>(p, i, n);
+	}
+};
+
+#ifdef HOLEYC_X86_RUNS
+
+/*
+The vector Runs test a whole vector of bytes against the class at
+once, giving a mask with bit k set if byte k is in the class. Bytes
+are compared as signed, which leaves everything from 0x80 up below
+'0' and so out of every range tested here.
+*/
+struct Sse2Runs{
+	typedef uint32_t (*Mask)(const char * p);
+	static const size_t WIDTH = 16;
+
+	static __m128i load(const char * p){
+		return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+	}
+	static __m128i inRange(__m128i v, char lo, char hi){
+		return _mm_and_si128(
+			_mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(lo - 1))),
+			_mm_cmplt_epi8(v, _mm_set1_epi8(static_cast<char>(hi + 1))));
+	}
+	static __m128i is(__m128i v, char c){
+		return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+	}
+	static uint32_t bits(__m128i v){
+		return static_cast<uint32_t>(_mm_movemask_epi8(v));
+	}
+
+	static uint32_t blankMask(const char * p){
+		__m128i v = load(p);
+		return bits(_mm_or_si128(is(v, ' '), is(v, '\t')));
+	}
+	static uint32_t digitMask(const char * p){
+		return bits(inRange(load(p), '0', '9'));
+	}
+	static uint32_t identMask(const char * p){
+		__m128i v = load(p);
+		__m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		return bits(_mm_or_si128(_mm_or_si128(inRange(lower, 'a', 'z'),
+			inRange(v, '0', '9')), is(v, '_')));
+	}
+	static uint32_t commentMask(const char * p){
+		return ~bits(is(load(p), '\n'));
+	}
+	static uint32_t strBodyMask(const char * p){
+		__m128i v = load(p);
+		return ~bits(_mm_or_si128(_mm_or_si128(is(v, '"'), is(v, '\\')),
+			is(v, '\n')));
+	}
+
+	template <Mask InClass, bool (*Scalar)(char)>
+	static size_t run(const char * p, size_t i, size_t n){
+		while (n - i >= WIDTH){
+			uint32_t stops = ~InClass(p + i) & 0xffffu;
+			if (stops != 0){
+				return i + static_cast<size_t>(__builtin_ctz(stops));
+			}
+			i += WIDTH;
+		}
+		return scalarRun<Scalar>(p, i, n);
+	}
+
+	static size_t blanks(const char * p, size_t i, size_t n){
+		return run<blankMask, isBlank>(p, i, n);
+	}
+	static size_t digits(const char * p, size_t i, size_t n){
+		return run<digitMask, isDigit>(p, i, n);
+	}
+	static size_t ident(const char * p, size_t i, size_t n){
+		return run<identMask, isIdentChar>(p, i, n);
+	}
+	static size_t comment(const char * p, size_t i, size_t n){
+		return run<commentMask, isNotNewline>(p, i, n);
+	}
+	static size_t strBody(const char * p, size_t i, size_t n){
+		return run<strBodyMask, isStrBody>(p, i, n);
+	}
+};
+
+/*
+The same with 32-byte vectors. Only these functions are built for
+AVX2, so the rest of the compiler still runs on any x86-64.
+*/
+#define HOLEYC_AVX2 __attribute__((target("avx2")))
+struct Avx2Runs{
+	typedef uint32_t (*Mask)(const char * p);
+	static const size_t WIDTH = 32;
+
+	HOLEYC_AVX2 static __m256i load(const char * p){
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+	}
+	HOLEYC_AVX2 static __m256i inRange(__m256i v, char lo, char hi){
+		return _mm256_and_si256(
+			_mm256_cmpgt_epi8(v, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+			_mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), v));
+	}
+	HOLEYC_AVX2 static __m256i is(__m256i v, char c){
+		return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+	}
+	HOLEYC_AVX2 static uint32_t bits(__m256i v){
+		return static_cast<uint32_t>(_mm256_movemask_epi8(v));
+	}
+
+	HOLEYC_AVX2 static uint32_t blankMask(const char * p){
+		__m256i v = load(p);
+		return bits(_mm256_or_si256(is(v, ' '), is(v, '\t')));
+	}
+	HOLEYC_AVX2 static uint32_t digitMask(const char * p){
+		return bits(inRange(load(p), '0', '9'));
+	}
+	HOLEYC_AVX2 static uint32_t identMask(const char * p){
+		__m256i v = load(p);
+		__m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+		return bits(_mm256_or_si256(_mm256_or_si256(
+			inRange(lower, 'a', 'z'), inRange(v, '0', '9')), is(v, '_')));
+	}
+	HOLEYC_AVX2 static uint32_t commentMask(const char * p){
+		return ~bits(is(load(p), '\n'));
+	}
+	HOLEYC_AVX2 static uint32_t strBodyMask(const char * p){
+		__m256i v = load(p);
+		return ~bits(_mm256_or_si256(_mm256_or_si256(is(v, '"'),
+			is(v, '\\')), is(v, '\n')));
+	}
+
+	template <Mask InClass, bool (*Scalar)(char)>
+	HOLEYC_AVX2 static size_t run(const char * p, size_t i, size_t n){
+		while (n - i >= WIDTH){
+			uint32_t stops = ~InClass(p + i);
+			if (stops != 0){
+				return i + static_cast<size_t>(__builtin_ctz(stops));
+			}
+			i += WIDTH;
+		}
+		return scalarRun<Scalar>(p, i, n);
+	}
+
+	HOLEYC_AVX2 static size_t blanks(const char * p, size_t i, size_t n){
+		return run<blankMask, isBlank>(p, i, n);
+	}
+	HOLEYC_AVX2 static size_t digits(const char * p, size_t i, size_t n){
+		return run<digitMask, isDigit>(p, i, n);
+	}
+	HOLEYC_AVX2 static size_t ident(const char * p, size_t i, size_t n){
+		return run<identMask, isIdentChar>(p, i, n);
+	}
+	HOLEYC_AVX2 static size_t comment(const char * p, size_t i, size_t n){
+		return run<commentMask, isNotNewline>(p, i, n);
+	}
+	HOLEYC_AVX2 static size_t strBody(const char * p, size_t i, size_t n){
+		return run<strBodyMask, isStrBody>(p, i, n);
+	}
+};
+#undef HOLEYC_AVX2
+
+#endif
+
+/* The keyword spelled by the len bytes at p, or ID */
+int keywordKind(const char * p, size_t len){
+	struct Keyword{ const char * text; size_t len; int kind; };
+	static const Keyword KEYWORDS[] = {
+		{"int", 3, TokenKind::INT},
+		{"intptr", 6, TokenKind::INTPTR},
+		{"bool", 4, TokenKind::BOOL},
+		{"boolptr", 7, TokenKind::BOOLPTR},
+		{"char", 4, TokenKind::CHAR},
+		{"charptr", 7, TokenKind::CHARPTR},
+		{"void", 4, TokenKind::VOID},
+		{"if", 2, TokenKind::IF},
+		{"else", 4, TokenKind::ELSE},
+		{"while", 5, TokenKind::WHILE},
+		{"return", 6, TokenKind::RETURN},
+		{"false", 5, TokenKind::FALSE},
+		{"true", 4, TokenKind::TRUE},
+		{"FROMCONSOLE", 11, TokenKind::FROMCONSOLE},
+		{"TOCONSOLE", 9, TokenKind::TOCONSOLE},
+		{"NULLPTR", 7, TokenKind::NULLPTR},
+	};
+	if (len > 11){ return TokenKind::ID; }
+	for (const Keyword& keyword : KEYWORDS){
+		if (keyword.len == len && keyword.text[0] == p[0]
+		  && memcmp(keyword.text, p, len) == 0){
+			return keyword.kind;
+		}
+	}
+	return TokenKind::ID;
+}
+
+/*
+Lexes a source buffer by hand, following the rules of holeyc.l: at
+each point the longest match wins, and of equally long matches the
+one listed first in holeyc.l. Runs are found with the given Runs.
+*/
+template <typename Runs>
+class Lexer{
+public:
+	Lexer(const SourceFile& src, TokenStream& tokensIn)
+	: myData(src.data()), mySize(src.size()), myTokens(tokensIn),
+	  myLineNum(1), myLineStart(0){}
+
+	void tokenize();
+private:
+	size_t col(size_t at) const { return at - myLineStart + 1; }
+
+	void push(int kind, size_t at, uint32_t payload){
+		myTokens.push(kind, at, payload);
+	}
+
+	//The match ending at next was a line break
+	void startLine(size_t next){
+		myLineNum++;
+		myLineStart = next;
+		myTokens.markLine(next, myLineNum);
+	}
+
+	//Restart the column count at next, on the same line
+	void restartCol(size_t next){
+		myLineStart = next;
+		myTokens.markLine(next, myLineNum);
+	}
+
+	void fatal(size_t at, const std::string& msg){
+		Report::fatal(myLineNum, col(at), msg);
+	}
+
+	size_t validStrPrefix(size_t i) const;
+	size_t charLit(size_t i);
+	size_t strLit(size_t i);
+	size_t intLit(size_t i);
+	size_t illegal(size_t i);
+
+	const char * myData;
+	size_t mySize;
+	TokenStream& myTokens;
+	size_t myLineNum;
+	size_t myLineStart;
+};
+
+template <typename Runs>
+void Lexer<Runs>::tokenize(){
+	const char * p = myData;
+	size_t n = mySize;
+	size_t i = 0;
+	while (i < n){
+		char c = p[i];
+		if (isLetter(c) || c == '_'){
+			size_t end = Runs::ident(p, i + 1, n);
+			size_t len = end - i;
+			int kind = keywordKind(p + i, len);
+			if (kind == TokenKind::ID){
+				push(kind, i, Symbol::intern(p + i, len).id());
+			} else {
+				push(kind, i, 0);
+			}
+			i = end;
+			continue;
+		}
+		switch (c){
+		case ' ': case '\t':
+			i = Runs::blanks(p, i + 1, n);
+			break;
+		case '\n':
+			i++;
+			startLine(i);
+			break;
+		case '\r':
+			if (i + 1 < n && p[i + 1] == '\n'){
+				i += 2;
+				startLine(i);
+			} else {
+				i = illegal(i);
+			}
+			break;
+		case '#':
+			i = Runs::comment(p, i + 1, n);
+			break;
+		case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9':
+			i = intLit(i);
+			break;
+		case '"':
+			i = strLit(i);
+			break;
+		case '\'':
+			i = charLit(i);
+			break;
+		case '@': push(TokenKind::AT, i++, 0); break;
+		case '^': push(TokenKind::CARAT, i++, 0); break;
+		case '[': push(TokenKind::LBRACE, i++, 0); break;
+		case ']': push(TokenKind::RBRACE, i++, 0); break;
+		case '{': push(TokenKind::LCURLY, i++, 0); break;
+		case '}': push(TokenKind::RCURLY, i++, 0); break;
+		case '(': push(TokenKind::LPAREN, i++, 0); break;
+		case ')': push(TokenKind::RPAREN, i++, 0); break;
+		case ';': push(TokenKind::SEMICOLON, i++, 0); break;
+		case ',': push(TokenKind::COMMA, i++, 0); break;
+		case '*': push(TokenKind::STAR, i++, 0); break;
+		case '/': push(TokenKind::SLASH, i++, 0); break;
+		default: {
+			//The one and two character operators
+			char next = i + 1 < n ? p[i + 1] : '\0';
+			int kind = 0;
+			size_t len = 2;
+			switch (c){
+			case '+':
+				kind = next == '+' ? TokenKind::CROSSCROSS : TokenKind::CROSS;
+				break;
+			case '-':
+				kind = next == '-' ? TokenKind::DASHDASH : TokenKind::DASH;
+				break;
+			case '!':
+				kind = next == '=' ? TokenKind::NOTEQUALS : TokenKind::NOT;
+				break;
+			case '=':
+				kind = next == '=' ? TokenKind::EQUALS : TokenKind::ASSIGN;
+				break;
+			case '<':
+				kind = next == '=' ? TokenKind::LESSEQ : TokenKind::LESS;
+				break;
+			case '>':
+				kind = next == '=' ? TokenKind::GREATEREQ
+					: TokenKind::GREATER;
+				break;
+			case '&':
+				kind = next == '&' ? TokenKind::AND : 0;
+				break;
+			case '|':
+				kind = next == '|' ? TokenKind::OR : 0;
+				break;
+			default:
+				break;
+			}
+			if (kind == 0){
+				i = illegal(i);
+				break;
+			}
+			if (kind == TokenKind::CROSS || kind == TokenKind::DASH
+			  || kind == TokenKind::NOT || kind == TokenKind::ASSIGN
+			  || kind == TokenKind::LESS || kind == TokenKind::GREATER){
+				len = 1;
+			}
+			push(kind, i, 0);
+			i += len;
+			break;
+		}
+		}
+	}
+	myTokens.setEOF(myLineNum, col(i));
+}
+
+template <typename Runs>
+size_t Lexer<Runs>::illegal(size_t i){
+	//As printed from yytext, where a NUL ends the text
+	std::string text;
+	if (myData[i] != '\0'){ text = std::string(1, myData[i]); }
+	fatal(i, "Illegal character " + text);
+	return i + 1;
+}
+
+template <typename Runs>
+size_t Lexer<Runs>::intLit(size_t i){
+	size_t end = Runs::digits(myData, i + 1, mySize);
+	size_t len = end - i;
+	// flex takes more than 10 digits to overflow without converting
+	// them (std::stod would throw past the range of a double)
+	bool overflow = len > 10;
+	uint64_t val = 0;
+	if (!overflow){
+		for (size_t k = i; k < end; k++){
+			val = val * 10 + static_cast<uint64_t>(myData[k] - '0');
+		}
+		overflow = val > INT_MAX;
+	}
+	if (overflow){
+		fatal(i, "Integer literal too large;  using max value");
+		val = INT_MAX;
+	}
+	push(TokenKind::INTLITERAL, i, static_cast<uint32_t>(val));
+	return end;
+}
+
+template <typename Runs>
+size_t Lexer<Runs>::charLit(size_t i){
+	const char * p = myData;
+	size_t n = mySize;
+	if (i + 1 == n){ return illegal(i); }
+	char c = p[i + 1];
+	if (c == '\n'){
+		fatal(i, "Empty character literal");
+		startLine(i + 2);
+		return i + 2;
+	}
+	if (c == '\r' && i + 2 < n && p[i + 2] == '\n'){
+		fatal(i, "Empty character literal");
+		startLine(i + 3);
+		return i + 3;
+	}
+	if (c != '\\'){
+		unsigned char val = static_cast<unsigned char>(c);
+		push(TokenKind::CHARLIT, i, val);
+		return i + 2;
+	}
+
+	char esc = i + 2 < n ? p[i + 2] : '\n';
+	char val;
+	switch (esc){
+	case 't': case '\t': val = '\t'; break;
+	case 'n': val = '\n'; break;
+	case '\\': val = '\\'; break;
+	case ' ': val = ' '; break;
+	case '\n': case '\r':
+		fatal(i, "Empty escape sequence in character literal");
+		return i + 2;
+	default:
+		fatal(i, "Bad escape sequence in char literal");
+		return i + 3;
+	}
+	push(TokenKind::CHARLIT, i, static_cast<unsigned char>(val));
+	return i + 3;
+}
+
+/*
+Where the longest run of plain characters and good escapes from i
+stops: at a ", a newline, a \ that does not start a good escape, or
+the end of the input
+*/
+template <typename Runs>
+size_t Lexer<Runs>::validStrPrefix(size_t i) const {
+	while (true){
+		i = Runs::strBody(myData, i, mySize);
+		if (i + 1 < mySize && myData[i] == '\\'
+		  && isEscapee(myData[i + 1])){
+			i += 2;
+			continue;
+		}
+		return i;
+	}
+}
+
+/*
+holeyc.l has four string rules, for a good string, an unterminated
+one, one with a bad escape, and one with both. They overlap, so
+which one flex picks is worked out here from the lengths they would
+match.
+*/
+template <typename Runs>
+size_t Lexer<Runs>::strLit(size_t i){
+	const char * p = myData;
+	size_t n = mySize;
+	size_t stop = validStrPrefix(i + 1);
+	if (stop < n && p[stop] == '"'){
+		size_t end = stop + 1;
+		push(TokenKind::STRLITERAL, i,
+			Symbol::intern(p + i, end - i).id());
+		return end;
+	}
+	if (stop == n || p[stop] == '\n'){
+		fatal(i, "Unterminated string literal ignored");
+		restartCol(stop);
+		return stop;
+	}
+
+	//A bad escape at stop
+	size_t badEnd = 0;
+	if (stop + 1 < n && p[stop + 1] != '\n'){
+		//The bad escape rule runs to the next " of any kind
+		size_t quote = stop + 2;
+		while (true){
+			quote = Runs::strBody(p, quote, n);
+			if (quote < n && p[quote] == '\\'){ quote++; continue; }
+			break;
+		}
+		if (quote < n && p[quote] == '"'){ badEnd = quote + 1; }
+
+		//...while the both rule takes good characters after it,
+		//and one more \ if they stop at one
+		size_t after = validStrPrefix(stop + 2);
+		size_t bothEnd = after;
+		if (after < n && p[after] == '\\'){ bothEnd++; }
+		if (badEnd != 0 && badEnd >= bothEnd){
+			fatal(i, "String literal with bad escape sequence ignored");
+			return badEnd;
+		}
+		fatal(i, "Unterminated string literal  with bad escape"
+			" sequence ignored");
+		restartCol(bothEnd);
+		return bothEnd;
+	}
+	//A \ right before the end of the line
+	fatal(i, "Unterminated string literal  with bad escape"
+		" sequence ignored");
+	restartCol(stop + 1);
+	return stop + 1;
+}
+
+} //End anonymous namespace
+
+bool FastScanner::supported(Isa isa){
+	switch (isa){
+	case SCALAR:
+		return true;
+#ifdef HOLEYC_X86_RUNS
+	case SSE2:
+		return true;
+	case AVX2:
+		return __builtin_cpu_supports("avx2");
+#endif
+	default:
+		return false;
+	}
+}
+
+FastScanner::Isa FastScanner::best(){
+	if (supported(AVX2)){ return AVX2; }
+	if (supported(SSE2)){ return SSE2; }
+	return SCALAR;
+}
+
+void FastScanner::tokenize(){
+	if (mySrc.size() > UINT32_MAX){
+		throw new InternalError("Input too large");
+	}
+	switch (myIsa){
+#ifdef HOLEYC_X86_RUNS
+	case SSE2:
+		Lexer<Sse2Runs>(mySrc, myTokens).tokenize();
+		return;
+	case AVX2:
+		Lexer<Avx2Runs>(mySrc, myTokens).tokenize();
+		return;
+#endif
+	default:
+		Lexer<ScalarRuns>(mySrc, myTokens).tokenize();
+		return;
+	}
+}
+
+} //End namespace holeyc
@@ -0,0 +1,41 @@
+#ifndef HOLEYC_FASTSCAN_HPP
+#define HOLEYC_FASTSCAN_HPP
+
+#include <cstddef>
+#include "source.hpp"
+#include "tokens.hpp"
+
+namespace holeyc{
+
+/**
+* A hand-written replacement for the flex scanner (holeyc.l), which
+* skips runs of blanks, comments, identifier and digit characters and
+* string bodies a vector at a time instead of a byte at a time. It
+* fills the TokenStream with exactly what Scanner would, line marks
+* included, and reports the same errors at the same positions.
+**/
+class FastScanner{
+public:
+	/** How wide the runs are scanned **/
+	enum Isa{ SCALAR, SSE2, AVX2 };
+
+	FastScanner(const SourceFile& srcIn, TokenStream& tokensIn, Isa isaIn)
+	: mySrc(srcIn), myTokens(tokensIn), myIsa(isaIn){}
+
+	/** Whether this build and CPU can scan with isa **/
+	static bool supported(Isa isa);
+
+	/** The widest Isa that is supported **/
+	static Isa best();
+
+	/** Lex the whole input into the token stream **/
+	void tokenize();
+private:
+	const SourceFile& mySrc;
+	TokenStream& myTokens;
+	Isa myIsa;
+};
+
+} //End namespace holeyc
+
+#endif
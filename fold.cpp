@@ -0,0 +1,479 @@
+#include <climits>
+#include <cstdint>
+#include <sstream>
+#include <vector>
+#include "errors.hpp"
+#include "fold.hpp"
+#include "types.hpp"
+#include "visitor.hpp"
+
+namespace holeyc{
+
+/*
+The range of a folded int, which is that of the ints the program
+computes with. A result outside it is reported, but not folded: the
+program wraps it around at run time, and -O1 must not change what a
+program does.
+*/
+static const int64_t MIN_FOLDED = INT_MIN;
+static const int64_t MAX_FOLDED = INT_MAX;
+
+/*
+Walks each expression in the order it is evaluated, leaving what it
+came to on a stack for its parent to take: a constant int or bool,
+or the expression itself if it is not constant. Constants become
+literal nodes only where an expression that is kept needs them as
+operands, so a large constant expression makes one node.
+
+A read of a local int or bool is constant when it follows an
+assignment of a constant in the same straight-line code. Anything
+that can be reached another way (the body of a loop, or what comes
+after an if) starts out knowing nothing, and so does what comes
+after a call or a store through a pointer, either of which may
+change a local whose address has been taken. Globals are never
+known, since any call may change them.
+
+Locals are told apart by name, with the scopes that name analysis
+uses: a function's formals and body share one, and each body of an
+if, else or while has its own.
+*/
+class ConstantFolder : public AstVisitor<ConstantFolder>{
+public:
+	ConstantFolder(Arena& arenaIn)
+	: myArena(arenaIn), myEpoch(1), myStores(0){}
+
+	using AstVisitor<ConstantFolder>::visit;
+	using AstVisitor<ConstantFolder>::post;
+	using AstVisitor<ConstantFolder>::resume;
+
+	void visit(VarDeclNode * node){
+		if (!myScopes.empty()){ declare(node->id(), node->type()); }
+	}
+
+	void visit(FormalDeclNode * node){ declare(node->id(), node->type()); }
+
+	void visit(FnDeclNode * node){
+		enterScope();
+		later(node->params());
+		later(node->body());
+		later(node, EXIT);
+	}
+
+	void visit(IfStmtNode * node){
+		later(node->exp());
+		later(node, COND);
+		later(node->body());
+		later(node, EXIT);
+	}
+
+	void visit(IfElseStmtNode * node){
+		later(node->exp());
+		later(node, COND);
+		later(node->thenBody());
+		later(node, ELSE);
+		later(node->elseBody());
+		later(node, EXIT);
+	}
+
+	void visit(WhileStmtNode * node){
+		//The condition is evaluated again after each pass of the body
+		forgetAll();
+		later(node->exp());
+		later(node, COND);
+		later(node->body());
+		later(node, EXIT);
+	}
+
+	void resume(FnDeclNode * node, uint32_t step){ exitScope(); }
+
+	void resume(IfStmtNode * node, uint32_t step){
+		if (step == COND){
+			node->setExp(take());
+			enterScope();
+		} else {
+			exitScope();
+		}
+	}
+
+	void resume(IfElseStmtNode * node, uint32_t step){
+		if (step == COND){
+			node->setExp(take());
+		} else {
+			exitScope();
+		}
+		if (step != EXIT){ enterScope(); }
+	}
+
+	void resume(WhileStmtNode * node, uint32_t step){
+		if (step == COND){
+			node->setExp(take());
+			enterScope();
+		} else {
+			exitScope();
+		}
+	}
+
+	/*
+	The rhs of && and || is only evaluated if the lhs does not settle
+	the result, so like the body of an if, what it stores is not known
+	afterwards unless it always runs
+	*/
+	void visit(AndNode * node){ shortCircuit(node); }
+	void visit(OrNode * node){ shortCircuit(node); }
+
+	void resume(AndNode * node, uint32_t step){ shortCircuit(node, step); }
+	void resume(OrNode * node, uint32_t step){ shortCircuit(node, step); }
+
+	void visit(IntLitNode * node){ push(node, DataType::Int, node->value()); }
+	void visit(TrueNode * node){ push(node, DataType::Bool, 1); }
+	void visit(FalseNode * node){ push(node, DataType::Bool, 0); }
+	void visit(StrLitNode * node){ push(node); }
+	void visit(CharLitNode * node){ push(node); }
+	void visit(NullPtrNode * node){ push(node); }
+
+	/* Every IDNode is part of something that looks at it itself */
+	void visit(IDNode * node){}
+
+	void visit(LValNode * node){
+		Local * local = find(node->id());
+		if (local != nullptr && local->epoch == myEpoch){
+			push(node, local->type, local->value);
+		} else {
+			push(node);
+		}
+	}
+
+	void visit(DerefNode * node){ push(node); }
+	void visit(RefNode * node){ push(node); }
+
+	void post(IndexNode * node){
+		node->setExp(take());
+		push(node);
+	}
+
+	void post(AssignExpNode * node){
+		Value src = pop();
+		pop();
+		node->setExp(make(src));
+		store(node->lval(), src);
+		push(node);
+	}
+
+	void post(CallExpNode * node){
+		ArenaVector<ExpNode *>& args = *node->args();
+		for (size_t k = args.size(); k > 0; k--){ args[k - 1] = take(); }
+		forgetAll();
+		push(node);
+	}
+
+	void post(BinaryExpNode * node){
+		Value rhs = pop();
+		Value lhs = pop();
+		if (lhs.type != DataType::Unchecked && lhs.type == rhs.type
+		  && fold(node, lhs.type, lhs.value, rhs.value)){
+			return;
+		}
+		node->setLhs(make(lhs));
+		node->setRhs(make(rhs));
+		push(node);
+	}
+
+	void post(NotNode * node){
+		Value val = pop();
+		if (val.type == DataType::Bool){
+			push(node, DataType::Bool, !val.value);
+			return;
+		}
+		node->setExp(make(val));
+		push(node);
+	}
+
+	void post(NegNode * node){
+		Value val = pop();
+		if (val.type == DataType::Int
+		  && foldInt(node, -static_cast<int64_t>(val.value))){
+			return;
+		}
+		node->setExp(make(val));
+		push(node);
+	}
+
+	void post(AssignStmtNode * node){ pop(); }
+	void post(CallStmtNode * node){ pop(); }
+	void post(PostDecStmtNode * node){ step(node->exp(), -1); }
+	void post(PostIncStmtNode * node){ step(node->exp(), 1); }
+
+	void post(FromConsoleStmtNode * node){
+		pop();
+		store(node->lval(), Value{node->lval(), DataType::Unchecked, 0});
+	}
+
+	void post(ToConsoleStmtNode * node){ node->setExp(take()); }
+
+	void post(ReturnStmtNode * node){
+		if (node->exp() != nullptr){ node->setExp(take()); }
+	}
+
+private:
+	enum Step : uint32_t { COND, ELSE, EXIT };
+
+	/* What an expression came to; type is Unchecked if not constant */
+	struct Value{
+		ExpNode * node;
+		DataType type;
+		int32_t value;
+	};
+
+	/* The innermost local of a name, and its value if it is known */
+	struct Local{
+		DataType type; //Unchecked if there is no local of the name
+		int32_t value;
+		uint32_t epoch; //the value is known while this is myEpoch
+	};
+
+	//What a declaration hid, to be put back on leaving its scope
+	struct Undo{
+		uint32_t name;
+		DataType type;
+	};
+
+	void push(ExpNode * node, DataType type = DataType::Unchecked,
+		int32_t value = 0
+	){
+		myValues.push_back(Value{node, type, value});
+	}
+
+	Value pop(){
+		Value val = myValues.back();
+		myValues.pop_back();
+		return val;
+	}
+
+	/* The node for val, which is a literal if val is constant */
+	ExpNode * make(Value val){
+		ExpNode * node = val.node;
+		size_t l = node->line();
+		size_t c = node->col();
+		if (val.type == DataType::Int){
+			if (node->kind() == NodeKind::IntLit){ return node; }
+			if (val.value == MIN_FOLDED){
+				//No literal is this small, so it is written as
+				// (-2147483647) - 1
+				ExpNode * max = myArena.make<IntLitNode>(l, c, INT_MAX);
+				return myArena.make<MinusNode>(
+					myArena.make<NegNode>(max),
+					myArena.make<IntLitNode>(l, c, 1));
+			}
+			return myArena.make<IntLitNode>(l, c, val.value);
+		}
+		if (val.type != DataType::Bool){ return node; }
+		if (val.value != 0){
+			if (node->kind() == NodeKind::True){ return node; }
+			return myArena.make<TrueNode>(l, c);
+		}
+		if (node->kind() == NodeKind::False){ return node; }
+		return myArena.make<FalseNode>(l, c);
+	}
+
+	ExpNode * take(){ return make(pop()); }
+
+	/*
+	Push what node comes to when both of its operands are constants
+	of type; returns false, having pushed nothing, if it cannot be
+	worked out here (e.g. because it is a type error)
+	*/
+	bool fold(BinaryExpNode * node, DataType type, int64_t lhs,
+		int64_t rhs
+	){
+		switch (node->kind()){
+		case NodeKind::Equals: return foldBool(node, lhs == rhs);
+		case NodeKind::NotEquals: return foldBool(node, lhs != rhs);
+		default: break;
+		}
+		if (type == DataType::Bool){ return false; }
+		switch (node->kind()){
+		case NodeKind::Minus: return foldInt(node, lhs - rhs);
+		case NodeKind::Plus: return foldInt(node, lhs + rhs);
+		case NodeKind::Times: return foldInt(node, lhs * rhs);
+		case NodeKind::Divide:
+			if (rhs == 0){
+				//Left for the program to fail on, if it gets there
+				Report::warn(node->line(), node->col(),
+					"Division by zero");
+				return false;
+			}
+			return foldInt(node, lhs / rhs);
+		case NodeKind::Greater: return foldBool(node, lhs > rhs);
+		case NodeKind::GreaterEq: return foldBool(node, lhs >= rhs);
+		case NodeKind::Less: return foldBool(node, lhs < rhs);
+		case NodeKind::LessEq: return foldBool(node, lhs <= rhs);
+		default: return false;
+		}
+	}
+
+	bool foldInt(ExpNode * node, int64_t value){
+		if (value > MAX_FOLDED || value < MIN_FOLDED){
+			std::ostringstream msg;
+			msg << "Integer overflow in constant expression; wraps to "
+				<< static_cast<int32_t>(static_cast<uint32_t>(value))
+				<< " at run time";
+			Report::warn(node->line(), node->col(), msg.str());
+			return false;
+		}
+		push(node, DataType::Int, static_cast<int32_t>(value));
+		return true;
+	}
+
+	bool foldBool(ExpNode * node, bool value){
+		push(node, DataType::Bool, value ? 1 : 0);
+		return true;
+	}
+
+	void shortCircuit(BinaryExpNode * node){
+		later(node->lhs());
+		later(node, COND);
+		later(node->rhs());
+		later(node, EXIT);
+	}
+
+	void shortCircuit(BinaryExpNode * node, uint32_t step){
+		if (step == COND){
+			myStoreMarks.push_back(myStores);
+			return;
+		}
+		Value rhs = pop();
+		Value lhs = pop();
+		bool stored = myStores != myStoreMarks.back();
+		myStoreMarks.pop_back();
+		//Folding never hides a type error, so the rhs must be a bool
+		// for the type checker to see the same thing it would have
+		if (lhs.type == DataType::Bool){
+			bool isOr = node->kind() == NodeKind::Or;
+			bool settles = (lhs.value != 0) == isOr;
+			if (!settles && typedBool(rhs)){
+				//The rhs always runs, and is the result
+				myValues.push_back(rhs);
+				return;
+			}
+			if (settles && knownBool(rhs)){
+				//The rhs never runs, and is dropped
+				if (stored){ forgetAll(); }
+				foldBool(node, lhs.value != 0);
+				return;
+			}
+		}
+		if (stored){ forgetAll(); }
+		node->setLhs(make(lhs));
+		node->setRhs(make(rhs));
+		push(node);
+	}
+
+	/* 
+	Whether val is a bool constant or reads a bool local, and so is
+	a bool with nothing in it for the type checker to report
+	*/
+	bool knownBool(Value val){
+		if (val.type == DataType::Bool){ return true; }
+		if (val.node->kind() != NodeKind::LVal){ return false; }
+		Local * local = find(static_cast<LValNode *>(val.node)->id());
+		return local != nullptr && local->type == DataType::Bool;
+	}
+
+	/* 
+	Whether val is a bool if it type checks at all; any error in it
+	is reported within it
+	*/
+	bool typedBool(Value val){
+		if (knownBool(val)){ return true; }
+		switch (val.node->kind()){
+		case NodeKind::And: case NodeKind::Or: case NodeKind::Not:
+		case NodeKind::Equals: case NodeKind::NotEquals:
+		case NodeKind::Greater: case NodeKind::GreaterEq:
+		case NodeKind::Less: case NodeKind::LessEq:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	/* The local that id names, if there is one */
+	Local * find(IDNode * id){
+		uint32_t name = id->sym().id();
+		if (name >= myLocals.size()){ return nullptr; }
+		Local * local = &myLocals[name];
+		return local->type == DataType::Unchecked ? nullptr : local;
+	}
+
+	/* What a store of val to lval tells us */
+	void store(LValNode * lval, Value val){
+		if (lval->kind() != NodeKind::LVal){
+			forgetAll();
+			return;
+		}
+		Local * local = find(lval->id());
+		if (local == nullptr){ return; }
+		myStores++;
+		local->value = val.value;
+		local->epoch = val.type == local->type ? myEpoch : 0;
+	}
+
+	/* The value of lval once its exp (an lval) is stepped by delta */
+	void step(ExpNode * exp, int32_t delta){
+		Value val = pop();
+		int64_t next = static_cast<int64_t>(val.value) + delta;
+		if (val.type == DataType::Int
+		  && (next > MAX_FOLDED || next < MIN_FOLDED)){
+			//The program wraps around, which is left for it to do
+			val.type = DataType::Unchecked;
+		}
+		val.value = static_cast<int32_t>(next);
+		store(static_cast<LValNode *>(exp), val);
+	}
+
+	void declare(IDNode * id, TypeNode * type){
+		uint32_t name = id->sym().id();
+		if (name >= myLocals.size()){
+			myLocals.resize(name + 1, Local{DataType::Unchecked, 0, 0});
+		}
+		Local& local = myLocals[name];
+		myLog.push_back(Undo{name, local.type});
+		local.type = declaredType(type);
+		local.epoch = 0;
+	}
+
+	void enterScope(){ myScopes.push_back(myLog.size()); }
+
+	void exitScope(){
+		size_t start = myScopes.back();
+		myScopes.pop_back();
+		while (myLog.size() > start){
+			myLocals[myLog.back().name].type = myLog.back().type;
+			myLog.pop_back();
+		}
+		forgetAll();
+	}
+
+	void forgetAll(){
+		myEpoch++;
+		if (myEpoch != 0){ return; }
+		//Wrapped around: no stale epoch may match the new ones
+		for (Local& local : myLocals){ local.epoch = 0; }
+		myEpoch = 1;
+	}
+
+	Arena& myArena;
+	std::vector<Value> myValues;
+	std::vector<Local> myLocals; //by name
+	std::vector<Undo> myLog;
+	std::vector<size_t> myScopes; //where each open scope's log starts
+	uint32_t myEpoch;
+	size_t myStores; //how many stores to locals there have been
+	std::vector<size_t> myStoreMarks; //myStores at each open rhs
+};
+
+void foldConstants(ProgramNode * program, Arena& arena){
+	ConstantFolder folder(arena);
+	folder.walk(program);
+}
+
+} // End namespace holeyc
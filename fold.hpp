@@ -0,0 +1,20 @@
+#ifndef HOLEYC_FOLD_HPP
+#define HOLEYC_FOLD_HPP
+
+#include "arena.hpp"
+#include "ast.hpp"
+
+namespace holeyc{
+
+/**
+* Replace each expression in program that can be worked out at
+* compile time with a literal, including reads of local variables
+* whose value is known there (see fold.cpp). New literals are made
+* in arena. Needs only the parse, so that every phase after it
+* sees the smaller tree.
+**/
+void foldConstants(ProgramNode * program, Arena& arena);
+
+} //End namespace holeyc
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef HOLEYC_HASH_HPP
+#define HOLEYC_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace holeyc{
+
+/**
+* An incremental 64-bit FNV-1a hash, for telling whether inputs are
+* the same as they were on an earlier run, and for hash tables.
+**/
+class Hash64{
+public:
+	Hash64() : myHash(0xcbf29ce484222325ull){}
+
+	void add(const char * data, size_t len){
+		uint64_t hash = myHash;
+		for (size_t i = 0; i < len; i++){
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= 0x100000001b3ull;
+		}
+		myHash = hash;
+	}
+
+	void add(uint32_t val){
+		add(reinterpret_cast<const char *>(&val), sizeof(val));
+	}
+
+	uint64_t value() const { return myHash; }
+private:
+	uint64_t myHash;
+};
+
+} //End namespace holeyc
+
+#endif
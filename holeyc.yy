@@ -9,11 +9,12 @@
 %token-table
 
 %code requires{
-	#include <list>
+	#include "arena.hpp"
 	#include "tokens.hpp"
 	#include "ast.hpp"
 	namespace holeyc {
-		class Scanner;
+		class TokenReader;
+		class Arena;
 	}
 
 //The following definition is required when 
@@ -29,7 +30,8 @@
 //End "requires" code
 }
 
-%parse-param { holeyc::Scanner &scanner }
+%parse-param { holeyc::TokenReader &tokens }
+%parse-param { holeyc::Arena &arena }
 %parse-param { holeyc::ProgramNode** root }
 
 %code{
@@ -39,14 +41,16 @@
    #include <fstream>
 
    // Our code for interoperation between scanner/parser
-   #include "scanner.hpp"
+   #include "errors.hpp"
+   #include "arena.hpp"
    #include "ast.hpp"
    #include "tokens.hpp"
 
-  //Request tokens from our scanner member, not 
-  // from a global function
+  //Request tokens from the already-lexed token 
+  // stream, not from a global function. A token's
+  // semantic value is its index in the stream
   #undef yylex
-  #define yylex scanner.yylex
+  #define yylex(lval) tokens.next(&(lval)->transToken)
 }
 
 
@@ -60,31 +64,27 @@ TODO: You will have to add to this list to
 create new translation value types
 */
 %union {
-   holeyc::Token *                     		transToken;
-   holeyc::IDToken *                   		transIDToken;
+   size_t                              		transToken; //Index in the token stream
    holeyc::ProgramNode *               		transProgram;
-   std::list<holeyc::DeclNode *> *     		transDeclList;
+   holeyc::ArenaVector<holeyc::DeclNode *> *     		transDeclList;
    holeyc::DeclNode *                  		transDecl;
    holeyc::VarDeclNode *               		transVarDecl;
    holeyc::TypeNode *                  		transType;
    holeyc::IDNode *                    		transID;
 
 	 holeyc::FnDeclNode * 					transFnDecl;
-	 std::list<holeyc::FormalDeclNode *> * 	transFormalsList;
-	 std::list<holeyc::FormalDeclNode *> * 	transFormals;
+	 holeyc::ArenaVector<holeyc::FormalDeclNode *> * 	transFormalsList;
+	 holeyc::ArenaVector<holeyc::FormalDeclNode *> * 	transFormals;
 	 holeyc::FormalDeclNode * 				transFormalDecl;
-	 std::list<holeyc::StmtNode *> *        transFnBody;
-	 std::list<holeyc::StmtNode *> *        transStmtList;
+	 holeyc::ArenaVector<holeyc::StmtNode *> *        transFnBody;
+	 holeyc::ArenaVector<holeyc::StmtNode *> *        transStmtList;
 	 holeyc::StmtNode * 					transStmt;
 	 holeyc::ExpNode * 						transExp;
 	 holeyc::AssignExpNode * 				transAssignExp;
 	 holeyc::CallExpNode * 					transCallExp;
 	 holeyc::ExpNode *                      transTerm;
 	 holeyc::LValNode * 					transLVal;
-	 holeyc::IntLitToken *					transIntToken;
-	 holeyc::CharLitToken *					transCharToken;
-	 holeyc::StrToken *						transStrToken;
-	 std::list<holeyc::ExpNode*> *			transExpList;
+	 holeyc::ArenaVector<holeyc::ExpNode *> *			transExpList;
 	 
 }
 
@@ -98,7 +98,7 @@ create new translation value types
 %token	<transToken>     BOOLPTR
 %token	<transToken>     CARAT
 %token	<transToken>     CHAR
-%token	<transCharToken> CHARLIT
+%token	<transToken>     CHARLIT
 %token	<transToken>     CHARPTR
 %token	<transToken>     COMMA
 %token	<transToken>     CROSS
@@ -109,10 +109,10 @@ create new translation value types
 %token	<transToken>     EQUALS
 %token	<transToken>     FALSE
 %token	<transToken>     FROMCONSOLE
-%token	<transIDToken>   ID
+%token	<transToken>     ID
 %token	<transToken>     IF
 %token	<transToken>     INT
-%token	<transIntToken>  INTLITERAL
+%token	<transToken>     INTLITERAL
 %token	<transToken>     INTPTR
 %token	<transToken>     GREATER
 %token	<transToken>     GREATEREQ
@@ -132,7 +132,7 @@ create new translation value types
 %token	<transToken>     SEMICOLON
 %token	<transToken>     SLASH
 %token	<transToken>     STAR
-%token	<transStrToken>  STRLITERAL
+%token	<transToken>     STRLITERAL
 %token	<transToken>     TOCONSOLE
 %token	<transToken>     TRUE
 %token	<transToken>     VOID
@@ -187,7 +187,7 @@ create new translation value types
 
 program 	: globals
 						{
-							$$ = new ProgramNode($1);
+							$$ = arena.make<ProgramNode>($1);
 							*root = $$;
 						}
 
@@ -195,175 +195,188 @@ globals 	: globals decl
 						{
 							$$ = $1;
 							DeclNode * aGlobalDecl = $2;
-							$1->push_back(aGlobalDecl);
+							if (aGlobalDecl != nullptr){
+								$1->push_back(aGlobalDecl);
+							}
 						}
 					| /* epsilon */
 						{
-							std::list<DeclNode *> * startingGlobals;
-							startingGlobals = new std::list<DeclNode *>();
+							ArenaVector<DeclNode *> * startingGlobals;
+							startingGlobals = arena.make<ArenaVector<DeclNode *>>(arena);
 							$$ = startingGlobals;
 						} 
 
 decl 			: varDecl SEMICOLON { $$ = $1; }
 					| fnDecl  { $$ = $1; }
+					| error SEMICOLON
+						{
+							//Skip to the end of the declaration and go on, 
+							// to report any further errors too
+							$$ = nullptr;
+						}
+					| error RCURLY { $$ = nullptr; }
 
 varDecl 	: type id
 						{ 
 							size_t typeLine = $1->line();
 							size_t typeCol = $1->col();
-							$$ = new VarDeclNode(typeLine, typeCol, $1, $2);
+							$$ = arena.make<VarDeclNode>(typeLine, typeCol, $1, $2);
 						}
 
 type 	: INT
 				{
 					bool isPtr = false;
-					$$ = new IntTypeNode($1->line(), $1->col(), isPtr);
+					$$ = arena.make<IntTypeNode>(tokens.line($1), tokens.col($1), isPtr);
 				}
 			| INTPTR
 				{ 
 					bool isPtr = true;
-					$$ = new IntPtrNode($1->line(), $1->col(), isPtr);
+					$$ = arena.make<IntPtrNode>(tokens.line($1), tokens.col($1), isPtr);
 				}
 			| BOOL
 				{ 
 					bool isPtr = false;
-					$$ = new BoolTypeNode($1->line(), $1->col(), isPtr);
+					$$ = arena.make<BoolTypeNode>(tokens.line($1), tokens.col($1), isPtr);
 				}
 			| BOOLPTR
 				{
 					bool isPtr = true;
-					$$ = new BoolPtrNode($1->line(), $1->col(), isPtr);
+					$$ = arena.make<BoolPtrNode>(tokens.line($1), tokens.col($1), isPtr);
 				}
 			| CHAR
 				{
 					bool isPtr = false;
-					$$ = new CharTypeNode($1->line(), $1->col(), isPtr);
+					$$ = arena.make<CharTypeNode>(tokens.line($1), tokens.col($1), isPtr);
 				}
 			| CHARPTR
 				{
 					bool isPtr = true;
-					$$ = new CharPtrNode($1->line(), $1->col(), isPtr);
+					$$ = arena.make<CharPtrNode>(tokens.line($1), tokens.col($1), isPtr);
 				}
 			| VOID
 				{
 					bool isPtr = false;
-					$$ = new VoidTypeNode($1->line(), $1->col(), isPtr); 
+					$$ = arena.make<VoidTypeNode>(tokens.line($1), tokens.col($1), isPtr); 
 				}
 
 
 fnDecl 		: type id formals fnBody
-				{ $$ = new FnDeclNode($1, $2, $3, $4); }
+				{ $$ = arena.make<FnDeclNode>($1, $2, $3, $4); }
 
 formals 	: LPAREN RPAREN
-				{ $$ = new std::list<FormalDeclNode*>; }
+				{ $$ = arena.make<ArenaVector<FormalDeclNode*>>(arena); }
 			| LPAREN formalsList RPAREN
 				{ $$ = $2; }
 
 
 formalsList : formalDecl
 				{ 
-					$$ = new std::list<FormalDeclNode*>;
+					$$ = arena.make<ArenaVector<FormalDeclNode*>>(arena);
 					$$->push_back($1);
 				}
-			| formalDecl COMMA formalsList 
+			| formalsList COMMA formalDecl
 				{ 
-					$$ = $3;
-					$$->push_front($1);
+					$$ = $1;
+					$$->push_back($3);
 				}
 
 formalDecl	: type id
-		  		{ $$ = new FormalDeclNode($1, $2); }
+		  		{ $$ = arena.make<FormalDeclNode>($1, $2); }
 
 fnBody		: LCURLY stmtList RCURLY
 		  		{ $$ = $2; }
 
 stmtList 	: /* epsilon */
 				{ 
-					std::list<StmtNode *> * startingStmt;
-					startingStmt = new std::list<StmtNode *>;
+					ArenaVector<StmtNode *> * startingStmt;
+					startingStmt = arena.make<ArenaVector<StmtNode *>>(arena);
 					$$ = startingStmt;
 				}
 			| stmtList stmt
 				{ 
 					$$ = $1;
-					$1->push_back($2);
+					if ($2 != nullptr){
+						$1->push_back($2);
+					}
 				}																											
 
 stmt		: varDecl SEMICOLON
 		  		{ $$ = $1; }
 				| assignExp SEMICOLON
-					{ $$ = new AssignStmtNode($1); }
+					{ $$ = arena.make<AssignStmtNode>($1); }
 				| lval DASHDASH SEMICOLON
-					{ $$ = new PostDecStmtNode($1); }
+					{ $$ = arena.make<PostDecStmtNode>($1); }
 				| lval CROSSCROSS SEMICOLON
-					{ $$ = new PostIncStmtNode($1); }
+					{ $$ = arena.make<PostIncStmtNode>($1); }
 				| FROMCONSOLE lval SEMICOLON
-					{ $$ = new FromConsoleStmtNode($2); }
+					{ $$ = arena.make<FromConsoleStmtNode>($2); }
 				| TOCONSOLE exp SEMICOLON
-					{ $$ = new ToConsoleStmtNode($2); }
+					{ $$ = arena.make<ToConsoleStmtNode>($2); }
 				| IF LPAREN exp RPAREN LCURLY stmtList RCURLY
-					{ $$ = new IfStmtNode($3, $6); }
+					{ $$ = arena.make<IfStmtNode>($3, $6); }
 				| IF LPAREN exp RPAREN LCURLY stmtList RCURLY ELSE LCURLY stmtList RCURLY
-					{ $$ = new IfElseStmtNode($3, $6, $10); }
+					{ $$ = arena.make<IfElseStmtNode>($3, $6, $10); }
 				| WHILE LPAREN exp RPAREN LCURLY stmtList RCURLY
-					{ $$ = new WhileStmtNode($3, $6); }
+					{ $$ = arena.make<WhileStmtNode>($3, $6); }
 				| RETURN exp SEMICOLON
-					{ $$ = new ReturnStmtNode($2, false); }
+					{ $$ = arena.make<ReturnStmtNode>($2, false); }
 				| RETURN SEMICOLON
-					{ $$ = new ReturnStmtNode($2->line(), $2->col(), true); }
+					{ $$ = arena.make<ReturnStmtNode>(tokens.line($2), tokens.col($2), true); }
 				| callExp SEMICOLON
-					{ $$ = new CallStmtNode($1); }
+					{ $$ = arena.make<CallStmtNode>($1); }
+				| error SEMICOLON
+					{ $$ = nullptr; }
 
 exp		: assignExp 
 				{ $$ = $1; } 
 			| exp DASH exp
-				{ $$ = new MinusNode($1, $3); }
+				{ $$ = arena.make<MinusNode>($1, $3); }
 			| exp CROSS exp
-				{ $$ = new PlusNode($1, $3); }
+				{ $$ = arena.make<PlusNode>($1, $3); }
 			| exp STAR exp
-				{ $$ = new TimesNode($1, $3); }
+				{ $$ = arena.make<TimesNode>($1, $3); }
 			| exp SLASH exp
-				{ $$ = new DivideNode($1, $3); }
+				{ $$ = arena.make<DivideNode>($1, $3); }
 			| exp AND exp
-				{ $$ = new AndNode($1, $3); }
+				{ $$ = arena.make<AndNode>($1, $3); }
 			| exp OR exp
-				{ $$ = new OrNode($1, $3); }
+				{ $$ = arena.make<OrNode>($1, $3); }
 			| exp EQUALS exp
-				{ $$ = new EqualsNode($1, $3); }
+				{ $$ = arena.make<EqualsNode>($1, $3); }
 			| exp NOTEQUALS exp
-				{ $$ = new NotEqualsNode($1, $3); }
+				{ $$ = arena.make<NotEqualsNode>($1, $3); }
 			| exp GREATER exp
-				{ $$ = new GreaterNode($1, $3); }
+				{ $$ = arena.make<GreaterNode>($1, $3); }
 			| exp GREATEREQ exp
-				{ $$ = new GreaterEqNode($1, $3); }
+				{ $$ = arena.make<GreaterEqNode>($1, $3); }
 			| exp LESS exp
-				{ $$ = new LessNode($1, $3); }
+				{ $$ = arena.make<LessNode>($1, $3); }
 			| exp LESSEQ exp
-				{ $$ = new LessEqNode($1, $3); }
+				{ $$ = arena.make<LessEqNode>($1, $3); }
 			| NOT exp
-				{ $$ = new NotNode($2); }
+				{ $$ = arena.make<NotNode>($2); }
 			| DASH term
-				{ $$ = new NegNode($2); }
+				{ $$ = arena.make<NegNode>($2); }
 			| term 
 				{ $$ = $1; }
 
 assignExp	: lval ASSIGN exp
 				{
-					$$ = new AssignExpNode($1, $3);
+					$$ = arena.make<AssignExpNode>($1, $3);
 				}
 
 callExp		: id LPAREN RPAREN
 		  		{ 
-					$$ = new CallExpNode($1, new std::list<ExpNode*>);
+					$$ = arena.make<CallExpNode>($1, arena.make<ArenaVector<ExpNode*>>(arena));
 				}
 			| id LPAREN actualsList RPAREN
 				{ 
-					$$ = new CallExpNode($1, $3);
+					$$ = arena.make<CallExpNode>($1, $3);
 				}											
 
 actualsList	: exp
 				{
-					$$ = new std::list<ExpNode*>;
+					$$ = arena.make<ArenaVector<ExpNode*>>(arena);
 					$$->push_back($1);
 				}
 			| actualsList COMMA exp
@@ -377,35 +390,34 @@ term 	: lval
 			| callExp
 				{ $$ = $1; }
 			| NULLPTR
-				{ $$ = new NullPtrNode($1->line(), $1->col()); }
+				{ $$ = arena.make<NullPtrNode>(tokens.line($1), tokens.col($1)); }
 			| INTLITERAL 
-				{ $$ = new IntLitNode($1->line(), $1->col(), $1); }
+				{ $$ = arena.make<IntLitNode>(tokens.line($1), tokens.col($1), tokens.intVal($1)); }
 			| STRLITERAL 
-				{ $$ = new StrLitNode($1->line(), $1->col(), $1); }
+				{ $$ = arena.make<StrLitNode>(tokens.line($1), tokens.col($1), tokens.sym($1)); }
 			| CHARLIT 
-				{ $$ = new CharLitNode($1->line(), $1->col(), $1); }
+				{ $$ = arena.make<CharLitNode>(tokens.line($1), tokens.col($1), tokens.charVal($1)); }
 			| TRUE
-				{ $$ = new TrueNode($1); }
+				{ $$ = arena.make<TrueNode>(tokens.line($1), tokens.col($1)); }
 			| FALSE
-				{ $$ = new FalseNode($1); }
+				{ $$ = arena.make<FalseNode>(tokens.line($1), tokens.col($1)); }
 			| LPAREN exp RPAREN
 				{ $$ = $2; }
 
 lval	: id
-				{ $$ = new LValNode($1); }
+				{ $$ = arena.make<LValNode>($1); }
 			| id LBRACE exp RBRACE
-				{ $$ = new IndexNode($1, $3); }
+				{ $$ = arena.make<IndexNode>($1, $3); }
 			| AT id
-				{ $$ = new DerefNode($2); }
+				{ $$ = arena.make<DerefNode>($2); }
 			| CARAT id
-				{ $$ = new RefNode($2); }
+				{ $$ = arena.make<RefNode>($2); }
 
 id		: ID
-		  	{ $$ = new IDNode($1); }
+		  	{ $$ = arena.make<IDNode>(tokens.line($1), tokens.col($1), tokens.sym($1)); }
 	
 %%
 
 void holeyc::Parser::error(const std::string& msg){
-	std::cout << msg << std::endl;
-	std::cerr << "syntax error" << std::endl;
+	tokens.syntaxError(msg);
 }
@@ -0,0 +1,211 @@
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "incremental.hpp"
+#include "astfile.hpp"
+#include "errors.hpp"
+#include "grammar.hh"
+#include "hash.hpp"
+#include "parse.hpp"
+#include "source.hpp"
+
+namespace holeyc{
+
+using TokenKind = holeyc::Parser::token;
+
+static const uint32_t MAGIC = 0x4e494348; //"HCIN"
+static const uint32_t VERSION = 1;
+static const size_t HEADER_WORDS = 4;
+
+/*
+Hash the tokens [begin, end), with their positions taken relative to
+the first of them, the same way the cached AST is moved
+*/
+static uint64_t hashDecl(const TokenStream& tokens, size_t begin, size_t end){
+	Hash64 hash;
+	size_t firstLine = tokens.line(begin);
+	size_t firstCol = tokens.col(begin);
+	for (size_t i = begin; i < end; i++){
+		int kind = tokens.kind(i);
+		hash.add(static_cast<uint32_t>(kind));
+		if (kind == TokenKind::ID || kind == TokenKind::STRLITERAL){
+			const std::string& text = tokens.sym(i).text();
+			hash.add(static_cast<uint32_t>(text.size()));
+			hash.add(text.data(), text.size());
+		} else {
+			hash.add(static_cast<uint32_t>(tokens.intVal(i)));
+		}
+		size_t line = tokens.line(i);
+		size_t col = tokens.col(i);
+		if (line == firstLine){ col = col - firstCol; }
+		hash.add(static_cast<uint32_t>(line - firstLine));
+		hash.add(static_cast<uint32_t>(col));
+	}
+	return hash.value();
+}
+
+/* The last run's declarations, if there is a usable cache */
+class DeclCache{
+public:
+	DeclCache(const char * path){
+		try {
+			mySource.reset(new SourceFile(path));
+		} catch (InternalError * e){
+			//No cache yet
+			delete e;
+			return;
+		}
+		const char * data = mySource->data();
+		size_t size = mySource->size();
+		uint32_t header[HEADER_WORDS];
+		if (size < sizeof(header)){ return; }
+		memcpy(header, data, sizeof(header));
+		if (header[0] != MAGIC || header[1] != VERSION){ return; }
+		size_t count = header[2];
+		size_t skip = sizeof(header) + count * sizeof(uint64_t);
+		if (size < skip){ return; }
+		try {
+			myFile.reset(new AstFile(data + skip, size - skip));
+		} catch (InternalError * e){
+			//A stale or damaged cache is just ignored
+			delete e;
+			return;
+		}
+		AstFile::Node root = myFile->root();
+		if (root.size() != count){ 
+			myFile.reset();
+			return; 
+		}
+		const char * hashes = data + sizeof(header);
+		for (size_t k = 0; k < count; k++){
+			uint64_t hash;
+			memcpy(&hash, hashes + k * sizeof(hash), sizeof(hash));
+			myDecls.emplace(hash, k);
+		}
+	}
+
+	/* The cached declaration with this hash, moved, or nullptr */
+	DeclNode * find(uint64_t hash, Arena& arena, size_t line, size_t col){
+		auto found = myDecls.find(hash);
+		if (found == myDecls.end()){ return nullptr; }
+		AstFile::Node decl = myFile->root().child(found->second);
+		return myFile->buildDecl(decl, arena, line, col);
+	}
+private:
+	std::unique_ptr<SourceFile> mySource;
+	std::unique_ptr<AstFile> myFile;
+	std::unordered_map<uint64_t, size_t> myDecls;
+};
+
+/* 
+Parse the declarations in tokens [begin, end) onto decls. Returns 
+false if they do not parse as exactly count declarations.
+*/
+static bool parseDecls(const TokenStream& tokens, size_t begin, size_t end,
+	size_t count, Arena& arena, std::vector<DeclNode *>& decls){
+	//A failure is re-parsed in full, so its messages are not wanted
+	Diagnostics discard(nullptr, 0);
+	ProgramNode * root = nullptr;
+	TokenReader reader(tokens, begin, end);
+	Parser parser(reader, arena, &root);
+	bool ok = parser.parse() == 0 && reader.errors() == 0;
+
+	if (!ok || root->globals()->size() != count){ return false; }
+	for (DeclNode * decl : *root->globals()){
+		decls.push_back(decl);
+	}
+	return true;
+}
+
+static void saveCache(ProgramNode * program, const char * cachePath){
+	AstEncoder enc;
+	uint32_t root = serialize(program, enc);
+	ArenaVector<DeclNode *>& decls = *program->globals();
+
+	//Replace the cache in one step, never leaving half of one
+	std::string tmpPath = cachePath;
+	tmpPath += ".tmp";
+	{
+		Writer out(tmpPath.c_str());
+		uint32_t header[HEADER_WORDS] = {
+			MAGIC, VERSION, static_cast<uint32_t>(decls.size()), 0
+		};
+		out.write(reinterpret_cast<const char *>(header), sizeof(header));
+		for (DeclNode * decl : decls){
+			uint64_t hash = decl->hash();
+			out.write(reinterpret_cast<const char *>(&hash), sizeof(hash));
+		}
+		enc.write(out, root);
+		out.flush();
+	}
+	if (std::rename(tmpPath.c_str(), cachePath) != 0){
+		std::string msg = "Bad cache file ";
+		msg += cachePath;
+		throw new InternalError(msg.c_str());
+	}
+}
+
+ProgramNode * parseIncremental(
+	const TokenStream& tokens, Arena& arena, const char * cachePath
+){
+	std::vector<size_t> bounds;
+	if (!splitDecls(tokens, bounds)){
+		return parseTokens(tokens, arena);
+	}
+	//Anything after the last boundary is a (broken) declaration too
+	if (bounds.empty() || bounds.back() != tokens.size()){
+		bounds.push_back(tokens.size());
+	}
+
+	ProgramNode * program = nullptr;
+	{
+		DeclCache cache(cachePath);
+		std::vector<DeclNode *> decls;
+		std::vector<uint64_t> hashes;
+		size_t begin = 0;
+		size_t pendingStart = 0; //Start of the run of changed decls
+		size_t pending = 0;
+		bool ok = true;
+		for (size_t k = 0; k < bounds.size() && ok; k++){
+			size_t end = bounds[k];
+			if (begin == end){ continue; }
+			uint64_t hash = hashDecl(tokens, begin, end);
+			hashes.push_back(hash);
+			DeclNode * reused = cache.find(hash, arena, 
+				tokens.line(begin), tokens.col(begin));
+			if (reused == nullptr){
+				if (pending == 0){ pendingStart = begin; }
+				pending++;
+			} else {
+				if (pending > 0){
+					ok = parseDecls(tokens, pendingStart, begin, 
+						pending, arena, decls);
+					pending = 0;
+				}
+				decls.push_back(reused);
+			}
+			begin = end;
+		}
+		if (ok && pending > 0){
+			ok = parseDecls(tokens, pendingStart, tokens.size(), 
+				pending, arena, decls);
+		}
+		if (!ok){
+			return parseTokens(tokens, arena);
+		}
+
+		auto globals = arena.make<ArenaVector<DeclNode *>>(arena);
+		for (size_t k = 0; k < decls.size(); k++){
+			decls[k]->setHash(hashes[k]);
+			globals->push_back(decls[k]);
+		}
+		program = arena.make<ProgramNode>(globals);
+	}
+	//The cache is unmapped by now, so it can be replaced
+	saveCache(program, cachePath);
+	return program;
+}
+
+} //End namespace holeyc
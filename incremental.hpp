@@ -0,0 +1,29 @@
+#ifndef HOLEYC_INCREMENTAL_HPP
+#define HOLEYC_INCREMENTAL_HPP
+
+#include "arena.hpp"
+#include "ast.hpp"
+#include "tokens.hpp"
+
+namespace holeyc{
+
+/**
+* Parse the same as parseTokens, reusing what the last run saved in 
+* cachePath (-i). Each top-level declaration is hashed over its 
+* tokens and their positions relative to its first token; those with
+* a hash in the cache are rebuilt from the cached AST, moved to where
+* they are now, and only the rest are parsed. If any of them has a 
+* syntax error the whole stream is parsed instead, so the result 
+* and diagnostics are always those of a full parse. The cache is
+* then replaced with this run's declarations. The cache file is:
+*
+*   header   4 x u32: magic "HCIN", version, declarations, unused
+*   hashes   u64 per declaration
+*   an AST file (see astfile.hpp) with one child per declaration
+**/
+ProgramNode * parseIncremental(
+	const TokenStream& tokens, Arena& arena, const char * cachePath);
+
+} //End namespace holeyc
+
+#endif
@@ -0,0 +1,125 @@
+#include <mutex>
+#include <vector>
+#include "hash.hpp"
+#include "intern.hpp"
+
+namespace holeyc{
+
+/* 
+The table is split into shards by hash so that threads lexing 
+different files rarely contend for the same lock. Within a shard,
+spellings map to dense local ids with open addressing over a 
+power-of-two array of slots; a slot holds id + 1, so that 0 can
+mean empty. A Symbol's id packs the local id above the shard 
+number.
+
+Spellings are kept in segments that never move once allocated
+(segment k holds 2^(k+8) entries), so text() can read them without
+taking the lock: whoever holds a Symbol got it after the spelling
+was stored.
+*/
+class InternShard{
+public:
+	InternShard() : mySlots(256, 0), myCount(0){
+		for (size_t k = 0; k < SEGMENTS; k++){ mySegments[k] = nullptr; }
+	}
+
+	~InternShard(){
+		for (size_t k = 0; k < SEGMENTS; k++){ delete[] mySegments[k]; }
+	}
+
+	uint32_t intern(uint32_t hash, const char * spelling, size_t len){
+		std::lock_guard<std::mutex> guard(myLock);
+		size_t mask = mySlots.size() - 1;
+		size_t idx = (hash >> SHARD_BITS) & mask;
+		while (mySlots[idx] != 0){
+			uint32_t id = mySlots[idx] - 1;
+			const std::string& known = text(id);
+			if (myHashes[id] == hash && known.size() == len
+			  && known.compare(0, len, spelling, len) == 0){
+				return id;
+			}
+			idx = (idx + 1) & mask;
+		}
+
+		uint32_t id = myCount++;
+		size_t seg = segmentOf(id);
+		if (mySegments[seg] == nullptr){
+			mySegments[seg] = new std::string[segmentSize(seg)];
+		}
+		mySegments[seg][id - segmentStart(seg)].assign(spelling, len);
+		myHashes.push_back(hash);
+		mySlots[idx] = id + 1;
+		if (myCount * 2 > mySlots.size()){ grow(); }
+		return id;
+	}
+
+	const std::string& text(uint32_t id) const {
+		size_t seg = segmentOf(id);
+		return mySegments[seg][id - segmentStart(seg)];
+	}
+
+	static const uint32_t SHARD_BITS = 4;
+
+private:
+	static const size_t SEGMENTS = 24;
+	static const size_t FIRST_BITS = 8;
+
+	static size_t segmentOf(uint32_t id){
+		//Segment k covers ids [2^(k+8) - 2^8, 2^(k+9) - 2^8)
+		unsigned long long biased = id + (1ull << FIRST_BITS);
+		int topBit = 63 - __builtin_clzll(biased);
+		return static_cast<size_t>(topBit) - FIRST_BITS;
+	}
+	static size_t segmentStart(size_t seg){
+		return (1ull << (seg + FIRST_BITS)) - (1ull << FIRST_BITS);
+	}
+	static size_t segmentSize(size_t seg){
+		return 1ull << (seg + FIRST_BITS);
+	}
+
+	void grow(){
+		std::vector<uint32_t> slots(mySlots.size() * 2, 0);
+		size_t mask = slots.size() - 1;
+		for (uint32_t id = 0; id < myCount; id++){
+			size_t idx = (myHashes[id] >> SHARD_BITS) & mask;
+			while (slots[idx] != 0){ idx = (idx + 1) & mask; }
+			slots[idx] = id + 1;
+		}
+		mySlots.swap(slots);
+	}
+
+	std::mutex myLock;
+	std::vector<uint32_t> mySlots;
+	std::vector<uint32_t> myHashes;
+	std::string * mySegments[SEGMENTS];
+	uint32_t myCount;
+};
+
+static const uint32_t SHARDS = 1u << InternShard::SHARD_BITS;
+
+static InternShard * shards(){
+	static InternShard theShards[SHARDS];
+	return theShards;
+}
+
+/* The 64-bit hash folded to 32, so that every bit plays a part */
+static uint32_t hashOf(const char * text, size_t len){
+	Hash64 hash;
+	hash.add(text, len);
+	return static_cast<uint32_t>(hash.value() ^ (hash.value() >> 32));
+}
+
+Symbol Symbol::intern(const char * text, size_t len){
+	uint32_t hash = hashOf(text, len);
+	uint32_t shard = hash & (SHARDS - 1);
+	uint32_t local = shards()[shard].intern(hash, text, len);
+	return Symbol((local << InternShard::SHARD_BITS) | shard);
+}
+
+const std::string& Symbol::text() const {
+	uint32_t shard = myId & (SHARDS - 1);
+	return shards()[shard].text(myId >> InternShard::SHARD_BITS);
+}
+
+} //End namespace holeyc
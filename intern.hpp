@@ -0,0 +1,41 @@
+#ifndef HOLEYC_INTERN_HPP
+#define HOLEYC_INTERN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace holeyc{
+
+/**
+* A compact handle for an interned identifier or string literal.
+* Every distinct spelling is stored once in a global table, so two
+* symbols are the same name exactly when their handles are equal.
+**/
+class Symbol{
+public:
+	Symbol() : myId(NONE){}
+	explicit Symbol(uint32_t idIn) : myId(idIn){}
+
+	/** Find (or add) the symbol spelled by len bytes at text **/
+	static Symbol intern(const char * text, size_t len);
+	static Symbol intern(const std::string& text){
+		return intern(text.data(), text.size());
+	}
+
+	/** The spelling of this symbol **/
+	const std::string& text() const;
+
+	uint32_t id() const { return myId; }
+	bool isNone() const { return myId == NONE; }
+	bool operator==(Symbol other) const { return myId == other.myId; }
+	bool operator!=(Symbol other) const { return myId != other.myId; }
+
+	static const uint32_t NONE = 0xffffffff;
+private:
+	uint32_t myId;
+};
+
+} //End namespace holeyc
+
+#endif
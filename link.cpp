@@ -0,0 +1,193 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <spawn.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "errors.hpp"
+#include "native.hpp"
+
+namespace holeyc{
+
+/*
+The runtime every executable is linked with. Console I/O behaves
+as the interpreter's does: output is fully buffered, and flushed
+before each read, and runtime errors are reported the same way.
+The stack limit is what calls are checked against, well short of
+the real end of the stack.
+*/
+static const char RUNTIME[] = R"runtime(
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+long holeyc_main(void);
+
+uintptr_t holeyc_stack_limit;
+
+void holeyc_fault(long line, long col, const char *msg){
+	fflush(stdout);
+	fprintf(stderr, "Runtime error [%ld,%ld]: %s\n", line, col, msg);
+	exit(1);
+}
+
+void holeyc_write_int(long val){ printf("%ld", val); }
+
+void holeyc_write_bool(long val){ fputs(val != 0 ? "true" : "false", stdout); }
+
+void holeyc_write_char(long val){ putchar((int)val); }
+
+void holeyc_write_str(const long *str){
+	for (; *str != 0; str++){ putchar((int)*str); }
+}
+
+static int is_space(int ch){
+	return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+static int next_word(void){
+	int ch;
+	fflush(stdout);
+	do { ch = getchar(); } while (is_space(ch));
+	return ch;
+}
+
+long holeyc_read_int(long line, long col){
+	int ch = next_word();
+	int negative = ch == '-';
+	uint32_t mag = 0;
+	if (negative){ ch = getchar(); }
+	if (ch < '0' || ch > '9'){
+		holeyc_fault(line, col, "Expected an int as input");
+	}
+	while (ch >= '0' && ch <= '9'){
+		mag = mag * 10 + (uint32_t)(ch - '0');
+		ch = getchar();
+	}
+	ungetc(ch, stdin);
+	return (int32_t)(negative ? 0u - mag : mag);
+}
+
+long holeyc_read_bool(long line, long col){
+	char word[6];
+	size_t len = 0;
+	int ch = next_word();
+	while (ch != EOF && !is_space(ch)){
+		if (len < sizeof(word)){ word[len] = (char)ch; }
+		len++;
+		ch = getchar();
+	}
+	ungetc(ch, stdin);
+	if ((len == 4 && memcmp(word, "true", 4) == 0)
+	  || (len == 1 && word[0] == '1')){
+		return 1;
+	}
+	if ((len == 5 && memcmp(word, "false", 5) == 0)
+	  || (len == 1 && word[0] == '0')){
+		return 0;
+	}
+	holeyc_fault(line, col, "Expected a bool as input");
+	return 0;
+}
+
+long holeyc_read_char(long line, long col){
+	int ch = next_word();
+	if (ch == EOF){ holeyc_fault(line, col, "Expected a char as input"); }
+	return (unsigned char)ch;
+}
+
+int main(void){
+	static char buffer[1 << 16];
+	struct rlimit limit;
+	char here;
+	rlim_t size = (rlim_t)1 << 30;
+	setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+	if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur < size){
+		size = limit.rlim_cur;
+	}
+	if (size < ((rlim_t)1 << 20)){ size = (rlim_t)1 << 20; }
+	holeyc_stack_limit = (uintptr_t)&here - size + (256 << 10);
+	int status = (int)holeyc_main();
+	fflush(stdout);
+	return status;
+}
+)runtime";
+
+/* A new temporary file whose path ends in suffix, or -1 */
+static int tempFile(const char * suffix, std::string& path){
+	const char * dir = getenv("TMPDIR");
+	path = dir != nullptr && dir[0] != '\0' ? dir : "/tmp";
+	path += "/holeyccXXXXXX";
+	path += suffix;
+	return mkstemps(&path[0], static_cast<int>(strlen(suffix)));
+}
+
+bool linkExecutable(const Bytecode& code, const char * exePath){
+	size_t len = strlen(exePath);
+	if (len > 2 && strcmp(exePath + len - 2, ".s") == 0){
+		//As with cc -S, just the assembly
+		Writer assembly(exePath);
+		writeAssembly(code, assembly);
+		assembly.flush();
+		return true;
+	}
+	std::string asmPath;
+	std::string runtimePath;
+	int asmFd = tempFile(".s", asmPath);
+	int runtimeFd = asmFd < 0 ? -1 : tempFile(".c", runtimePath);
+	if (runtimeFd < 0){
+		if (asmFd >= 0){
+			close(asmFd);
+			unlink(asmPath.c_str());
+		}
+		Report::err() << "Error: Could not make temporary files"
+			<< std::endl;
+		return false;
+	}
+	try {
+		Writer assembly(asmFd);
+		writeAssembly(code, assembly);
+		assembly.flush();
+		Writer runtime(runtimeFd);
+		runtime << RUNTIME;
+		runtime.flush();
+	} catch (InternalError * e){
+		close(asmFd);
+		close(runtimeFd);
+		unlink(asmPath.c_str());
+		unlink(runtimePath.c_str());
+		throw e;
+	}
+	close(asmFd);
+	close(runtimeFd);
+
+	const char * cc = getenv("CC");
+	if (cc == nullptr || cc[0] == '\0'){ cc = "cc"; }
+	std::vector<std::string> args = {
+		cc, "-O2", "-o", exePath, asmPath, runtimePath
+	};
+	std::vector<char *> argv;
+	for (std::string& arg : args){ argv.push_back(&arg[0]); }
+	argv.push_back(nullptr);
+	pid_t pid;
+	int status = -1;
+	int err = posix_spawnp(&pid, cc, nullptr, nullptr, argv.data(),
+		environ);
+	if (err == 0){
+		while (waitpid(pid, &status, 0) < 0 && errno == EINTR){}
+	}
+	unlink(asmPath.c_str());
+	unlink(runtimePath.c_str());
+	if (err != 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0){
+		Report::err() << "Error: Could not link " << exePath << " with "
+			<< cc << std::endl;
+		return false;
+	}
+	return true;
+}
+
+} // End namespace holeyc
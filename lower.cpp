@@ -0,0 +1,866 @@
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "bytecode.hpp"
+#include "errors.hpp"
+#include "symbols.hpp"
+#include "visitor.hpp"
+
+namespace holeyc{
+
+/* Where a variable or function is, once lowered */
+struct Location{
+	enum Kind : uint8_t { REG, FRAME, GLOBAL, FN };
+	Kind kind;
+	int32_t index; //register, offset from fp, address or function
+};
+
+/*
+Looks over one function's body for what decides where its locals
+go: how many there are, whose address is taken (those live in
+memory, where a pointer can reach them, instead of in registers),
+and which are assigned inside an expression (those are copied when
+read, so that the read is not changed by an assignment to its
+right).
+*/
+class LocalUses : public AstVisitor<LocalUses>{
+public:
+	using AstVisitor<LocalUses>::visit;
+	using AstVisitor<LocalUses>::post;
+
+	void find(FnDeclNode * fn){
+		myLocals = 0;
+		myAddressed.clear();
+		myReassigned.clear();
+		for (StmtNode * stmt : *fn->body()){ walk(stmt); }
+	}
+
+	int32_t locals() const { return myLocals; }
+	bool addressed(SemSymbol * sym) const {
+		return myAddressed.count(sym) != 0;
+	}
+	bool reassigned(SemSymbol * sym) const {
+		return myReassigned.count(sym) != 0;
+	}
+
+	void visit(VarDeclNode * node){ myLocals++; }
+
+	/* The assignment that is a statement is not inside anything */
+	void visit(AssignStmtNode * node){
+		later(node->assign()->lval());
+		later(node->assign()->exp());
+	}
+
+	void post(AssignExpNode * node){
+		myReassigned.insert(node->lval()->id()->semSymbol());
+	}
+
+	void post(RefNode * node){
+		myAddressed.insert(node->id()->semSymbol());
+	}
+
+private:
+	int32_t myLocals;
+	std::unordered_set<SemSymbol *> myAddressed;
+	std::unordered_set<SemSymbol *> myReassigned;
+};
+
+/*
+Lowers each function body to register bytecode. A function's
+registers are its params, then its locals, then temporaries, which
+are allocated as a stack: an expression's operands are in the
+temporaries from where it started, and once it has used them, its
+result takes the first of them.
+
+Expressions are walked in the order they are evaluated, each
+leaving what it came to on a stack for its parent: a constant, a
+register, or a comparison not yet made. An operand that is a
+constant becomes an immediate operand, one that is a local is used
+in its own register, and a comparison that is a condition becomes
+a compare-and-branch, so none of those needs an instruction of its
+own.
+*/
+class Lowerer : public AstVisitor<Lowerer>{
+public:
+	Lowerer(Bytecode& outIn) : myOut(outIn), myFirstTemp(0),
+	  myNextLocal(0), myTop(0), myRegs(0), myCells(0){}
+
+	using AstVisitor<Lowerer>::visit;
+	using AstVisitor<Lowerer>::post;
+	using AstVisitor<Lowerer>::resume;
+
+	bool lower(ProgramNode * program){
+		myOut.statics.assign(1, 0);
+		Symbol mainName = Symbol::intern("main");
+		bool hasMain = false;
+		for (DeclNode * decl : *program->globals()){
+			if (decl->kind() != NodeKind::FnDecl){
+				VarDeclNode * var = static_cast<VarDeclNode *>(decl);
+				locate(var->id(), Location::GLOBAL,
+					count(myOut.statics.size()));
+				myOut.statics.push_back(0);
+				continue;
+			}
+			FnDeclNode * fn = static_cast<FnDeclNode *>(decl);
+			if (fn->id()->sym() == mainName){
+				myOut.main = count(myOut.fns.size());
+				hasMain = true;
+			}
+			locate(fn->id(), Location::FN, count(myOut.fns.size()));
+			myOut.fns.push_back(Bytecode::Function{0, 0, 0, 0, 0});
+		}
+		if (!hasMain){
+			Report::fatal(program->line(), program->col(),
+				"No main function");
+			return false;
+		}
+		for (DeclNode * decl : *program->globals()){
+			if (decl->kind() == NodeKind::FnDecl){ walk(decl); }
+		}
+		return true;
+	}
+
+	void visit(FnDeclNode * node){
+		ArenaVector<FormalDeclNode *>& params = *node->params();
+		myUses.find(node);
+		myFirstTemp = slot(params.size()) + myUses.locals();
+		myNextLocal = slot(params.size());
+		myTop = myFirstTemp;
+		myRegs = myFirstTemp;
+		myCells = 0;
+		myFn = Bytecode::Function{count(myOut.code.size()),
+			count(params.size()), count(myFirstTemp), 0, 0};
+		for (size_t k = 0; k < params.size(); k++){
+			IDNode * id = params[k]->id();
+			int32_t reg = static_cast<int32_t>(k);
+			if (myUses.addressed(id->semSymbol())){
+				emit(Op::STOREF, myCells, reg, 0, id);
+				locate(id, Location::FRAME, myCells++);
+			} else {
+				locate(id, Location::REG, reg);
+			}
+		}
+		later(node->body());
+		later(node, END);
+	}
+
+	void resume(FnDeclNode * node, uint32_t step){
+		emit(Op::RETV, 0, 0, 0, node);
+		myFn.regs = count(myRegs == 0 ? 1 : myRegs);
+		myFn.cells = count(myCells);
+		myOut.fns[static_cast<size_t>(location(node->id()).index)] = myFn;
+	}
+
+	void visit(VarDeclNode * node){
+		IDNode * id = node->id();
+		if (myUses.addressed(id->semSymbol())){
+			locate(id, Location::FRAME, myCells++);
+		} else {
+			locate(id, Location::REG, myNextLocal++);
+		}
+	}
+
+	void visit(AssignStmtNode * node){
+		place(node->assign()->lval());
+		later(node->assign()->exp());
+		later(node, STORE);
+	}
+
+	void resume(AssignStmtNode * node, uint32_t step){
+		Value src = pop();
+		Place dst = takePlace(node);
+		store(dst, src, node);
+		myTop = dst.mark;
+	}
+
+	void visit(PostDecStmtNode * node){
+		place(static_cast<LValNode *>(node->exp()));
+		later(node, STEP);
+	}
+
+	void resume(PostDecStmtNode * node, uint32_t step){
+		stepBy(-1, node);
+	}
+
+	void visit(PostIncStmtNode * node){
+		place(static_cast<LValNode *>(node->exp()));
+		later(node, STEP);
+	}
+
+	void resume(PostIncStmtNode * node, uint32_t step){
+		stepBy(1, node);
+	}
+
+	void visit(FromConsoleStmtNode * node){
+		place(node->lval());
+		later(node, READ);
+	}
+
+	void resume(FromConsoleStmtNode * node, uint32_t step){
+		Place dst = takePlace(node);
+		Op op = Op::READI;
+		if (node->lval()->dataType() == DataType::Bool){ op = Op::READB; }
+		if (node->lval()->dataType() == DataType::Char){ op = Op::READC; }
+		if (dst.kind == Place::REG){
+			emit(op, dst.reg, 0, 0, node);
+		} else {
+			int32_t reg = temp();
+			emit(op, reg, 0, 0, node);
+			store(dst, regValue(reg, reg), node);
+		}
+		myTop = dst.mark;
+	}
+
+	void post(ToConsoleStmtNode * node){
+		Value val = pop();
+		Op op;
+		switch (node->exp()->dataType()){
+		case DataType::Bool: op = Op::WRITEB; break;
+		case DataType::Char: op = Op::WRITEC; break;
+		case DataType::CharPtr: op = Op::WRITES; break;
+		default: op = Op::WRITEI; break;
+		}
+		emit(op, reg(val, node), 0, 0, node);
+		myTop = val.mark;
+	}
+
+	void post(ReturnStmtNode * node){
+		if (node->exp() == nullptr){
+			emit(Op::RETV, 0, 0, 0, node);
+			return;
+		}
+		Value val = pop();
+		emit(Op::RET, reg(val, node), 0, 0, node);
+		myTop = val.mark;
+	}
+
+	void post(CallStmtNode * node){ myTop = pop().mark; }
+
+	void visit(IfStmtNode * node){
+		later(node->exp());
+		later(node, COND);
+		later(node->body());
+		later(node, EXIT);
+	}
+
+	void resume(IfStmtNode * node, uint32_t step){
+		if (step == COND){
+			myLabels.push_back(branch(pop(), false, 0, node));
+		} else {
+			patch(popLabel(), here());
+		}
+	}
+
+	void visit(IfElseStmtNode * node){
+		later(node->exp());
+		later(node, COND);
+		later(node->thenBody());
+		later(node, ELSE);
+		later(node->elseBody());
+		later(node, EXIT);
+	}
+
+	void resume(IfElseStmtNode * node, uint32_t step){
+		if (step == COND){
+			myLabels.push_back(branch(pop(), false, 0, node));
+		} else if (step == ELSE){
+			int32_t skip = emit(Op::JMP, 0, 0, 0, node);
+			patch(popLabel(), here());
+			myLabels.push_back(skip);
+		} else {
+			patch(popLabel(), here());
+		}
+	}
+
+	/*
+	The condition is tested before the first pass and after each,
+	rather than by a jump back to a test at the top, so each pass
+	takes one branch instead of two
+	*/
+	void visit(WhileStmtNode * node){
+		later(node->exp());
+		later(node, COND);
+		later(node->body());
+		later(node, AGAIN);
+	}
+
+	void resume(WhileStmtNode * node, uint32_t step){
+		if (step == COND){
+			myLabels.push_back(branch(pop(), false, 0, node));
+			myLabels.push_back(here());
+		} else if (step == AGAIN){
+			later(node->exp());
+			later(node, EXIT);
+		} else {
+			int32_t top = popLabel();
+			branch(pop(), true, top, node);
+			patch(popLabel(), here());
+		}
+	}
+
+	void visit(IntLitNode * node){ push(constValue(node->value())); }
+	void visit(TrueNode * node){ push(constValue(1)); }
+	void visit(FalseNode * node){ push(constValue(0)); }
+	void visit(NullPtrNode * node){ push(constValue(0)); }
+
+	void visit(CharLitNode * node){
+		push(constValue(static_cast<unsigned char>(node->value())));
+	}
+
+	void visit(StrLitNode * node){ push(addrValue(stringAt(node))); }
+
+	/* The only IDNodes walked are the pointers of IndexNodes */
+	void visit(IDNode * node){ read(node, node); }
+
+	void visit(LValNode * node){ read(node->id(), node); }
+
+	void visit(DerefNode * node){
+		read(node->id(), node);
+		Value ptr = pop();
+		pushOp(Op::LOADP, reg(ptr, node), 0, ptr.mark, node);
+	}
+
+	void visit(RefNode * node){
+		Location loc = location(node->id());
+		if (loc.kind == Location::GLOBAL){
+			push(addrValue(loc.index));
+		} else if (loc.kind == Location::FRAME){
+			pushOp(Op::ADDRF, loc.index, 0, myTop, node);
+		} else {
+			throw new InternalError("Address of a register");
+		}
+	}
+
+	void post(IndexNode * node){
+		Value index = pop();
+		Value ptr = pop();
+		int32_t ptrReg = reg(ptr, node);
+		int32_t indexReg = reg(index, node);
+		pushOp(Op::LOADX, ptrReg, indexReg, ptr.mark, node);
+	}
+
+	void visit(AssignExpNode * node){
+		place(node->lval());
+		later(node->exp());
+		later(node, STORE);
+	}
+
+	/* The assigned value is kept in a temporary of its own */
+	void resume(AssignExpNode * node, uint32_t step){
+		Value src = pop();
+		int32_t srcReg = reg(src, node);
+		if (srcReg < myFirstTemp){
+			srcReg = temp();
+			emit(Op::MOVE, srcReg, src.reg, 0, node);
+		}
+		Place dst = takePlace(node);
+		store(dst, regValue(srcReg, srcReg), node);
+		myTop = dst.mark;
+		int32_t result = temp();
+		if (result != srcReg){ emit(Op::MOVE, result, srcReg, 0, node); }
+		push(regValue(result, dst.mark));
+	}
+
+	/* The arguments go in consecutive registers, where the callee's
+	start */
+	void visit(CallExpNode * node){
+		myCalls.push_back(myTop);
+		for (ExpNode * arg : *node->args()){
+			later(arg);
+			later(node, ARG);
+		}
+		later(node, CALL);
+	}
+
+	void resume(CallExpNode * node, uint32_t step){
+		if (step == ARG){
+			Value arg = pop();
+			into(arg, arg.mark, node);
+			myTop = arg.mark;
+			temp();
+			return;
+		}
+		int32_t base = myCalls.back();
+		myCalls.pop_back();
+		emit(Op::CALL, location(node->id()).index, base, 0, node);
+		myTop = base;
+		temp();
+		push(regValue(base, base));
+	}
+
+	void post(BinaryExpNode * node){
+		Value rhs = pop();
+		Value lhs = pop();
+		switch (node->kind()){
+		case NodeKind::Plus: arith(Op::ADD, lhs, rhs, node); return;
+		case NodeKind::Minus: arith(Op::SUB, lhs, rhs, node); return;
+		case NodeKind::Times: arith(Op::MUL, lhs, rhs, node); return;
+		case NodeKind::Divide: arith(Op::DIV, lhs, rhs, node); return;
+		case NodeKind::Equals: compare(EQ, lhs, rhs, node); return;
+		case NodeKind::NotEquals: compare(NE, lhs, rhs, node); return;
+		case NodeKind::Less: compare(LT, lhs, rhs, node); return;
+		case NodeKind::LessEq: compare(LE, lhs, rhs, node); return;
+		case NodeKind::Greater: compare(GT, lhs, rhs, node); return;
+		case NodeKind::GreaterEq: compare(GE, lhs, rhs, node); return;
+		default: break;
+		}
+		throw new InternalError("Bad binary expression kind");
+	}
+
+	void visit(AndNode * node){ shortCircuit(node); }
+	void visit(OrNode * node){ shortCircuit(node); }
+
+	/*
+	The result goes where the lhs went; if the lhs settles it, the
+	rhs is jumped over
+	*/
+	void resume(AndNode * node, uint32_t step){ shortCircuit(node, step); }
+	void resume(OrNode * node, uint32_t step){ shortCircuit(node, step); }
+
+	void post(NotNode * node){
+		Value val = pop();
+		if (val.kind == Value::CONST){
+			val.a = val.a == 0 ? 1 : 0;
+			push(val);
+		} else if (val.kind == Value::CMP){
+			val.rel = negate(val.rel);
+			push(val);
+		} else {
+			pushOp(Op::NOT, val.reg, 0, val.mark, node);
+		}
+	}
+
+	void post(NegNode * node){
+		Value val = pop();
+		if (val.kind == Value::CONST){
+			val.a = wrap(-static_cast<int64_t>(val.a));
+			push(val);
+		} else {
+			pushOp(Op::NEG, reg(val, node), 0, val.mark, node);
+		}
+	}
+
+private:
+	enum Step : uint32_t { END, STORE, STEP, READ, COND, ELSE, AGAIN,
+		EXIT, ARG, CALL };
+
+	enum Rel : uint8_t { EQ, NE, LT, LE, GT, GE };
+
+	/* What an expression came to (see the class comment) */
+	struct Value{
+		enum Kind : uint8_t { CONST, ADDR, REG, CMP };
+		Kind kind;
+		Rel rel; //CMP: reg rel b
+		bool isConst; //CMP: b is a constant rather than a register
+		int32_t a; //CONST: the value; ADDR: the address; otherwise unused
+		int32_t reg; //REG: where it is; CMP: the lhs
+		int32_t b; //CMP: the rhs
+		int32_t mark; //the first temporary it may use
+		int32_t producer; //REG: the instruction that made it, or -1
+	};
+
+	/* Where an assignment goes, worked out before what is assigned */
+	struct Place{
+		enum Kind : uint8_t { REG, FRAME, GLOBAL, PTR, INDEX };
+		Kind kind;
+		int32_t reg; //REG: the register; PTR, INDEX: the pointer
+		int32_t index; //FRAME, GLOBAL: where; INDEX: the index register
+		int32_t mark;
+	};
+
+	static uint32_t count(size_t n){ return static_cast<uint32_t>(n); }
+	static uint32_t count(int32_t n){ return static_cast<uint32_t>(n); }
+	static int32_t slot(size_t n){ return static_cast<int32_t>(n); }
+
+	static int32_t wrap(int64_t val){
+		return static_cast<int32_t>(static_cast<uint32_t>(val));
+	}
+
+	static Rel negate(Rel rel){
+		static const Rel opposite[] = { NE, EQ, GE, GT, LE, LT };
+		return opposite[rel];
+	}
+
+	/* The relation that holds of b and a when rel holds of a and b */
+	static Rel swap(Rel rel){
+		static const Rel swapped[] = { EQ, NE, GT, GE, LT, LE };
+		return swapped[rel];
+	}
+
+	Value constValue(int32_t val){
+		return Value{Value::CONST, EQ, false, val, 0, 0, myTop, -1};
+	}
+
+	/* A static address, which is only ever put in a register */
+	Value addrValue(int32_t addr){
+		return Value{Value::ADDR, EQ, false, addr, 0, 0, myTop, -1};
+	}
+
+	Value regValue(int32_t reg, int32_t mark){
+		return Value{Value::REG, EQ, false, 0, reg, 0, mark, -1};
+	}
+
+	void push(Value val){ myValues.push_back(val); }
+
+	Value pop(){
+		Value val = myValues.back();
+		myValues.pop_back();
+		return val;
+	}
+
+	int32_t popLabel(){
+		int32_t label = myLabels.back();
+		myLabels.pop_back();
+		return label;
+	}
+
+	int32_t here(){ return static_cast<int32_t>(myOut.code.size()); }
+
+	int32_t emit(Op op, int32_t a, int32_t b, int32_t c, ASTNode * at){
+		myOut.code.push_back(Instr{op, a, b, c});
+		myOut.lines.push_back(static_cast<uint32_t>(at->line()));
+		myOut.cols.push_back(static_cast<uint32_t>(at->col()));
+		return here() - 1;
+	}
+
+	/* Point the jump at label (if one was needed) to target */
+	void patch(int32_t label, int32_t target){
+		if (label >= 0){ myOut.code[static_cast<size_t>(label)].a = target; }
+	}
+
+	int32_t temp(){
+		int32_t reg = myTop++;
+		if (myTop > myRegs){ myRegs = myTop; }
+		return reg;
+	}
+
+	/* Emit op, which makes a value from b and c, into a temporary */
+	void pushOp(Op op, int32_t b, int32_t c, int32_t mark, ASTNode * at){
+		myTop = mark;
+		int32_t reg = temp();
+		Value val = regValue(reg, mark);
+		val.producer = emit(op, reg, b, c, at);
+		push(val);
+	}
+
+	/* Put val in register dst */
+	void into(Value val, int32_t dst, ASTNode * at){
+		if (val.kind == Value::CONST){
+			emit(Op::LOADK, dst, val.a, 0, at);
+		} else if (val.kind == Value::ADDR){
+			emit(Op::LOADA, dst, val.a, 0, at);
+		} else if (val.kind == Value::CMP){
+			static const Op withConst[] = {
+				Op::EQK, Op::NEK, Op::LTK, Op::LEK, Op::GTK, Op::GEK
+			};
+			static const Op withReg[] = {
+				Op::EQ, Op::NE, Op::LT, Op::LE, Op::LT, Op::LE
+			};
+			if (val.isConst){
+				emit(withConst[val.rel], dst, val.reg, val.b, at);
+			} else if (val.rel == GT || val.rel == GE){
+				emit(withReg[val.rel], dst, val.b, val.reg, at);
+			} else {
+				emit(withReg[val.rel], dst, val.reg, val.b, at);
+			}
+		} else if (val.reg == dst){
+			return;
+		} else if (val.producer >= 0 && val.producer == here() - 1){
+			//What made it can just as well put it in dst
+			myOut.code.back().a = dst;
+		} else {
+			emit(Op::MOVE, dst, val.reg, 0, at);
+		}
+	}
+
+	/* A register that holds val */
+	int32_t reg(Value val, ASTNode * at){
+		if (val.kind == Value::REG){ return val.reg; }
+		int32_t dst = temp();
+		into(val, dst, at);
+		return dst;
+	}
+
+	/*
+	Jump to target if val is when; returns the jump, or -1 if val
+	is a constant that never jumps
+	*/
+	int32_t branch(Value val, bool when, int32_t target, ASTNode * at){
+		myTop = val.mark;
+		if (val.kind == Value::CONST){
+			if ((val.a != 0) != when){ return -1; }
+			return emit(Op::JMP, target, 0, 0, at);
+		}
+		if (val.kind == Value::REG){
+			return emit(when ? Op::JT : Op::JF, target, val.reg, 0, at);
+		}
+		static const Op withConst[] = {
+			Op::JEQK, Op::JNEK, Op::JLTK, Op::JLEK, Op::JGTK, Op::JGEK
+		};
+		static const Op withReg[] = {
+			Op::JEQ, Op::JNE, Op::JLT, Op::JLE, Op::JLT, Op::JLE
+		};
+		Rel rel = when ? val.rel : negate(val.rel);
+		if (val.isConst){
+			return emit(withConst[rel], target, val.reg, val.b, at);
+		}
+		if (rel == GT || rel == GE){
+			return emit(withReg[rel], target, val.b, val.reg, at);
+		}
+		return emit(withReg[rel], target, val.reg, val.b, at);
+	}
+
+	Location location(IDNode * id){
+		auto found = myLocations.find(id->semSymbol());
+		if (found == myLocations.end()){
+			throw new InternalError("Identifier with no location");
+		}
+		return found->second;
+	}
+
+	void locate(IDNode * id, Location::Kind kind, uint32_t index){
+		locate(id, kind, static_cast<int32_t>(index));
+	}
+
+	void locate(IDNode * id, Location::Kind kind, int32_t index){
+		myLocations[id->semSymbol()] = Location{kind, index};
+	}
+
+	/* Push the value of the variable id, read for at */
+	void read(IDNode * id, ASTNode * at){
+		Location loc = location(id);
+		switch (loc.kind){
+		case Location::REG:
+			if (myUses.reassigned(id->semSymbol())){
+				pushOp(Op::MOVE, loc.index, 0, myTop, at);
+			} else {
+				push(regValue(loc.index, myTop));
+			}
+			return;
+		case Location::FRAME:
+			pushOp(Op::LOADF, loc.index, 0, myTop, at);
+			return;
+		case Location::GLOBAL:
+			pushOp(Op::LOADG, loc.index, 0, myTop, at);
+			return;
+		case Location::FN:
+			break;
+		}
+		throw new InternalError("Function used as a value");
+	}
+
+	/*
+	Push where lval is, to be assigned once what is assigned has
+	been worked out. Its pointer, if it has one, is read now, and
+	its index is scheduled.
+	*/
+	void place(LValNode * lval){
+		int32_t mark = myTop;
+		if (lval->kind() == NodeKind::Deref
+		  || lval->kind() == NodeKind::Index){
+			read(lval->id(), lval);
+			Value ptr = pop();
+			int32_t ptrReg = reg(ptr, lval);
+			if (lval->kind() == NodeKind::Deref){
+				myPlaces.push_back(Place{Place::PTR, ptrReg, 0, mark});
+			} else {
+				myPlaces.push_back(Place{Place::INDEX, ptrReg, 0, mark});
+				later(static_cast<IndexNode *>(lval)->exp());
+			}
+			return;
+		}
+		Location loc = location(lval->id());
+		switch (loc.kind){
+		case Location::REG:
+			myPlaces.push_back(Place{Place::REG, loc.index, 0, mark});
+			return;
+		case Location::FRAME:
+			myPlaces.push_back(Place{Place::FRAME, 0, loc.index, mark});
+			return;
+		case Location::GLOBAL:
+			myPlaces.push_back(Place{Place::GLOBAL, 0, loc.index, mark});
+			return;
+		case Location::FN:
+			break;
+		}
+		throw new InternalError("Assignment to a function");
+	}
+
+	/* Pop the place pushed last, with its index, if it has one */
+	Place takePlace(ASTNode * at){
+		Place dst = myPlaces.back();
+		myPlaces.pop_back();
+		if (dst.kind == Place::INDEX){ dst.index = reg(pop(), at); }
+		return dst;
+	}
+
+	void store(Place dst, Value val, ASTNode * at){
+		switch (dst.kind){
+		case Place::REG: into(val, dst.reg, at); return;
+		case Place::FRAME:
+			emit(Op::STOREF, dst.index, reg(val, at), 0, at);
+			return;
+		case Place::GLOBAL:
+			emit(Op::STOREG, dst.index, reg(val, at), 0, at);
+			return;
+		case Place::PTR:
+			emit(Op::STOREP, dst.reg, reg(val, at), 0, at);
+			return;
+		case Place::INDEX:
+			emit(Op::STOREX, dst.reg, dst.index, reg(val, at), at);
+			return;
+		}
+	}
+
+	/* Load what is at src (which is not a register) into dst */
+	void load(Place src, int32_t dst, ASTNode * at){
+		switch (src.kind){
+		case Place::FRAME: emit(Op::LOADF, dst, src.index, 0, at); return;
+		case Place::GLOBAL: emit(Op::LOADG, dst, src.index, 0, at); return;
+		case Place::PTR: emit(Op::LOADP, dst, src.reg, 0, at); return;
+		case Place::INDEX:
+			emit(Op::LOADX, dst, src.reg, src.index, at);
+			return;
+		case Place::REG: break;
+		}
+		throw new InternalError("Bad place to load");
+	}
+
+	/* Add delta to the place pushed last */
+	void stepBy(int32_t delta, ASTNode * at){
+		Place dst = takePlace(at);
+		if (dst.kind == Place::REG){
+			emit(delta > 0 ? Op::INC : Op::DEC, dst.reg, 0, 0, at);
+		} else {
+			int32_t reg = temp();
+			load(dst, reg, at);
+			emit(Op::ADDK, reg, reg, delta, at);
+			store(dst, regValue(reg, reg), at);
+		}
+		myTop = dst.mark;
+	}
+
+	/* An arithmetic op, with an immediate operand where there is one */
+	void arith(Op op, Value lhs, Value rhs, ASTNode * at){
+		bool commutes = op == Op::ADD || op == Op::MUL;
+		if (lhs.kind == Value::CONST && rhs.kind != Value::CONST
+		  && (commutes || op == Op::SUB)){
+			int32_t rhsReg = reg(rhs, at);
+			Op withConst = op == Op::ADD ? Op::ADDK
+				: op == Op::MUL ? Op::MULK : Op::RSUBK;
+			pushOp(withConst, rhsReg, lhs.a, lhs.mark, at);
+			return;
+		}
+		int32_t lhsReg = reg(lhs, at);
+		if (rhs.kind == Value::CONST){
+			switch (op){
+			case Op::ADD:
+				pushOp(Op::ADDK, lhsReg, rhs.a, lhs.mark, at);
+				return;
+			case Op::SUB:
+				pushOp(Op::ADDK, lhsReg, wrap(-static_cast<int64_t>(rhs.a)),
+					lhs.mark, at);
+				return;
+			case Op::MUL:
+				pushOp(Op::MULK, lhsReg, rhs.a, lhs.mark, at);
+				return;
+			default:
+				pushOp(Op::DIVK, lhsReg, rhs.a, lhs.mark, at);
+				return;
+			}
+		}
+		int32_t rhsReg = reg(rhs, at);
+		pushOp(op, lhsReg, rhsReg, lhs.mark, at);
+	}
+
+	/* A comparison is left to whatever uses it (see branch) */
+	void compare(Rel rel, Value lhs, Value rhs, ASTNode * at){
+		Value cmp{Value::CMP, rel, false, 0, 0, 0, lhs.mark, -1};
+		if (rhs.kind == Value::CONST){
+			cmp.reg = reg(lhs, at);
+			cmp.b = rhs.a;
+			cmp.isConst = true;
+		} else if (lhs.kind == Value::CONST){
+			cmp.reg = reg(rhs, at);
+			cmp.b = lhs.a;
+			cmp.isConst = true;
+			cmp.rel = swap(rel);
+		} else {
+			cmp.reg = reg(lhs, at);
+			cmp.b = reg(rhs, at);
+		}
+		push(cmp);
+	}
+
+	void shortCircuit(BinaryExpNode * node){
+		later(node->lhs());
+		later(node, COND);
+		later(node->rhs());
+		later(node, EXIT);
+	}
+
+	void shortCircuit(BinaryExpNode * node, uint32_t step){
+		bool isAnd = node->kind() == NodeKind::And;
+		if (step == COND){
+			Value lhs = pop();
+			myTop = lhs.mark;
+			int32_t dst = temp();
+			into(lhs, dst, node);
+			myLabels.push_back(emit(isAnd ? Op::JF : Op::JT, 0, dst, 0,
+				node));
+			push(regValue(dst, lhs.mark));
+			return;
+		}
+		Value rhs = pop();
+		Value result = pop();
+		into(rhs, result.reg, node);
+		patch(popLabel(), here());
+		myTop = result.reg;
+		temp();
+		push(result);
+	}
+
+	Bytecode& myOut;
+	LocalUses myUses;
+	Bytecode::Function myFn;
+	std::unordered_map<SemSymbol *, Location> myLocations;
+	std::unordered_map<uint32_t, int32_t> myStrings; //by symbol
+	std::vector<Value> myValues;
+	std::vector<Place> myPlaces;
+	std::vector<int32_t> myLabels; //jumps to patch, and loop tops
+	std::vector<int32_t> myCalls; //where each call's registers start
+	int32_t myFirstTemp;
+	int32_t myNextLocal;
+	int32_t myTop; //the next free temporary
+	int32_t myRegs;
+	int32_t myCells;
+
+	/* The address of the chars of node's string, made once */
+	int32_t stringAt(StrLitNode * node){
+		uint32_t id = node->str().id();
+		auto found = myStrings.find(id);
+		if (found != myStrings.end()){ return found->second; }
+		int32_t addr = static_cast<int32_t>(myOut.statics.size());
+		//Between the quotes, with escapes as the lexer allows them
+		const std::string& text = node->str().text();
+		for (size_t k = 1; k + 1 < text.size(); k++){
+			char ch = text[k];
+			if (ch == '\\'){
+				k++;
+				ch = text[k] == 'n' ? '\n' : text[k] == 't' ? '\t'
+					: text[k];
+			}
+			myOut.statics.push_back(static_cast<unsigned char>(ch));
+		}
+		myOut.statics.push_back(0);
+		myStrings[id] = addr;
+		return addr;
+	}
+};
+
+bool lowerProgram(ProgramNode * program, Bytecode& out){
+	Lowerer lowerer(out);
+	return lowerer.lower(program);
+}
+
+} // End namespace holeyc
@@ -1,98 +1,683 @@
 #include <iostream>
+#include <cerrno>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "arena.hpp"
+#include "astfile.hpp"
+#include "bytecode.hpp"
+#include "cache.hpp"
+#include "diagnostics.hpp"
 #include "errors.hpp"
+#include "fastscan.hpp"
+#include "fold.hpp"
+#include "incremental.hpp"
+#include "native.hpp"
+#include "parse.hpp"
+#include "pool.hpp"
 #include "scanner.hpp"
+#include "source.hpp"
+#include "stats.hpp"
+#include "symbols.hpp"
+#include "tokfile.hpp"
+#include "types.hpp"
+#include "writer.hpp"
 
 using namespace holeyc;
 
 static void usageAndDie(){
-	std::cerr << "Usage: holeycc <infile> <options>\n"
+	std::cerr << "Usage: holeycc <infile>... <options>\n"
+	<< " <infile> may be - to read from standard input, or\n"
+	<< "   @<listFile> to read input paths from <listFile>, one per line\n"
 	<< " [-u <unparseFile>]: Unparse to <unparseFile>\n"
 	<< " [-p]: Parse the input to check syntax\n"
+	<< " [-n <nameFile>]: Resolve names, and unparse to <nameFile>\n"
+	<< "   with the type of each identifier\n"
+	<< " [-c]: Check types, after resolving names\n"
+	<< " [-r]: Run the program, once its types check, on a bytecode\n"
+	<< "   interpreter, with console input from standard input; the\n"
+	<< "   exit status is what main returns\n"
+	<< " [-o <exeFile>]: Compile the program, once its types check,\n"
+	<< "   to x86-64 assembly, and assemble and link it into <exeFile>\n"
+	<< "   with $CC (or cc); if <exeFile> ends in .s, write just the\n"
+	<< "   assembly there\n"
+	<< " [-O1]: Fold constant expressions, and propagate constants\n"
+	<< "   assigned to local variables, before anything uses the AST\n"
 	<< " [-t <tokensFile>]: Output tokens to <tokensFile>\n"
+	<< " [-T <tokenBinFile>]: Save tokens in binary to <tokenBinFile>;\n"
+	<< "   such a file can be given as an <infile> in place of source\n"
+	<< " [-a <astFile>]: Save the AST in binary to <astFile>; such\n"
+	<< "   a file can be given as an <infile> in place of source\n"
+	<< " [-j <n>]: Compile multiple inputs on <n> threads\n"
+	<< " [-P]: Parse the declarations of a single input on -j threads\n"
+	<< " [-i <cacheFile>]: Parse incrementally, re-parsing only the\n"
+	<< "   declarations that changed since <cacheFile> was saved\n"
+	<< " [-C <cacheDir>]: Keep the results of compilations in\n"
+	<< "   <cacheDir>, and replay them when given the same input\n"
+	<< "   and flags again\n"
+	<< " [--scanner=<s>]: Lex with the flex scanner (flex, the\n"
+	<< "   default), or the hand-written one using scalar code, sse2,\n"
+	<< "   avx2 or the widest of those this CPU has (simd)\n"
+	<< " [--max-errors=<n>]: Show at most <n> errors per input\n"
+	<< " [--stats]: Report the time and memory each phase took, and\n"
+	<< "   counts of tokens and AST nodes, on stderr at exit\n"
+	<< "With multiple inputs, the -t, -T, -a, -i, -u, -n and -o files are\n"
+	<< "suffixes appended to each input path (or -- for stdout)\n"
 	;
 	exit(1);
 }
 
-static void writeTokenStream(const char * inPath, const char * outPath){
-	std::ifstream inStream(inPath);
-	if (!inStream.good()){
-		std::string msg = "Bad input stream";
-		msg += inPath;
-		throw new InternalError(msg.c_str());
+/* What to do with each input */
+struct Options{
+	const char * tokensFile = nullptr;
+	const char * tokenBinFile = nullptr;
+	const char * astFile = nullptr;
+	const char * cacheFile = nullptr;
+	const char * cacheDir = nullptr;
+	bool checkParse = false;
+	bool checkTypes = false;
+	bool run = false;
+	unsigned long optLevel = 0;
+	const char * unparseFile = nullptr;
+	const char * namesFile = nullptr;
+	const char * exeFile = nullptr;
+	size_t jobs = 0;
+	bool parallelParse = false;
+	bool stats = false;
+	size_t maxErrors = 0;
+	bool flexScanner = true;
+	FastScanner::Isa scannerIsa = FastScanner::SCALAR;
+};
+
+static void lexInput(
+	const SourceFile& source, TokenStream& tokens, const Options& opts
+){
+	if (opts.flexScanner){
+		Scanner scanner(source, tokens);
+		scanner.tokenize();
+	} else {
+		FastScanner scanner(source, tokens, opts.scannerIsa);
+		scanner.tokenize();
+	}
+}
+
+/* Set the scanner named by --scanner= */
+static void chooseScanner(const char * name, Options& opts){
+	struct Choice{ const char * name; FastScanner::Isa isa; };
+	static const Choice CHOICES[] = {
+		{"scalar", FastScanner::SCALAR},
+		{"sse2", FastScanner::SSE2},
+		{"avx2", FastScanner::AVX2},
+		{"simd", FastScanner::best()},
+	};
+	if (strcmp(name, "flex") == 0){
+		opts.flexScanner = true;
+		return;
+	}
+	for (const Choice& choice : CHOICES){
+		if (strcmp(name, choice.name) != 0){ continue; }
+		if (!FastScanner::supported(choice.isa)){
+			std::cerr << "Scanner " << name 
+				<< " is not supported here" << std::endl;
+			exit(1);
+		}
+		opts.flexScanner = false;
+		opts.scannerIsa = choice.isa;
+		return;
 	}
+	std::cerr << "Unrecognized scanner: " << name << std::endl;
+	usageAndDie();
+}
+
+/* The count text spells out in decimal, for option, or die */
+static unsigned long countArg(const char * option, const char * text){
+	char * end = nullptr;
+	errno = 0;
+	unsigned long count = strtoul(text, &end, 10);
+	if (text[0] < '0' || text[0] > '9' || *end != '\0' || errno != 0){
+		std::cerr << "Bad count for " << option << ": " << text 
+			<< std::endl;
+		usageAndDie();
+	}
+	return count;
+}
+
+/*
+Hand emit a Writer for outPath: the named file, or stdout for --.
+When recording for the cache, a copy of a file's contents is kept 
+in record as role.
+*/
+template <typename Emit>
+static void writeOutput(const char * outPath, 
+	CacheEntry::Target role, CacheEntry * record, Emit emit
+){
+	if (record != nullptr && strcmp(outPath, "--") != 0){
+		std::ostringstream copy;
+		{
+			Writer out(copy);
+			emit(out);
+			out.flush();
+		}
+		std::string text = copy.str();
+		record->add(role, text.data(), text.size());
+		Writer out(outPath);
+		out.write(text.data(), text.size());
+		out.flush();
+	} else if (strcmp(outPath, "--") != 0){
+		Writer out(outPath);
+		emit(out);
+		out.flush();
+	} else if (&Report::out() == &std::cout){
+		// Bypass cout, once it has given up what it holds
+		std::cout.flush();
+		Writer out(STDOUT_FILENO);
+		emit(out);
+		out.flush();
+	} else {
+		Writer out(Report::out());
+		emit(out);
+		out.flush();
+	}
+}
+
+static void writeTokenStream(
+	TokenStream& tokens, const char * outPath, CacheEntry * record
+){
 	if (outPath == nullptr){
 		std::string msg = "No tokens output file given";
 		throw new InternalError(msg.c_str());
 	}
+	writeOutput(outPath, CacheEntry::TOKENS, record, 
+		[&](Writer& out){ tokens.outputTokens(out); });
+}
 
-	Scanner scanner(&inStream);
-	if (strcmp(outPath, "--") == 0){
-		scanner.outputTokens(std::cout);
-	} else {
-		std::ofstream outStream(outPath);
-		if (!outStream.good()){
-			std::string msg = "Bad output file ";
-			msg += outPath;
-			throw new InternalError(msg.c_str());
-		}
-		scanner.outputTokens(outStream);
-		outStream.close();
+static void writeTokenFile(
+	TokenStream& tokens, const char * outPath, CacheEntry * record
+){
+	writeOutput(outPath, CacheEntry::TOKEN_BIN, record, 
+		[&](Writer& out){ TokenFile::write(tokens, out); });
+}
+
+static void writeAstFile(
+	ProgramNode * ast, const char * outPath, CacheEntry * record
+){
+	AstEncoder enc;
+	uint32_t root = serialize(ast, enc);
+	writeOutput(outPath, CacheEntry::AST, record, 
+		[&](Writer& out){ enc.write(out, root); });
+}
+
+static holeyc::ProgramNode * syntacticAnalysis(TokenStream& tokens, 
+	Arena& arena, const Options& opts, bool batch, const char * cacheFile
+){
+	if (cacheFile != nullptr){
+		return parseIncremental(tokens, arena, cacheFile);
+	}
+	// A batch already keeps every thread busy with whole inputs
+	if (opts.parallelParse && !batch){
+		WorkerPool pool(opts.jobs);
+		return parseTokensParallel(tokens, arena, pool);
 	}
+	return parseTokens(tokens, arena);
 }
 
-static bool parse(const char * inFile){
-	std::ifstream inStream(inFile);
-	if (!inStream.good()){
-		std::string msg = "Bad input stream ";
-		msg += inFile;
-		throw new InternalError(msg.c_str());
+static void doUnparsing(
+	holeyc::ProgramNode * ast, const char * outPath, CacheEntry * record
+){
+	if (outPath == nullptr){ 
+		Report::err() << "No output path\n"; 
+		return;
 	}
 
-	holeyc::ProgramNode * root = nullptr;
-	holeyc::Scanner scanner(&inStream);
-	holeyc::Parser parser(scanner, &root);
-	int errCode = parser.parse();
-	if (errCode != 0){ return false; }
+	writeOutput(outPath, CacheEntry::UNPARSE, record, 
+		[&](Writer& out){ unparse(ast, out); });
+}
 
-	return true;
+static void writeNames(
+	holeyc::ProgramNode * ast, const char * outPath, CacheEntry * record
+){
+	writeOutput(outPath, CacheEntry::NAMES, record, 
+		[&](Writer& out){ unparse(ast, out, true); });
 }
 
-static holeyc::ProgramNode * syntacticAnalysis(const char * inFile){
-	std::ifstream inStream(inFile);
-	if (!inStream.good()){
-		std::string msg = "Bad input stream ";
-		msg += inFile;
-		throw new InternalError(msg.c_str());
+/*
+The output file given by an argument such as -t for inFile, if any.
+In a batch, the arguments are suffixes for each input's own output 
+file, except for --, which still means stdout; the path is then
+kept in storage.
+*/
+static const char * outputFile(
+	const char * inFile, const char * arg, bool batch, std::string& storage
+){
+	if (arg == nullptr || !batch || strcmp(arg, "--") == 0){ return arg; }
+	storage = strcmp(inFile, "-") == 0 ? "stdin" : inFile;
+	storage += arg;
+	return storage.c_str();
+}
+
+/* Where one input's outputs go */
+struct Outputs{
+	Outputs(const char * inFile, const Options& opts, bool batch){
+		tokensFile = outputFile(inFile, opts.tokensFile, batch, 
+			myPaths[0]);
+		tokenBinFile = outputFile(inFile, opts.tokenBinFile, batch, 
+			myPaths[1]);
+		astFile = outputFile(inFile, opts.astFile, batch, myPaths[2]);
+		cacheFile = outputFile(inFile, opts.cacheFile, batch, myPaths[3]);
+		unparseFile = outputFile(inFile, opts.unparseFile, batch, 
+			myPaths[4]);
+		namesFile = outputFile(inFile, opts.namesFile, batch, myPaths[5]);
+		exeFile = outputFile(inFile, opts.exeFile, batch, myPaths[6]);
 	}
+	Outputs(const Outputs&) = delete;
 
-	holeyc::ProgramNode * root = nullptr;
-	holeyc::Scanner scanner(&inStream);
-	holeyc::Parser parser(scanner, &root);
-	int errCode = parser.parse();
-	if (errCode != 0){ return nullptr; }
+	const char * tokensFile;
+	const char * tokenBinFile;
+	const char * astFile;
+	const char * cacheFile;
+	const char * unparseFile;
+	const char * namesFile;
+	const char * exeFile;
+private:
+	std::string myPaths[7];
+};
 
-	return root;
+static void reportError(InternalError * e, CacheEntry * record){
+	Report::err() << "Error: " << e->msg() << std::endl;
+	// e.g. an unwritable output file, which the input has no say in
+	if (record != nullptr){ record->spoil(); }
 }
 
-static void doUnparsing(holeyc::ProgramNode * ast, const char * outPath){
-	if (outPath == nullptr){ 
-		std::cerr << "No output path\n"; 
-		return;
+/*
+Compile the input in source, reporting through Report::out() and 
+Report::err(), and recording the output in record and measuring 
+the work in stats if they are not null. Returns the exit status 
+for this input.
+*/
+static int compileSource(std::unique_ptr<SourceFile>& source, 
+	const Options& opts, bool batch, const Outputs& outs, 
+	CacheEntry * record, Stats * stats
+){
+	const char * tokensFile = outs.tokensFile;
+	const char * tokenBinFile = outs.tokenBinFile;
+	const char * astFile = outs.astFile;
+	const char * unparseFile = outs.unparseFile;
+	const char * namesFile = outs.namesFile;
+	const char * exeFile = outs.exeFile;
+
+	// Owns every AST node of this compilation; all of them are
+	// freed together when it goes out of scope
+	Arena arena;
+	TokenStream tokens;
+	ProgramNode * ast = nullptr;
+	bool loadedAst = false;
+	if (stats != nullptr){ stats->countInput(); }
+	// Errors and warnings are held here and written out together,
+	// in order of position, when it goes out of scope
+	Diagnostics diags(&Report::err(), opts.maxErrors);
+	try {
+		Stats::Timer timer(stats, Stats::LEX);
+		const char * data = source->data();
+		size_t size = source->size();
+		if (TokenFile::isTokenFile(data, size)){
+			TokenFile(data, size).load(tokens);
+		} else if (AstFile::isAstFile(data, size)){
+			ast = AstFile(data, size).build(arena);
+			loadedAst = true;
+		} else {
+			lexInput(*source, tokens, opts);
+		}
+	} catch (InternalError * e){
+		reportError(e, record);
+		return 1;
 	}
+	// Tokens do not refer back to the source, so it is unmapped 
+	// as soon as it has been lexed (or, if it is a token or AST 
+	// file saved by -T or -a, loaded), unless it is to be cached 
+	// (record is not null) along with the output
+	if (record == nullptr){ source.reset(); }
+	if (stats != nullptr){ stats->countTokens(tokens); }
 
-	if (strcmp(outPath, "--") == 0){
-		ast->unparse(std::cout, 0);
-	} else {
-		std::ofstream outStream(outPath);
-		if (!outStream.good()){
-			std::string msg = "Bad output file ";
-			msg += outPath;
-			throw new holeyc::InternalError(msg.c_str());
+	if (loadedAst && (tokensFile != nullptr || tokenBinFile != nullptr)){
+		Report::err() << "Error: An AST file has no tokens" << std::endl;
+		tokensFile = nullptr;
+		tokenBinFile = nullptr;
+	}
+
+	if (tokensFile != nullptr){
+		try {
+			Stats::Timer timer(stats, Stats::OUTPUT);
+			writeTokenStream(tokens, tokensFile, record);
+		} catch (InternalError * e){
+			reportError(e, record);
+		}
+	}
+
+	if (tokenBinFile != nullptr){
+		try {
+			Stats::Timer timer(stats, Stats::OUTPUT);
+			writeTokenFile(tokens, tokenBinFile, record);
+		} catch (InternalError * e){
+			reportError(e, record);
+		}
+	}
+
+	// The syntax check and everything after it share a single parse,
+	// unless the check is all there is to do, which needs no tree
+	bool wantAst = opts.checkParse || astFile != nullptr 
+		|| unparseFile != nullptr || namesFile != nullptr 
+		|| opts.checkTypes || opts.run || exeFile != nullptr;
+	bool checkOnly = opts.checkParse && astFile == nullptr
+		&& unparseFile == nullptr && namesFile == nullptr
+		&& !opts.checkTypes && !opts.run && exeFile == nullptr
+		&& outs.cacheFile == nullptr;
+	if (checkOnly && !loadedAst){
+		Stats::Timer timer(stats, Stats::PARSE);
+		if (!recognizeTokens(tokens)){
+			diags.flush();
+			Report::err() << "Parse failed";
+		}
+	} else if (wantAst && !loadedAst){
+		try {
+			Stats::Timer timer(stats, Stats::PARSE);
+			ast = syntacticAnalysis(tokens, arena, opts, batch, 
+				outs.cacheFile);
+			if (ast == nullptr && opts.checkParse){
+				diags.flush();
+				Report::err() << "Parse failed";
+			}
+		} catch (InternalError * e){
+			reportError(e, record);
+			return 1;
+		} catch (ToDoError * e){
+			Report::err() << "ToDo: " << e->msg() << std::endl;
+			return 1;
+		}
+	}
+
+	if (opts.optLevel > 0 && ast != nullptr){
+		Stats::Timer timer(stats, Stats::FOLD);
+		foldConstants(ast, arena);
+	}
+
+	if (stats != nullptr && ast != nullptr){ stats->countNodes(ast); }
+
+	if (astFile != nullptr && ast != nullptr){
+		try {
+			Stats::Timer timer(stats, Stats::OUTPUT);
+			writeAstFile(ast, astFile, record);
+		} catch (InternalError * e){
+			reportError(e, record);
+		}
+	}
+
+	if (unparseFile != nullptr){
+		try {
+			if (ast){
+				Stats::Timer timer(stats, Stats::UNPARSE);
+				doUnparsing(ast, unparseFile, record);
+			}
+		} catch (InternalError * e){
+			reportError(e, record);
+			return 1;
+		} catch (ToDoError * e){
+			Report::err() << "ToDo: " << e->msg() << std::endl;
+			return 1;
+		}
+	}
+
+	// Only once everything that needs just the parse is out, since
+	// failing here ends the compilation
+	bool checkTypes = opts.checkTypes || opts.run || exeFile != nullptr;
+	if ((namesFile != nullptr || checkTypes) && ast != nullptr){
+		bool named;
+		{
+			Stats::Timer timer(stats, Stats::NAMES);
+			named = nameAnalysis(ast, arena);
+		}
+		if (!named){
+			diags.flush();
+			Report::err() << "Name analysis failed";
+			return 1;
+		}
+	}
+
+	if (namesFile != nullptr && ast != nullptr){
+		try {
+			Stats::Timer timer(stats, Stats::UNPARSE);
+			writeNames(ast, namesFile, record);
+		} catch (InternalError * e){
+			reportError(e, record);
+			return 1;
+		}
+	}
+
+	if (checkTypes && ast != nullptr){
+		bool typed;
+		try {
+			Stats::Timer timer(stats, Stats::TYPES);
+			// A batch already keeps every thread busy with whole inputs
+			std::unique_ptr<WorkerPool> pool;
+			if (!batch){ pool.reset(new WorkerPool(opts.jobs)); }
+			typed = typeCheck(ast, pool.get());
+		} catch (InternalError * e){
+			reportError(e, record);
+			return 1;
+		}
+		if (!typed){
+			diags.flush();
+			Report::err() << "Type check failed";
+			return 1;
 		}
-		ast->unparse(outStream, 0);
+	}
+
+	// -o and -r both start from the program lowered to bytecode
+	if (!opts.run && exeFile == nullptr){ return 0; }
+	Bytecode code;
+	bool lowered = ast != nullptr;
+	try {
+		Stats::Timer timer(stats, Stats::LOWER);
+		if (lowered){ lowered = lowerProgram(ast, code); }
+	} catch (InternalError * e){
+		reportError(e, record);
+		return 1;
+	}
+	// Warnings come out before anything the program writes
+	diags.flush();
+	if (!lowered){
+		Report::err() << (opts.run ? "Run failed" : "Code generation failed");
+		return 1;
+	}
+
+	if (exeFile != nullptr){
+		bool linked;
+		try {
+			Stats::Timer timer(stats, Stats::CODEGEN);
+			linked = linkExecutable(code, exeFile);
+		} catch (InternalError * e){
+			reportError(e, record);
+			return 1;
+		}
+		if (!linked){ return 1; }
+	}
+
+	if (opts.run){
+		uint64_t executed = 0;
+		int status;
+		{
+			Stats::Timer timer(stats, Stats::RUN);
+			status = runBytecode(code, std::cin, executed);
+		}
+		if (stats != nullptr){ stats->countInstructions(executed); }
+		return status;
+	}
+
+	return 0;
+}
+
+/* The flags that decide what a compilation puts out, for -C */
+static std::string cacheFlags(const Options& opts, const Outputs& outs){
+	const char * files[] = { 
+		outs.tokensFile, outs.tokenBinFile, outs.astFile, outs.unparseFile,
+		outs.namesFile
+	};
+	std::string flags = opts.checkParse ? "p" : "-";
+	flags += opts.checkTypes ? "c" : "-";
+	flags += opts.optLevel > 0 ? "O" : "-";
+	for (const char * file : files){
+		if (file == nullptr){ flags += "-"; }
+		else if (strcmp(file, "--") == 0){ flags += "s"; }
+		else { flags += "f"; }
+	}
+	flags += std::to_string(opts.maxErrors);
+	return flags;
+}
+
+/* Put out what a cached compilation did; returns its exit status */
+static int replay(const CacheEntry& entry, const Outputs& outs){
+	for (const CacheEntry::Chunk& chunk : entry.chunks()){
+		const char * outPath = nullptr;
+		switch (chunk.target){
+		case CacheEntry::OUT:
+			Report::out() << chunk.data;
+			continue;
+		case CacheEntry::ERR:
+			Report::err() << chunk.data;
+			continue;
+		case CacheEntry::TOKENS: outPath = outs.tokensFile; break;
+		case CacheEntry::TOKEN_BIN: outPath = outs.tokenBinFile; break;
+		case CacheEntry::AST: outPath = outs.astFile; break;
+		case CacheEntry::UNPARSE: outPath = outs.unparseFile; break;
+		case CacheEntry::NAMES: outPath = outs.namesFile; break;
+		default: break;
+		}
+		if (outPath == nullptr){ continue; }
+		try {
+			Writer out(outPath);
+			out << chunk.data;
+			out.flush();
+		} catch (InternalError * e){
+			Report::err() << "Error: " << e->msg() << std::endl;
+		}
+	}
+	return entry.status();
+}
+
+/*
+Compile a single input, reporting through Report::out() and 
+Report::err(), and adding to stats if it is not null. Returns the
+exit status for this input.
+*/
+static int compile(const char * inFile, const Options& opts, bool batch,
+	Stats * stats
+){
+	Outputs outs(inFile, opts, batch);
+	std::unique_ptr<SourceFile> source;
+	try {
+		source.reset(new SourceFile(inFile));
+	} catch (InternalError * e){
+		Report::err() << "Error: " << e->msg() << std::endl;
+		return 1;
+	}
+	// A run depends on its console input as well, and an executable
+	// is not among the outputs kept, so neither is cached
+	if (opts.cacheDir == nullptr || opts.run || opts.exeFile != nullptr){
+		return compileSource(source, opts, batch, outs, nullptr, stats);
+	}
+
+	// With -C, a compilation that has been done before, with the
+	// same input and flags, is replayed instead of being redone
+	std::unique_ptr<CompileCache> cache;
+	try {
+		cache.reset(new CompileCache(opts.cacheDir));
+	} catch (InternalError * e){
+		Report::err() << "Error: " << e->msg() << std::endl;
+		return 1;
+	}
+	CompileCache::Key key = CompileCache::key(source->data(), 
+		source->size(), cacheFlags(opts, outs));
+	CacheEntry cached;
+	if (cache->load(key, cached)){
+		return replay(cached, outs);
+	}
+
+	std::ostream& prevOut = Report::out();
+	std::ostream& prevErr = Report::err();
+	CacheEntry record(prevOut, prevErr);
+	Report::redirect(&record.out(), &record.err());
+	int status = compileSource(source, opts, batch, outs, &record, stats);
+	Report::redirect(&prevOut, &prevErr);
+	record.setStatus(status);
+	cache->store(key, record);
+	return status;
+}
+
+/*
+Compile every input on a worker pool. Each input gets its own 
+scanner, parser and arena, and its stdout and stderr text is 
+collected separately, then printed in input order once all of 
+them are done. Each input's stats are measured on its own thread
+and added to stats.
+*/
+static int compileBatch(
+	const std::vector<std::string>& inFiles, const Options& opts,
+	Stats * stats
+){
+	struct Result{
+		std::ostringstream out;
+		std::ostringstream err;
+		int status = 0;
+	};
+	std::vector<Result> results(inFiles.size());
+	std::mutex statsLock;
+
+	WorkerPool pool(opts.jobs);
+	pool.run(inFiles.size(), [&](size_t i){
+		Result& res = results[i];
+		std::unique_ptr<Stats> own;
+		if (stats != nullptr){ own.reset(new Stats(true)); }
+		Report::redirect(&res.out, &res.err);
+		res.status = compile(inFiles[i].c_str(), opts, true, own.get());
+		Report::redirect(&std::cout, &std::cerr);
+		if (own != nullptr){
+			std::lock_guard<std::mutex> hold(statsLock);
+			stats->merge(*own);
+		}
+	});
+
+	int status = 0;
+	for (size_t i = 0; i < inFiles.size(); i++){
+		std::cout << results[i].out.str();
+		std::string errText = results[i].err.str();
+		if (!errText.empty()){
+			std::cout.flush();
+			std::cerr << inFiles[i] << ":\n" << errText;
+			if (errText.back() != '\n'){ std::cerr << "\n"; }
+		}
+		if (results[i].status != 0){ status = results[i].status; }
+	}
+	return status;
+}
+
+/* Add the paths listed in a response file, one per line */
+static void readListFile(const char * path, std::vector<std::string>& inFiles){
+	std::ifstream list(path);
+	if (!list.good()){
+		std::cerr << "Bad input list " << path << std::endl;
+		usageAndDie();
+	}
+	std::string line;
+	while (std::getline(list, line)){
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start == std::string::npos){ continue; }
+		size_t end = line.find_last_not_of(" \t\r");
+		inFiles.push_back(line.substr(start, end - start + 1));
 	}
 }
 
@@ -102,41 +687,84 @@ main( const int argc, const char **argv )
 	if (argc == 0){
 		usageAndDie();
 	}
-	const char * inFile = NULL;
-	const char * tokensFile = NULL;
-	bool checkParse = false;
-	const char * unparseFile = NULL;
+	std::vector<std::string> inFiles;
+	Options opts;
 	bool useful = false;
-	int i = 1;
 	for (int i = 1 ; i < argc ; i++){
-		if (argv[i][0] == '-'){
+		if (strcmp(argv[i], "--stats") == 0){
+			opts.stats = true;
+		} else if (strncmp(argv[i], "--scanner=", 10) == 0){
+			chooseScanner(argv[i] + 10, opts);
+		} else if (strncmp(argv[i], "--max-errors=", 13) == 0){
+			opts.maxErrors = countArg("--max-errors", argv[i] + 13);
+		} else if (argv[i][0] == '-' && argv[i][1] != '\0'){
 			if (argv[i][1] == 't'){
 				i++;
-				tokensFile = argv[i];
+				opts.tokensFile = argv[i];
+				useful = true;
+			} else if (argv[i][1] == 'T'){
+				i++;
+				if (i == argc){ usageAndDie(); }
+				opts.tokenBinFile = argv[i];
 				useful = true;
+			} else if (argv[i][1] == 'a'){
+				i++;
+				if (i == argc){ usageAndDie(); }
+				opts.astFile = argv[i];
+				useful = true;
+			} else if (argv[i][1] == 'i'){
+				i++;
+				if (i == argc){ usageAndDie(); }
+				opts.cacheFile = argv[i];
+			} else if (argv[i][1] == 'C'){
+				i++;
+				if (i == argc){ usageAndDie(); }
+				opts.cacheDir = argv[i];
 			} else if (argv[i][1] == 'p'){
-				checkParse = true;
+				opts.checkParse = true;
+				useful = true;
+			} else if (argv[i][1] == 'c'){
+				opts.checkTypes = true;
+				useful = true;
+			} else if (argv[i][1] == 'o'){
+				i++;
+				if (i == argc){ usageAndDie(); }
+				opts.exeFile = argv[i];
+				useful = true;
+			} else if (argv[i][1] == 'r'){
+				opts.run = true;
 				useful = true;
 			} else if (argv[i][1] == 'u'){
 				i++;
-				unparseFile = argv[i];
+				opts.unparseFile = argv[i];
 				useful = true;
+			} else if (argv[i][1] == 'n'){
+				i++;
+				if (i == argc){ usageAndDie(); }
+				opts.namesFile = argv[i];
+				useful = true;
+			} else if (argv[i][1] == 'j'){
+				i++;
+				if (i == argc){ usageAndDie(); }
+				opts.jobs = countArg("-j", argv[i]);
+			} else if (argv[i][1] == 'P'){
+				opts.parallelParse = true;
+			} else if (argv[i][1] == 'O'){
+				// As with cc, a bare -O is -O1
+				opts.optLevel = argv[i][2] == '\0' ? 1 
+					: countArg("-O", argv[i] + 2);
 			} else {
 				std::cerr << "Unrecognized argument: ";
 				std::cerr << argv[i] << std::endl;
 				usageAndDie();
 			}
+		} else if (argv[i][0] == '@'){
+			readListFile(argv[i] + 1, inFiles);
 		} else {
-			if (inFile == NULL){
-				inFile = argv[i];
-			} else {
-				std::cerr << "Only 1 input file allowed";
-				std::cerr << argv[i] << std::endl;
-				usageAndDie();
-			}
+			inFiles.push_back(argv[i]);
 		}
 	}
-	if (inFile == nullptr){
+	if (inFiles.empty()){
 		usageAndDie();
 	}
 	if (!useful){
@@ -144,40 +772,18 @@ main( const int argc, const char **argv )
 		usageAndDie();
 	}
 
-	if (tokensFile != nullptr){
-		try {
-			writeTokenStream(inFile, tokensFile);
-		} catch (InternalError * e){
-			std::cerr << "Error: " << e->msg() << std::endl;
-		}
-	}
-
-	if (checkParse){
-		try {
-			bool parsed = parse(inFile);
-			if (!parsed){
-				std::cerr << "Parse failed";
-			}
-		} catch (ToDoError * e){
-			std::cerr << "ToDo: " << e->msg() << std::endl;
-			exit(1);
-		}
+	// Only a batch has other threads' work to keep out of CPU times
+	std::unique_ptr<Stats> stats;
+	if (opts.stats){ stats.reset(new Stats(inFiles.size() > 1)); }
+	int status;
+	if (inFiles.size() == 1){
+		status = compile(inFiles[0].c_str(), opts, false, stats.get());
+	} else {
+		status = compileBatch(inFiles, opts, stats.get());
 	}
-
-	if (unparseFile != nullptr){
-		try {
-			ProgramNode * ast = syntacticAnalysis(inFile);
-			if (ast){
-				doUnparsing(ast, unparseFile);
-			}
-		} catch (InternalError * e){
-			std::cerr << "Error: " << e->msg() << std::endl;
-			exit(1);
-		} catch (ToDoError * e){
-			std::cerr << "ToDo: " << e->msg() << std::endl;
-			exit(1);
-		}
+	if (stats != nullptr){
+		std::cout.flush();
+		stats->print(std::cerr);
 	}
-	
-	return 0;
+	return status;
 }
@@ -0,0 +1,127 @@
+#include "errors.hpp"
+#include "symbols.hpp"
+#include "types.hpp"
+#include "visitor.hpp"
+
+namespace holeyc{
+
+/*
+Declares each name as the walk reaches its declaration and resolves
+each use against what is in scope there. A function's formals and
+the top level of its body share a scope; every other body (of an
+if, else or while) has one of its own. A function is declared
+before its body is walked, so it can call itself.
+*/
+class NameAnalyzer : public AstVisitor<NameAnalyzer>{
+public:
+	NameAnalyzer(Arena& arenaIn) : myArena(arenaIn), myOk(true){}
+
+	using AstVisitor<NameAnalyzer>::visit;
+
+	void visit(ProgramNode * node){
+		myTable.enterScope();
+		later(node->globals());
+	}
+
+	void visit(VarDeclNode * node){
+		declareVar(node, node->type(), node->id());
+	}
+
+	void visit(FormalDeclNode * node){
+		declareVar(node, node->type(), node->id());
+	}
+
+	void visit(FnDeclNode * node){
+		SemSymbol * sym = myArena.make<SemSymbol>(SemSymbol::FN, node,
+			DataType::Fn);
+		declare(node->id(), sym);
+		myTable.enterScope();
+		later(node->params());
+		later(node->body());
+		later(node, EXIT);
+	}
+
+	void visit(IfStmtNode * node){
+		later(node->exp());
+		later(node, ENTER);
+		later(node->body());
+		later(node, EXIT);
+	}
+
+	void visit(IfElseStmtNode * node){
+		later(node->exp());
+		later(node, ENTER);
+		later(node->thenBody());
+		later(node, EXIT);
+		later(node, ENTER);
+		later(node->elseBody());
+		later(node, EXIT);
+	}
+
+	void visit(WhileStmtNode * node){
+		later(node->exp());
+		later(node, ENTER);
+		later(node->body());
+		later(node, EXIT);
+	}
+
+	/* Every IDNode walked is a use: declarations do not walk theirs */
+	void visit(IDNode * node){
+		SemSymbol * sym = myTable.lookup(node->sym());
+		if (sym == nullptr){
+			error(node, "Undeclared identifier");
+			return;
+		}
+		node->attachSymbol(sym);
+	}
+
+	void resume(ASTNode * node, uint32_t step){
+		if (step == ENTER){ myTable.enterScope(); }
+		else { myTable.exitScope(); }
+	}
+
+	bool ok(){ return myOk; }
+
+private:
+	enum Step : uint32_t { ENTER, EXIT };
+
+	/* A void variable is reported, and left undeclared */
+	void declareVar(DeclNode * decl, TypeNode * type, IDNode * id){
+		DataType declared = declaredType(type);
+		if (declared != DataType::Void){
+			declare(id, myArena.make<SemSymbol>(SemSymbol::VAR, decl,
+				declared));
+			return;
+		}
+		error(id, "Invalid type in declaration");
+		if (myTable.inCurrentScope(id->sym())){
+			error(id, "Multiply declared identifier");
+		}
+	}
+
+	void declare(IDNode * id, SemSymbol * sym){
+		if (myTable.inCurrentScope(id->sym())){
+			error(id, "Multiply declared identifier");
+			return;
+		}
+		myTable.declare(id->sym(), sym);
+		id->attachSymbol(sym);
+	}
+
+	void error(IDNode * id, const char * msg){
+		Report::fatal(id->line(), id->col(), msg);
+		myOk = false;
+	}
+
+	Arena& myArena;
+	SymbolTable myTable;
+	bool myOk;
+};
+
+bool nameAnalysis(ProgramNode * program, Arena& arena){
+	NameAnalyzer analyzer(arena);
+	analyzer.walk(program);
+	return analyzer.ok();
+}
+
+} // End namespace holeyc
@@ -0,0 +1,913 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "errors.hpp"
+#include "native.hpp"
+
+namespace holeyc{
+
+/* The x86-64 general purpose registers, in encoding order */
+enum Reg : int8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+	R8, R9, R10, R11, R12, R13, R14, R15, NO_REG = -1 };
+
+static const char * const REG64[] = {
+	"%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+	"%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "%r15"
+};
+
+static const char * const REG32[] = {
+	"%eax", "%ecx", "%edx", "%ebx", "%esp", "%ebp", "%esi", "%edi",
+	"%r8d", "%r9d", "%r10d", "%r11d", "%r12d", "%r13d", "%r14d", "%r15d"
+};
+
+/*
+A value that is live across a call is kept in a register that
+callees save; any other may also go in one that calls clobber. RAX,
+RCX and RDX are left over, for spilled operands, division and
+results.
+*/
+static const Reg SAVED[] = { RBX, R12, R13, R14, R15 };
+static const Reg CLOBBERED[] = { RSI, RDI, R8, R9, R10, R11 };
+
+static bool isSaved(Reg reg){
+	return std::find(std::begin(SAVED), std::end(SAVED), reg)
+		!= std::end(SAVED);
+}
+
+static bool isJump(Op op){ return op >= Op::JMP && op <= Op::JGEK; }
+
+/* Whether op calls out, clobbering the registers calls may */
+static bool isCall(Op op){
+	return op == Op::CALL || (op >= Op::WRITEI && op <= Op::READC);
+}
+
+/* The register op writes, or -1 */
+static int32_t defOf(const Instr& in){
+	switch (in.op){
+	case Op::STOREG: case Op::STOREF: case Op::STOREP: case Op::STOREX:
+	case Op::RET: case Op::RETV:
+	case Op::WRITEI: case Op::WRITEB: case Op::WRITEC: case Op::WRITES:
+		return -1;
+	case Op::CALL:
+		return in.b;
+	default:
+		return isJump(in.op) ? -1 : in.a;
+	}
+}
+
+/* Call use with each register in reads */
+template <typename Use>
+static void forUses(const Instr& in, const Bytecode& code, Use use){
+	switch (in.op){
+	case Op::LOADK: case Op::LOADA: case Op::LOADG: case Op::LOADF:
+	case Op::ADDRF: case Op::JMP: case Op::RETV:
+	case Op::READI: case Op::READB: case Op::READC:
+		return;
+	case Op::STOREG: case Op::STOREF:
+		use(in.b);
+		return;
+	case Op::STOREP:
+		use(in.a);
+		use(in.b);
+		return;
+	case Op::STOREX:
+		use(in.a);
+		use(in.b);
+		use(in.c);
+		return;
+	case Op::INC: case Op::DEC: case Op::RET:
+	case Op::WRITEI: case Op::WRITEB: case Op::WRITEC: case Op::WRITES:
+		use(in.a);
+		return;
+	case Op::CALL:
+		for (uint32_t k = 0; k < code.fns[static_cast<size_t>(in.a)].params;
+		  k++){
+			use(in.b + static_cast<int32_t>(k));
+		}
+		return;
+	case Op::ADD: case Op::SUB: case Op::MUL: case Op::DIV:
+	case Op::EQ: case Op::NE: case Op::LT: case Op::LE:
+	case Op::JEQ: case Op::JNE: case Op::JLT: case Op::JLE:
+	case Op::LOADX:
+		use(in.b);
+		use(in.c);
+		return;
+	default:
+		use(in.b);
+		return;
+	}
+}
+
+/* Where one function's registers went, and what its frame holds */
+struct NativeFrame{
+	std::vector<Reg> regs; //by bytecode register; NO_REG if in memory
+	std::vector<int32_t> offsets; //from %rbp, of those in memory
+	std::vector<bool> atEntry; //live on entry, so set by the prologue
+	std::vector<Reg> saved; //the callee-saved registers it uses
+	int32_t cells; //offset from %rbp of its first cell
+	int32_t size; //bytes of frame below the saved registers
+};
+
+/*
+Allocates the bytecode registers of each function to machine
+registers by linear scan. Each register's interval runs from the
+first to the last instruction where it is live, found by the usual
+backwards dataflow over basic blocks, so that a temporary reused by
+many statements holds one machine register throughout, but may be
+clobbered by calls where it is dead. Intervals are taken in order
+of their starts; when no register is free, whichever of the new
+interval and the active ones ends last is spilled to the frame.
+*/
+class RegisterAllocator{
+public:
+	RegisterAllocator(const Bytecode& codeIn) : myCode(codeIn), myWords(0){}
+
+	NativeFrame allocate(size_t fnIndex){
+		const Bytecode::Function& fn = myCode.fns[fnIndex];
+		myBegin = fn.entry;
+		size_t end = fnIndex + 1 < myCode.fns.size()
+			? myCode.fns[fnIndex + 1].entry : myCode.code.size();
+		size_t count = end - myBegin;
+		size_t regs = fn.regs;
+		myWords = (regs + 63) / 64;
+		findBlocks(count);
+		findLiveness(regs);
+
+		//Each register's interval, and whether it is live across a call
+		const int64_t NONE = INT64_MAX;
+		std::vector<int64_t> first(regs, NONE);
+		std::vector<int64_t> last(regs, -1);
+		std::vector<bool> crossing(regs, false);
+		auto touch = [&](size_t reg, int64_t at){
+			first[reg] = std::min(first[reg], at);
+			last[reg] = std::max(last[reg], at);
+		};
+		for (size_t b = 0; b < myStarts.size(); b++){
+			int64_t start = static_cast<int64_t>(myStarts[b]);
+			int64_t stop = static_cast<int64_t>(blockEnd(b, count)) - 1;
+			forBits(liveIn(b), [&](size_t reg){
+				touch(reg, b == 0 ? -1 : start);
+			});
+			forBits(liveOut(b), [&](size_t reg){ touch(reg, stop); });
+			std::vector<uint64_t> live(liveOut(b), liveOut(b) + myWords);
+			for (int64_t i = stop; i >= start; i--){
+				const Instr& in = instr(static_cast<size_t>(i));
+				int32_t def = defOf(in);
+				if (isCall(in.op)){
+					forBits(live.data(), [&](size_t reg){
+						if (static_cast<int64_t>(reg) != def){
+							crossing[reg] = true;
+						}
+					});
+				}
+				if (def >= 0){
+					touch(index(def), i);
+					clear(live.data(), index(def));
+				}
+				forUses(in, myCode, [&](int32_t reg){
+					touch(index(reg), i);
+					set(live.data(), index(reg));
+				});
+			}
+		}
+
+		std::vector<size_t> order;
+		for (size_t reg = 0; reg < regs; reg++){
+			if (first[reg] != NONE){ order.push_back(reg); }
+		}
+		std::stable_sort(order.begin(), order.end(),
+			[&](size_t x, size_t y){ return first[x] < first[y]; });
+
+		NativeFrame frame;
+		frame.regs.assign(regs, NO_REG);
+		std::vector<size_t> active;
+		bool busy[16] = {};
+		for (size_t reg : order){
+			for (size_t k = active.size(); k > 0; k--){
+				size_t other = active[k - 1];
+				if (last[other] < first[reg]){
+					busy[frame.regs[other]] = false;
+					active.erase(active.begin()
+						+ static_cast<std::ptrdiff_t>(k - 1));
+				}
+			}
+			Reg chosen = NO_REG;
+			if (!crossing[reg]){ chosen = pick(CLOBBERED, busy); }
+			if (chosen == NO_REG){ chosen = pick(SAVED, busy); }
+			if (chosen != NO_REG){
+				frame.regs[reg] = chosen;
+				busy[chosen] = true;
+				active.push_back(reg);
+				continue;
+			}
+			size_t victim = regs;
+			for (size_t other : active){
+				if (crossing[reg] && !isSaved(frame.regs[other])){ continue; }
+				if (victim == regs || last[other] > last[victim]){
+					victim = other;
+				}
+			}
+			if (victim != regs && last[victim] > last[reg]){
+				frame.regs[reg] = frame.regs[victim];
+				frame.regs[victim] = NO_REG;
+				*std::find(active.begin(), active.end(), victim) = reg;
+			}
+		}
+
+		//The frame: saved registers, then spill slots, then cells
+		for (Reg reg : SAVED){
+			if (std::find(frame.regs.begin(), frame.regs.end(), reg)
+			  != frame.regs.end()){
+				frame.saved.push_back(reg);
+			}
+		}
+		int32_t words = static_cast<int32_t>(frame.saved.size());
+		frame.offsets.assign(regs, 0);
+		for (size_t reg : order){
+			if (frame.regs[reg] != NO_REG){ continue; }
+			if (reg < fn.params){
+				//A spilled param stays where its caller pushed it
+				frame.offsets[reg] = 16 + 8 * static_cast<int32_t>(reg);
+			} else {
+				frame.offsets[reg] = -8 * ++words;
+			}
+		}
+		words += static_cast<int32_t>(fn.cells);
+		frame.cells = -8 * words;
+		if (words % 2 != 0){ words++; }
+		frame.size = 8 * (words - static_cast<int32_t>(frame.saved.size()));
+		frame.atEntry.assign(regs, false);
+		forBits(liveIn(0), [&](size_t reg){ frame.atEntry[reg] = true; });
+		return frame;
+	}
+
+private:
+	const Instr& instr(size_t at){ return myCode.code[myBegin + at]; }
+
+	static size_t index(int32_t reg){ return static_cast<size_t>(reg); }
+
+	size_t target(const Instr& in){ return index(in.a) - myBegin; }
+
+	size_t blockEnd(size_t block, size_t count){
+		return block + 1 < myStarts.size() ? myStarts[block + 1] : count;
+	}
+
+	/* Blocks start at jump targets, and after jumps and returns */
+	void findBlocks(size_t count){
+		std::vector<bool> leader(count + 1, false);
+		leader[0] = true;
+		for (size_t i = 0; i < count; i++){
+			const Instr& in = instr(i);
+			if (isJump(in.op)){ leader[target(in)] = true; }
+			if (isJump(in.op) || in.op == Op::RET || in.op == Op::RETV){
+				leader[i + 1] = true;
+			}
+		}
+		myStarts.clear();
+		myBlockOf.assign(count, 0);
+		for (size_t i = 0; i < count; i++){
+			if (leader[i]){ myStarts.push_back(i); }
+			myBlockOf[i] = myStarts.size() - 1;
+		}
+		mySuccs.assign(myStarts.size() * 2, SIZE_MAX);
+		for (size_t b = 0; b < myStarts.size(); b++){
+			size_t end = blockEnd(b, count);
+			const Instr& in = instr(end - 1);
+			bool falls = in.op != Op::JMP && in.op != Op::RET
+				&& in.op != Op::RETV && end < count;
+			if (falls){ mySuccs[2 * b] = b + 1; }
+			if (isJump(in.op)){ mySuccs[2 * b + 1] = myBlockOf[target(in)]; }
+		}
+	}
+
+	void findLiveness(size_t regs){
+		size_t blocks = myStarts.size();
+		size_t count = myBlockOf.size();
+		myGen.assign(blocks * myWords, 0);
+		myKill.assign(blocks * myWords, 0);
+		myIn.assign(blocks * myWords, 0);
+		myOut.assign(blocks * myWords, 0);
+		for (size_t b = 0; b < blocks; b++){
+			uint64_t * gen = &myGen[b * myWords];
+			uint64_t * kill = &myKill[b * myWords];
+			for (size_t i = myStarts[b]; i < blockEnd(b, count); i++){
+				const Instr& in = instr(i);
+				forUses(in, myCode, [&](int32_t reg){
+					if (!test(kill, index(reg))){ set(gen, index(reg)); }
+				});
+				int32_t def = defOf(in);
+				if (def >= 0){ set(kill, index(def)); }
+			}
+		}
+		bool changed = true;
+		while (changed){
+			changed = false;
+			for (size_t b = blocks; b > 0; b--){
+				size_t block = b - 1;
+				uint64_t * out = liveOut(block);
+				for (size_t k = 0; k < 2; k++){
+					size_t succ = mySuccs[2 * block + k];
+					if (succ == SIZE_MAX){ continue; }
+					for (size_t w = 0; w < myWords; w++){
+						out[w] |= liveIn(succ)[w];
+					}
+				}
+				uint64_t * in = liveIn(block);
+				for (size_t w = 0; w < myWords; w++){
+					uint64_t next = myGen[block * myWords + w]
+						| (out[w] & ~myKill[block * myWords + w]);
+					if (next != in[w]){
+						in[w] = next;
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+
+	uint64_t * liveIn(size_t block){ return &myIn[block * myWords]; }
+	uint64_t * liveOut(size_t block){ return &myOut[block * myWords]; }
+
+	static bool test(const uint64_t * bits, size_t k){
+		return (bits[k / 64] >> (k % 64) & 1) != 0;
+	}
+	static void set(uint64_t * bits, size_t k){
+		bits[k / 64] |= uint64_t(1) << (k % 64);
+	}
+	static void clear(uint64_t * bits, size_t k){
+		bits[k / 64] &= ~(uint64_t(1) << (k % 64));
+	}
+
+	template <typename Each>
+	void forBits(const uint64_t * bits, Each each){
+		for (size_t w = 0; w < myWords; w++){
+			for (uint64_t word = bits[w]; word != 0; word &= word - 1){
+				each(w * 64 + static_cast<size_t>(__builtin_ctzll(word)));
+			}
+		}
+	}
+
+	template <size_t N>
+	static Reg pick(const Reg (&pool)[N], const bool * busy){
+		for (Reg reg : pool){
+			if (!busy[reg]){ return reg; }
+		}
+		return NO_REG;
+	}
+
+	const Bytecode& myCode;
+	size_t myBegin;
+	size_t myWords;
+	std::vector<size_t> myStarts; //of each block
+	std::vector<size_t> myBlockOf; //by instruction
+	std::vector<size_t> mySuccs; //two per block, SIZE_MAX if none
+	std::vector<uint64_t> myGen;
+	std::vector<uint64_t> myKill;
+	std::vector<uint64_t> myIn;
+	std::vector<uint64_t> myOut;
+};
+
+/*
+Writes each instruction as a few machine instructions, with its
+operands wherever the allocator put them. Ints are kept sign
+extended to 64 bits, so that they compare and index like pointers;
+arithmetic is done in 64 bits and then sign extended from 32, which
+wraps it as the interpreter does.
+
+Frame: %rbp, then the callee-saved registers used, then spill slots
+and cells. Args are pushed last to first, so a function's params are
+above its %rbp, and its result is returned in %rax. Runtime errors
+jump to stubs after the function, which call holeyc_fault with the
+position of the instruction.
+*/
+class AssemblyWriter{
+public:
+	AssemblyWriter(const Bytecode& codeIn, Writer& outIn)
+	: myCode(codeIn), myOut(outIn), myFrame(nullptr), myAt(0),
+	  myFaultCount(0){}
+
+	void write(){
+		RegisterAllocator allocator(myCode);
+		for (size_t k = 0; k < myCode.fns.size(); k++){
+			myFrames.push_back(allocator.allocate(k));
+		}
+		myOut << "\t.text\n";
+		for (size_t k = 0; k < myCode.fns.size(); k++){ function(k); }
+		myOut << "\t.section .rodata\n"
+			<< ".Lnull:\n\t.string \"Null pointer dereference\"\n"
+			<< ".Ldiv:\n\t.string \"Division by zero\"\n"
+			<< ".Lstack:\n\t.string \"Stack overflow\"\n";
+		myOut << "\t.data\n\t.p2align 3\nholeyc_statics:\n";
+		const std::vector<int64_t>& statics = myCode.statics;
+		for (size_t k = 0; k < statics.size(); k++){
+			myOut << (k % 8 == 0 ? "\t.quad " : ", ");
+			myOut << std::to_string(statics[k]);
+			if (k % 8 == 7 || k + 1 == statics.size()){ myOut << '\n'; }
+		}
+		myOut << "\t.section .note.GNU-stack,\"\",@progbits\n";
+	}
+
+private:
+	/* A runtime error to report from the instruction at at */
+	struct Fault{
+		size_t label;
+		size_t at;
+		const char * msg;
+	};
+
+	void function(size_t index){
+		const Bytecode::Function& fn = myCode.fns[index];
+		myFrame = &myFrames[index];
+		size_t begin = fn.entry;
+		size_t end = index + 1 < myCode.fns.size()
+			? myCode.fns[index + 1].entry : myCode.code.size();
+		std::string name = "holeyc_fn" + std::to_string(index);
+		myRet = ".Lret" + std::to_string(index);
+		std::vector<bool> targets(end - begin + 1, false);
+		for (size_t i = begin; i < end; i++){
+			if (isJump(myCode.code[i].op)){
+				targets[static_cast<size_t>(myCode.code[i].a) - begin] = true;
+			}
+		}
+
+		myOut << "\t.p2align 4\n";
+		if (index == myCode.main){
+			myOut << "\t.globl holeyc_main\n"
+				<< "\t.type holeyc_main, @function\nholeyc_main:\n";
+		}
+		myOut << "\t.type " << name << ", @function\n" << name << ":\n";
+		ins("pushq", "%rbp");
+		ins("movq", "%rsp", "%rbp");
+		for (Reg reg : myFrame->saved){ ins("pushq", REG64[reg]); }
+		if (myFrame->size > 0){ ins("subq", imm(myFrame->size), "%rsp"); }
+		for (size_t reg = 0; reg < fn.regs; reg++){
+			if (!myFrame->atEntry[reg]){ continue; }
+			int32_t v = static_cast<int32_t>(reg);
+			if (reg < fn.params){
+				if (inReg(v)){
+					ins("movq", std::to_string(16 + 8 * v) + "(%rbp)",
+						REG64[regOf(v)]);
+				}
+			} else if (inReg(v)){
+				ins("xorl", REG32[regOf(v)], REG32[regOf(v)]);
+			} else {
+				ins("movq", "$0", home(v));
+			}
+		}
+		for (uint32_t k = 0; k < fn.cells; k++){
+			ins("movq", "$0", cell(static_cast<int32_t>(k)));
+		}
+
+		for (size_t i = begin; i < end; i++){
+			if (targets[i - begin]){ myOut << label(i) << ":\n"; }
+			myAt = i;
+			instr(myCode.code[i], i + 1 == end);
+		}
+
+		myOut << myRet << ":\n";
+		if (myFrame->saved.empty()){
+			ins("leave");
+		} else {
+			int32_t below = 8 * static_cast<int32_t>(myFrame->saved.size());
+			ins("leaq", std::to_string(-below) + "(%rbp)", "%rsp");
+			for (size_t k = myFrame->saved.size(); k > 0; k--){
+				ins("popq", REG64[myFrame->saved[k - 1]]);
+			}
+			ins("popq", "%rbp");
+		}
+		ins("ret");
+
+		for (const Fault& fault : myFaults){
+			myOut << ".Lfault" << fault.label << ":\n";
+			ins("andq", "$-16", "%rsp");
+			ins("movl", imm(myCode.lines[fault.at]), "%edi");
+			ins("movl", imm(myCode.cols[fault.at]), "%esi");
+			ins("leaq", std::string(fault.msg) + "(%rip)", "%rdx");
+			ins("call", "holeyc_fault");
+		}
+		myFaults.clear();
+		myOut << "\t.size " << name << ", .-" << name << '\n';
+	}
+
+	void instr(const Instr& in, bool last){
+		switch (in.op){
+		case Op::MOVE:
+			if (in.a == in.b){ return; }
+			if (inReg(in.a) || inReg(in.b)){
+				ins("movq", home(in.b), home(in.a));
+			} else {
+				ins("movq", home(in.b), "%rax");
+				ins("movq", "%rax", home(in.a));
+			}
+			return;
+		case Op::LOADK:
+			if (in.b == 0 && inReg(in.a)){
+				ins("xorl", REG32[regOf(in.a)], REG32[regOf(in.a)]);
+			} else {
+				ins("movq", imm(in.b), home(in.a));
+			}
+			return;
+		case Op::LOADA: {
+			Reg dst = target(in.a, RAX);
+			ins("leaq", global(in.b), REG64[dst]);
+			finish(in.a, dst);
+			return;
+		}
+		case Op::LOADG: {
+			Reg dst = target(in.a, RAX);
+			ins("movq", global(in.b), REG64[dst]);
+			finish(in.a, dst);
+			return;
+		}
+		case Op::STOREG:
+			ins("movq", REG64[load(in.b, RAX)], global(in.a));
+			return;
+		case Op::LOADF: {
+			Reg dst = target(in.a, RAX);
+			ins("movq", cell(in.b), REG64[dst]);
+			finish(in.a, dst);
+			return;
+		}
+		case Op::STOREF:
+			ins("movq", REG64[load(in.b, RAX)], cell(in.a));
+			return;
+		case Op::ADDRF: {
+			Reg dst = target(in.a, RAX);
+			ins("leaq", cell(in.b), REG64[dst]);
+			finish(in.a, dst);
+			return;
+		}
+		case Op::LOADP: {
+			Reg ptr = pointer(in.b, RAX);
+			Reg dst = target(in.a, RCX);
+			ins("movq", "(" + std::string(REG64[ptr]) + ")", REG64[dst]);
+			finish(in.a, dst);
+			return;
+		}
+		case Op::STOREP: {
+			Reg ptr = pointer(in.a, RAX);
+			Reg src = load(in.b, RCX);
+			ins("movq", REG64[src], "(" + std::string(REG64[ptr]) + ")");
+			return;
+		}
+		case Op::LOADX: {
+			Reg ptr = pointer(in.b, RAX);
+			Reg idx = load(in.c, RCX);
+			Reg dst = target(in.a, RDX);
+			ins("movq", indexed(ptr, idx), REG64[dst]);
+			finish(in.a, dst);
+			return;
+		}
+		case Op::STOREX: {
+			Reg ptr = pointer(in.a, RAX);
+			Reg idx = load(in.b, RCX);
+			Reg src = load(in.c, RDX);
+			ins("movq", REG64[src], indexed(ptr, idx));
+			return;
+		}
+		case Op::ADD: binary("addq", in, true); return;
+		case Op::SUB: binary("subq", in, false); return;
+		case Op::MUL: binary("imulq", in, true); return;
+		case Op::DIV: {
+			ins("movq", home(in.b), "%rax");
+			Reg divisor = load(in.c, RCX);
+			ins("testq", REG64[divisor], REG64[divisor]);
+			ins("je", fault(".Ldiv"));
+			//In 64 bits, INT_MIN / -1 does not trap, and then wraps
+			ins("cqto");
+			ins("idivq", REG64[divisor]);
+			quotient(in.a);
+			return;
+		}
+		case Op::ADDK: {
+			Reg dst = target(in.a, RAX);
+			if (in.a == in.b){
+				if (dst == RAX){ ins("movq", home(in.b), "%rax"); }
+				ins("addq", imm(in.c), REG64[dst]);
+			} else if (inReg(in.b)){
+				ins("leaq", std::to_string(in.c) + "("
+					+ REG64[regOf(in.b)] + ")", REG64[dst]);
+			} else {
+				ins("movq", home(in.b), REG64[dst]);
+				ins("addq", imm(in.c), REG64[dst]);
+			}
+			wrap(dst);
+			finish(in.a, dst);
+			return;
+		}
+		case Op::MULK: {
+			Reg dst = target(in.a, RAX);
+			ins("imulq", imm(in.c), home(in.b), REG64[dst]);
+			wrap(dst);
+			finish(in.a, dst);
+			return;
+		}
+		case Op::DIVK:
+			if (in.c == 0){
+				ins("jmp", fault(".Ldiv"));
+				return;
+			}
+			if (in.c == -1){
+				unary("negq", in);
+				return;
+			}
+			//Without -1, 32 bits cannot trap, and are quicker
+			ins("movq", home(in.b), "%rax");
+			ins("cltd");
+			ins("movl", imm(in.c), "%ecx");
+			ins("idivl", "%ecx");
+			quotient(in.a);
+			return;
+		case Op::RSUBK: {
+			Reg dst = target(in.a, RAX);
+			if (in.a == in.b){
+				if (dst == RAX){ ins("movq", home(in.b), "%rax"); }
+				ins("negq", REG64[dst]);
+				ins("addq", imm(in.c), REG64[dst]);
+			} else {
+				ins("movq", imm(in.c), REG64[dst]);
+				ins("subq", home(in.b), REG64[dst]);
+			}
+			wrap(dst);
+			finish(in.a, dst);
+			return;
+		}
+		case Op::NEG: unary("negq", in); return;
+		case Op::NOT: {
+			Reg dst = target(in.a, RAX);
+			if (in.a != in.b || dst == RAX){
+				ins("movq", home(in.b), REG64[dst]);
+			}
+			ins("xorq", "$1", REG64[dst]);
+			finish(in.a, dst);
+			return;
+		}
+		case Op::INC: case Op::DEC: {
+			Reg dst = target(in.a, RAX);
+			if (dst == RAX){ ins("movq", home(in.a), "%rax"); }
+			ins(in.op == Op::INC ? "addq" : "subq", "$1", REG64[dst]);
+			wrap(dst);
+			finish(in.a, dst);
+			return;
+		}
+		case Op::EQ: case Op::NE: case Op::LT: case Op::LE:
+			compare(in.b, in.c);
+			setFlag(condition(in.op), in.a);
+			return;
+		case Op::EQK: case Op::NEK: case Op::LTK: case Op::LEK:
+		case Op::GTK: case Op::GEK:
+			compareConst(in.b, in.c);
+			setFlag(condition(in.op), in.a);
+			return;
+		case Op::JMP:
+			if (static_cast<size_t>(in.a) != myAt + 1){
+				ins("jmp", label(static_cast<size_t>(in.a)));
+			}
+			return;
+		case Op::JT: case Op::JF:
+			compareConst(in.b, 0);
+			ins(in.op == Op::JT ? "jne" : "je",
+				label(static_cast<size_t>(in.a)));
+			return;
+		case Op::JEQ: case Op::JNE: case Op::JLT: case Op::JLE:
+			compare(in.b, in.c);
+			ins(std::string("j") + condition(in.op),
+				label(static_cast<size_t>(in.a)));
+			return;
+		case Op::JEQK: case Op::JNEK: case Op::JLTK: case Op::JLEK:
+		case Op::JGTK: case Op::JGEK:
+			compareConst(in.b, in.c);
+			ins(std::string("j") + condition(in.op),
+				label(static_cast<size_t>(in.a)));
+			return;
+		case Op::CALL: call(in); return;
+		case Op::RET:
+			ins("movq", home(in.a), "%rax");
+			if (!last){ ins("jmp", myRet); }
+			return;
+		case Op::RETV:
+			ins("xorl", "%eax", "%eax");
+			if (!last){ ins("jmp", myRet); }
+			return;
+		case Op::WRITEI: write("holeyc_write_int", in); return;
+		case Op::WRITEB: write("holeyc_write_bool", in); return;
+		case Op::WRITEC: write("holeyc_write_char", in); return;
+		case Op::WRITES:
+			ins("movq", home(in.a), "%rdi");
+			ins("testq", "%rdi", "%rdi");
+			ins("je", fault(".Lnull"));
+			ins("call", "holeyc_write_str");
+			return;
+		case Op::READI: read("holeyc_read_int", in); return;
+		case Op::READB: read("holeyc_read_bool", in); return;
+		case Op::READC: read("holeyc_read_char", in); return;
+		case Op::NUM_OPS: break;
+		}
+		throw new InternalError("Bad bytecode op");
+	}
+
+	static const char * condition(Op op){
+		switch (op){
+		case Op::EQ: case Op::EQK: case Op::JEQ: case Op::JEQK: return "e";
+		case Op::NE: case Op::NEK: case Op::JNE: case Op::JNEK: return "ne";
+		case Op::LT: case Op::LTK: case Op::JLT: case Op::JLTK: return "l";
+		case Op::LE: case Op::LEK: case Op::JLE: case Op::JLEK: return "le";
+		case Op::GTK: case Op::JGTK: return "g";
+		default: return "ge";
+		}
+	}
+
+	/* dst = b op c, then wrapped */
+	void binary(const char * op, const Instr& in, bool commutes){
+		Reg dst = target(in.a, RAX);
+		if (in.a == in.c && in.a != in.b && dst != RAX){
+			//dst already holds c
+			if (commutes){
+				ins(op, home(in.b), REG64[dst]);
+			} else {
+				ins("negq", REG64[dst]);
+				ins("addq", home(in.b), REG64[dst]);
+			}
+		} else {
+			if (in.a != in.b || dst == RAX){
+				ins("movq", home(in.b), REG64[dst]);
+			}
+			ins(op, home(in.c), REG64[dst]);
+		}
+		wrap(dst);
+		finish(in.a, dst);
+	}
+
+	void unary(const char * op, const Instr& in){
+		Reg dst = target(in.a, RAX);
+		if (in.a != in.b || dst == RAX){
+			ins("movq", home(in.b), REG64[dst]);
+		}
+		ins(op, REG64[dst]);
+		wrap(dst);
+		finish(in.a, dst);
+	}
+
+	/* Put the quotient in %eax in a, sign extended */
+	void quotient(int32_t a){
+		Reg dst = target(a, RAX);
+		ins("movslq", "%eax", REG64[dst]);
+		finish(a, dst);
+	}
+
+	void compare(int32_t b, int32_t c){
+		if (inReg(b)){
+			ins("cmpq", home(c), REG64[regOf(b)]);
+		} else if (inReg(c)){
+			ins("cmpq", REG64[regOf(c)], home(b));
+		} else {
+			ins("movq", home(b), "%rax");
+			ins("cmpq", home(c), "%rax");
+		}
+	}
+
+	void compareConst(int32_t b, int32_t k){
+		if (k == 0 && inReg(b)){
+			ins("testq", REG64[regOf(b)], REG64[regOf(b)]);
+		} else {
+			ins("cmpq", imm(k), home(b));
+		}
+	}
+
+	void setFlag(const char * cond, int32_t a){
+		Reg dst = target(a, RAX);
+		ins(std::string("set") + cond, "%al");
+		ins("movzbl", "%al", REG32[dst]);
+		finish(a, dst);
+	}
+
+	/*
+	Checks first that the callee's frame fits on the stack, and keeps
+	the stack 16-byte aligned at the call, as the runtime needs
+	*/
+	void call(const Instr& in){
+		size_t index = static_cast<size_t>(in.a);
+		const Bytecode::Function& callee = myCode.fns[index];
+		const NativeFrame& frame = myFrames[index];
+		int32_t params = static_cast<int32_t>(callee.params);
+		int32_t pad = params % 2;
+		int32_t needs = 8 * (params + pad + 2)
+			+ 8 * static_cast<int32_t>(frame.saved.size()) + frame.size;
+		ins("leaq", std::to_string(-needs) + "(%rsp)", "%rax");
+		ins("cmpq", "holeyc_stack_limit(%rip)", "%rax");
+		ins("jb", fault(".Lstack"));
+		if (pad != 0){ ins("subq", "$8", "%rsp"); }
+		for (int32_t k = params; k > 0; k--){
+			ins("pushq", home(in.b + k - 1));
+		}
+		ins("call", "holeyc_fn" + std::to_string(index));
+		if (params + pad > 0){
+			ins("addq", imm(8 * (params + pad)), "%rsp");
+		}
+		ins("movq", "%rax", home(in.b));
+	}
+
+	void write(const char * fn, const Instr& in){
+		ins("movq", home(in.a), "%rdi");
+		ins("call", fn);
+	}
+
+	void read(const char * fn, const Instr& in){
+		ins("movl", imm(myCode.lines[myAt]), "%edi");
+		ins("movl", imm(myCode.cols[myAt]), "%esi");
+		ins("call", fn);
+		ins("movq", "%rax", home(in.a));
+	}
+
+	bool inReg(int32_t reg) const { return regOf(reg) != NO_REG; }
+
+	Reg regOf(int32_t reg) const {
+		return myFrame->regs[static_cast<size_t>(reg)];
+	}
+
+	/* Where reg is, as an operand */
+	std::string home(int32_t reg) const {
+		if (inReg(reg)){ return REG64[regOf(reg)]; }
+		return std::to_string(myFrame->offsets[static_cast<size_t>(reg)])
+			+ "(%rbp)";
+	}
+
+	/* The machine register reg is in, or scratch, once it is loaded */
+	Reg load(int32_t reg, Reg scratch){
+		if (inReg(reg)){ return regOf(reg); }
+		ins("movq", home(reg), REG64[scratch]);
+		return scratch;
+	}
+
+	/* Load reg, a pointer, and check that it is not null */
+	Reg pointer(int32_t reg, Reg scratch){
+		Reg ptr = load(reg, scratch);
+		ins("testq", REG64[ptr], REG64[ptr]);
+		ins("je", fault(".Lnull"));
+		return ptr;
+	}
+
+	/* The machine register to compute reg in: its own, or scratch */
+	Reg target(int32_t reg, Reg scratch) const {
+		return inReg(reg) ? regOf(reg) : scratch;
+	}
+
+	/* Store reg, computed in dst, if it lives in memory */
+	void finish(int32_t reg, Reg dst){
+		if (!inReg(reg)){ ins("movq", REG64[dst], home(reg)); }
+	}
+
+	void wrap(Reg reg){ ins("movslq", REG32[reg], REG64[reg]); }
+
+	std::string cell(int32_t k) const {
+		return std::to_string(myFrame->cells + 8 * k) + "(%rbp)";
+	}
+
+	static std::string global(int32_t addr){
+		return "holeyc_statics+" + std::to_string(8 * addr) + "(%rip)";
+	}
+
+	static std::string indexed(Reg ptr, Reg idx){
+		return std::string("(") + REG64[ptr] + "," + REG64[idx] + ",8)";
+	}
+
+	static std::string imm(int64_t val){ return "$" + std::to_string(val); }
+
+	static std::string label(size_t at){ return ".Lpc" + std::to_string(at); }
+
+	/* The label of a new stub reporting msg for the current instruction */
+	std::string fault(const char * msg){
+		myFaults.push_back(Fault{myFaultCount, myAt, msg});
+		return ".Lfault" + std::to_string(myFaultCount++);
+	}
+
+	void ins(const std::string& op, const std::string& x = std::string(),
+		const std::string& y = std::string(),
+		const std::string& z = std::string()
+	){
+		myOut << '\t' << op;
+		if (!x.empty()){ myOut << '\t' << x; }
+		if (!y.empty()){ myOut << ", " << y; }
+		if (!z.empty()){ myOut << ", " << z; }
+		myOut << '\n';
+	}
+
+	const Bytecode& myCode;
+	Writer& myOut;
+	std::vector<NativeFrame> myFrames;
+	const NativeFrame * myFrame;
+	std::string myRet; //the current function's epilogue
+	size_t myAt; //the current instruction
+	std::vector<Fault> myFaults;
+	size_t myFaultCount;
+};
+
+void writeAssembly(const Bytecode& code, Writer& out){
+	AssemblyWriter writer(code, out);
+	writer.write();
+}
+
+} // End namespace holeyc
@@ -0,0 +1,27 @@
+#ifndef HOLEYC_NATIVE_HPP
+#define HOLEYC_NATIVE_HPP
+
+#include "bytecode.hpp"
+#include "writer.hpp"
+
+namespace holeyc{
+
+/**
+* Translate code to x86-64 GNU assembly, with each function's
+* registers allocated by linear scan (see native.cpp). The program
+* starts at holeyc_main, and calls the runtime for console I/O and
+* to report runtime errors, as the interpreter would.
+**/
+void writeAssembly(const Bytecode& code, Writer& out);
+
+/**
+* Assemble and link code, with its runtime, into an executable at
+* exePath, using the C compiler $CC (cc by default), or if exePath
+* ends in .s, write just the assembly there. Returns false, having
+* reported why, if it cannot.
+**/
+bool linkExecutable(const Bytecode& code, const char * exePath);
+
+} //End namespace holeyc
+
+#endif
@@ -0,0 +1,125 @@
+#include "parse.hpp"
+#include "errors.hpp"
+#include "grammar.hh"
+#include "recognizer.hh"
+
+namespace holeyc{
+
+using TokenKind = holeyc::Parser::token;
+
+/* Don't bother splitting pieces smaller than this many tokens */
+static const size_t MIN_CHUNK_TOKENS = 4096;
+
+ProgramNode * parseTokens(const TokenStream& tokens, Arena& arena){
+	ProgramNode * root = nullptr;
+	TokenReader reader(tokens);
+	Parser parser(reader, arena, &root);
+	int errCode = parser.parse();
+	//The parser recovers from errors, but the tree it leaves is no good
+	if (errCode != 0 || reader.errors() != 0){ return nullptr; }
+	return root;
+}
+
+bool recognizeTokens(const TokenStream& tokens){
+	TokenReader reader(tokens);
+	Recognizer recognizer(reader);
+	return recognizer.parse() == 0 && reader.errors() == 0;
+}
+
+bool splitDecls(const TokenStream& tokens, std::vector<size_t>& bounds){
+	long depth = 0;
+	for (size_t i = 0; i < tokens.size(); i++){
+		int kind = tokens.kind(i);
+		if (kind == TokenKind::LCURLY){
+			depth++;
+		} else if (kind == TokenKind::RCURLY){
+			depth--;
+			if (depth < 0){ break; }
+			if (depth == 0){ bounds.push_back(i + 1); }
+		} else if (kind == TokenKind::SEMICOLON && depth == 0){
+			bounds.push_back(i + 1);
+		}
+	}
+	if (depth != 0){
+		bounds.clear();
+		return false;
+	}
+	return true;
+}
+
+/* 
+Group the declaration boundaries into at most maxChunks pieces of
+roughly equal token counts. The result holds each piece's start, 
+followed by the end of the stream.
+*/
+static std::vector<size_t> chunkStarts(
+	const TokenStream& tokens, const std::vector<size_t>& bounds, 
+	size_t maxChunks
+){
+	size_t target = tokens.size() / maxChunks;
+	if (target < MIN_CHUNK_TOKENS){ target = MIN_CHUNK_TOKENS; }
+
+	std::vector<size_t> starts;
+	starts.push_back(0);
+	for (size_t bound : bounds){
+		if (bound - starts.back() >= target && bound < tokens.size()){
+			starts.push_back(bound);
+		}
+	}
+	starts.push_back(tokens.size());
+	return starts;
+}
+
+ProgramNode * parseTokensParallel(
+	const TokenStream& tokens, Arena& arena, WorkerPool& pool
+){
+	std::vector<size_t> bounds;
+	if (!splitDecls(tokens, bounds)){
+		return parseTokens(tokens, arena);
+	}
+	std::vector<size_t> starts = chunkStarts(tokens, bounds, pool.size() * 4);
+	size_t numChunks = starts.size() - 1;
+	if (numChunks < 2){
+		return parseTokens(tokens, arena);
+	}
+
+	/* 
+	Every piece begins where the serial parser would be between two
+	declarations, so a piece parses exactly as that stretch of the 
+	whole stream would. Each piece gets its own arena, since arenas 
+	are not shared between threads.
+	*/
+	struct Chunk{
+		Arena arena;
+		ProgramNode * root = nullptr;
+		bool ok = false;
+	};
+	std::vector<Chunk> chunks(numChunks);
+	pool.run(numChunks, [&](size_t i){
+		Chunk& chunk = chunks[i];
+		//A failed piece is re-parsed serially, so its messages
+		//are not wanted
+		Diagnostics discard(nullptr, 0);
+		TokenReader reader(tokens, starts[i], starts[i + 1]);
+		Parser parser(reader, chunk.arena, &chunk.root);
+		chunk.ok = parser.parse() == 0 && reader.errors() == 0;
+	});
+
+	for (Chunk& chunk : chunks){
+		if (!chunk.ok){
+			//Re-parse serially for exactly the serial diagnostics
+			return parseTokens(tokens, arena);
+		}
+	}
+
+	auto globals = arena.make<ArenaVector<DeclNode *>>(arena);
+	for (Chunk& chunk : chunks){
+		for (DeclNode * decl : *chunk.root->globals()){
+			globals->push_back(decl);
+		}
+		arena.adopt(chunk.arena);
+	}
+	return arena.make<ProgramNode>(globals);
+}
+
+} //End namespace holeyc
@@ -0,0 +1,45 @@
+#ifndef HOLEYC_PARSE_HPP
+#define HOLEYC_PARSE_HPP
+
+#include <vector>
+#include "arena.hpp"
+#include "ast.hpp"
+#include "pool.hpp"
+#include "tokens.hpp"
+
+namespace holeyc{
+
+/** 
+* Parse the whole token stream, building the AST in arena. Returns
+* nullptr if there was a syntax error.
+**/
+ProgramNode * parseTokens(const TokenStream& tokens, Arena& arena);
+
+/**
+* Check the syntax of the whole token stream without building 
+* anything. Uses the same grammar and parse tables as parseTokens,
+* so it accepts the same streams and reports the same errors.
+**/
+bool recognizeTokens(const TokenStream& tokens);
+
+/**
+* Find the top-level declaration boundaries of a token stream: the
+* index just past every depth-zero ; and every } that closes a
+* function body. Returns false (and leaves bounds empty) if the 
+* braces do not balance, since then no split can be trusted.
+**/
+bool splitDecls(const TokenStream& tokens, std::vector<size_t>& bounds);
+
+/**
+* Parse the same as parseTokens, but split the stream at top-level
+* declaration boundaries and parse the pieces on pool. The pieces'
+* declarations are spliced back together in source order. If any
+* piece has a syntax error the whole stream is re-parsed serially,
+* so output and diagnostics always match parseTokens.
+**/
+ProgramNode * parseTokensParallel(
+	const TokenStream& tokens, Arena& arena, WorkerPool& pool);
+
+} //End namespace holeyc
+
+#endif
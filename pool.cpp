@@ -0,0 +1,122 @@
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "errors.hpp"
+#include "pool.hpp"
+
+namespace holeyc{
+
+/* 
+The jobs a worker has yet to start, [lo, hi), packed as hi << 32 | lo
+so that both ends change together. The owner takes jobs off the
+front, and an idle worker steals the back half. Padded so that no
+two workers' ranges share a cache line.
+*/
+struct JobRange{
+	std::atomic<uint64_t> bounds;
+	char pad[64 - sizeof(std::atomic<uint64_t>)];
+};
+
+static uint64_t pack(uint64_t lo, uint64_t hi){ return hi << 32 | lo; }
+static size_t lowOf(uint64_t bounds){ return bounds & 0xffffffffu; }
+static size_t highOf(uint64_t bounds){ return bounds >> 32; }
+
+/* Take the first job of range into job, if it has one */
+static bool takeFront(JobRange& range, size_t& job){
+	uint64_t bounds = range.bounds.load();
+	while (lowOf(bounds) < highOf(bounds)){
+		uint64_t rest = pack(lowOf(bounds) + 1, highOf(bounds));
+		if (range.bounds.compare_exchange_weak(bounds, rest)){
+			job = lowOf(bounds);
+			return true;
+		}
+	}
+	return false;
+}
+
+/* 
+Move the back half of the fullest other range into ranges[self],
+which is empty. False if every range is empty.
+*/
+static bool steal(std::vector<JobRange>& ranges, size_t self){
+	while (true){
+		size_t victim = self;
+		size_t most = 0;
+		for (size_t w = 0; w < ranges.size(); w++){
+			uint64_t bounds = ranges[w].bounds.load();
+			if (lowOf(bounds) >= highOf(bounds)){ continue; }
+			size_t left = highOf(bounds) - lowOf(bounds);
+			if (left > most){
+				most = left;
+				victim = w;
+			}
+		}
+		if (most == 0){ return false; }
+
+		uint64_t bounds = ranges[victim].bounds.load();
+		size_t lo = lowOf(bounds);
+		size_t hi = highOf(bounds);
+		if (lo >= hi){ continue; }
+		size_t mid = lo + (hi - lo) / 2;
+		if (ranges[victim].bounds.compare_exchange_strong(bounds, 
+			pack(lo, mid))
+		){
+			ranges[self].bounds.store(pack(mid, hi));
+			return true;
+		}
+	}
+}
+
+WorkerPool::WorkerPool(size_t threads) : myThreads(threads){
+	if (myThreads == 0){
+		myThreads = std::thread::hardware_concurrency();
+	}
+	if (myThreads == 0){ myThreads = 1; }
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t)>& job){
+	if (count == 0){ return; }
+	if (count > 0xffffffffu){ throw new InternalError("Too many jobs"); }
+	size_t workers = myThreads < count ? myThreads : count;
+	std::vector<JobRange> ranges(workers);
+	for (size_t w = 0; w < workers; w++){
+		ranges[w].bounds.store(pack(count * w / workers, 
+			count * (w + 1) / workers));
+	}
+
+	//The first exception a job throws, which stops the rest of the 
+	// batch and is rethrown here once every worker has stopped
+	std::exception_ptr failure;
+	std::mutex failureLock;
+	std::atomic<bool> failed(false);
+	auto work = [&](size_t self){
+		try {
+			size_t i;
+			do {
+				while (!failed.load() && takeFront(ranges[self], i)){
+					job(i);
+				}
+			} while (!failed.load() && steal(ranges, self));
+		} catch (...) {
+			std::lock_guard<std::mutex> hold(failureLock);
+			if (!failure){ failure = std::current_exception(); }
+			failed.store(true);
+		}
+	};
+
+	//The calling thread is one of the workers
+	std::vector<std::thread> threads;
+	for (size_t w = 1; w < workers; w++){
+		threads.emplace_back(work, w);
+	}
+	work(0);
+	for (std::thread& thread : threads){
+		thread.join();
+	}
+	if (failure){ std::rethrow_exception(failure); }
+}
+
+} //End namespace holeyc
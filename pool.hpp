@@ -0,0 +1,33 @@
+#ifndef HOLEYC_POOL_HPP
+#define HOLEYC_POOL_HPP
+
+#include <cstddef>
+#include <functional>
+
+namespace holeyc{
+
+/**
+* A fixed number of worker threads that share out a batch of 
+* independent jobs. Jobs are numbered 0..count-1; each worker starts
+* on an equal run of them, and one that runs out steals half of what
+* the busiest has left, so many small jobs cost little more than a
+* loop and uneven ones still keep every worker busy.
+**/
+class WorkerPool{
+public:
+	/** A pool of threads workers; 0 means one per hardware thread **/
+	WorkerPool(size_t threads);
+
+	/** Run job(i) for every i in [0, count) and wait for them all. If
+	* a job throws, no more are started, and the first exception is
+	* rethrown here once the workers have stopped **/
+	void run(size_t count, const std::function<void(size_t)>& job);
+
+	size_t size() const { return myThreads; }
+private:
+	size_t myThreads;
+};
+
+} //End namespace holeyc
+
+#endif
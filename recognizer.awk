@@ -0,0 +1,49 @@
+# Derives recognizer.yy from holeyc.yy: the same grammar, and so the
+# same parse tables and syntax errors, but with no semantic values.
+# The %union, the <type> tags and every action are dropped, and the
+# parser (class Recognizer) reads only token kinds.
+#
+# Usage: awk -f recognizer.awk holeyc.yy > recognizer.yy
+
+BEGIN { section = 0; depth = 0; skipUnion = 0 }
+
+/^%%/ {
+	section++
+	print
+	next
+}
+
+section == 0 {
+	if ($0 ~ /^%union/){ skipUnion = 1 }
+	if (skipUnion){
+		if ($0 ~ /^}/){ skipUnion = 0 }
+		next
+	}
+	if ($0 ~ /^%type/){ next }
+	if ($0 ~ /^%parse-param/ && $0 !~ /TokenReader/){ next }
+	sub(/api\.parser\.class \{Parser\}/, "api.parser.class {Recognizer}")
+	sub(/%output "parser\.cc"/, "%output \"recognizer.cc\"")
+	sub(/tokens\.next\(&\(lval\)->transToken\)/, "tokens.next()")
+	sub(/^%token[ \t]*<[A-Za-z]*>/, "%token")
+	print
+	next
+}
+
+# The rules: keep everything outside of braces
+section == 1 {
+	out = ""
+	inAction = depth > 0
+	for (i = 1; i <= length($0); i++){
+		c = substr($0, i, 1)
+		if (c == "{"){ depth++; inAction = 1 }
+		else if (c == "}"){ depth-- }
+		else if (depth == 0){ out = out c }
+	}
+	if (!inAction || out ~ /[^ \t]/){ print out }
+	next
+}
+
+{
+	sub(/holeyc::Parser::/, "holeyc::Recognizer::")
+	print
+}
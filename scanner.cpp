@@ -1,25 +1,23 @@
-#include <fstream>
+#include <cstring>
 #include "scanner.hpp"
 
 using namespace holeyc;
 
 using TokenKind = holeyc::Parser::token;
-using Lexeme = holeyc::Parser::semantic_type;
 
-void Scanner::outputTokens(std::ostream& outstream){
-	Lexeme lexeme;
-	int tokenKind;
-	while(true){
-		tokenKind = this->yylex(&lexeme);
-		if (tokenKind == TokenKind::END){
-			outstream << "EOF" 
-			  << " [" << this->lineNum 
-			  << "," << this->colNum << "]"
-			  << std::endl;
-			return;
-		} else {
-			outstream << lexeme.transToken->toString()
-			  << std::endl;
-		}
+void Scanner::tokenize(){
+	if (src.size() > UINT32_MAX){
+		throw new InternalError("Input too large");
 	}
+	while (this->yylex() != TokenKind::END){ }
+	tokens.setEOF(this->lineNum, this->colNum);
+}
+
+int Scanner::LexerInput(char * buf, int maxSize){
+	size_t avail = src.size() - inputPos;
+	size_t count = static_cast<size_t>(maxSize);
+	if (avail < count){ count = avail; }
+	memcpy(buf, src.data() + inputPos, count);
+	inputPos += count;
+	return static_cast<int>(count);
 }
@@ -7,6 +7,8 @@
 
 #include "grammar.hh"
 #include "errors.hpp"
+#include "source.hpp"
+#include "tokens.hpp"
 
 using TokenKind = holeyc::Parser::token;
 
@@ -15,10 +17,14 @@ namespace holeyc{
 class Scanner : public yyFlexLexer{
 public:
    
-   Scanner(std::istream *in) : yyFlexLexer(in)
+   Scanner(const SourceFile& srcIn, TokenStream& tokensIn)
+   : yyFlexLexer(nullptr), src(srcIn), tokens(tokensIn)
    {
 	lineNum = 1;
 	colNum = 1;
+	inputPos = 0;
+	lexOffset = 0;
+	tokOffset = 0;
    };
    virtual ~Scanner() {
    };
@@ -26,14 +32,26 @@ public:
    //get rid of override virtual function warning
    using FlexLexer::yylex;
 
-   // YY_DECL defined in the flex holeyc.l
-   virtual int yylex( holeyc::Parser::semantic_type * const lval);
+   // YY_DECL defined in the flex holeyc.l. Each call appends 
+   // (at most) one token to the stream and returns its kind
+   virtual int yylex() override;
 
    int makeBareToken(int tagIn){
-        this->yylval->transToken = new Token(
-	  this->lineNum, this->colNum, tagIn);
-        colNum += static_cast<size_t>(yyleng);
-        return tagIn;
+        return makeToken(tagIn, 0);
+   }
+
+   int makeIDToken(){
+	Symbol sym = Symbol::intern(inPlace(), static_cast<size_t>(yyleng));
+	return makeToken(TokenKind::ID, sym.id());
+   }
+
+   int makeStrToken(){
+	Symbol sym = Symbol::intern(inPlace(), static_cast<size_t>(yyleng));
+	return makeToken(TokenKind::STRLITERAL, sym.id());
+   }
+
+   int makeIntLitToken(int val){
+	return makeToken(TokenKind::INTLITERAL, static_cast<uint32_t>(val));
    }
 
    int makeCharLitToken(const std::string text){
@@ -49,10 +67,21 @@ public:
 	} else {
 		val = text.c_str()[1];
 	}
-	this->yylval->transToken = new CharLitToken(
-		this->lineNum, this->colNum, val);
-	colNum += static_cast<size_t>(yyleng);
-	return TokenKind::CHARLIT;
+	unsigned char payload = static_cast<unsigned char>(val);
+	return makeToken(TokenKind::CHARLIT, payload);
+   }
+
+   //The match was a line break: the next line starts after it
+   void startLine(){
+	lineNum++;
+	colNum = 1;
+	tokens.markLine(lexOffset, lineNum);
+   }
+
+   //Restart the column count after the match, on the same line
+   void restartCol(){
+	colNum = 1;
+	tokens.markLine(lexOffset, lineNum);
    }
 
    void errIllegal(size_t l, size_t c, std::string match){
@@ -108,10 +137,28 @@ public:
 
    static std::string tokenKindString(int tokenKind);
 
-   void outputTokens(std::ostream& outstream);
+   //Lex the whole input into the token stream
+   void tokenize();
+
+protected:
+   //Feed flex straight from the source buffer rather than an istream
+   int LexerInput(char * buf, int maxSize) override;
 
 private:
-   holeyc::Parser::semantic_type *yylval = nullptr;
+   //The current match, in place in the source buffer
+   const char * inPlace() const { return src.data() + tokOffset; }
+
+   int makeToken(int tagIn, uint32_t payload){
+	tokens.push(tagIn, tokOffset, payload);
+	colNum += static_cast<size_t>(yyleng);
+	return tagIn;
+   }
+
+   const SourceFile& src;
+   TokenStream& tokens;
+   size_t inputPos; //Bytes of src handed to flex so far
+   size_t lexOffset; //Offset in src just past the last match
+   size_t tokOffset; //Offset in src of the current match
    size_t lineNum;
    size_t colNum;
 };
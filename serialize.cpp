@@ -0,0 +1,106 @@
+#include <vector>
+#include "ast.hpp"
+#include "astfile.hpp"
+#include "visitor.hpp"
+
+namespace holeyc{
+
+/*
+Each node is added to the encoder after its children, with the
+records of its children (see astfile.hpp for what each kind of node
+holds). The records of children not yet taken by their parent wait
+on a stack, the last child's on top.
+*/
+class Serializer : public AstVisitor<Serializer>{
+public:
+	Serializer(AstEncoder& encIn) : myEnc(encIn){}
+
+	using AstVisitor<Serializer>::post;
+
+	void post(ProgramNode * node){
+		add(node, 0, node->globals()->size());
+	}
+
+	void post(VarDeclNode * node){ add(node, 0, 2); }
+
+	void post(FnDeclNode * node){
+		size_t params = node->params()->size();
+		add(node, static_cast<uint32_t>(params),
+			2 + params + node->body()->size());
+	}
+
+	void post(FormalDeclNode * node){ add(node, 0, 2); }
+
+	void post(TypeNode * node){ add(node, node->isReference() ? 1 : 0, 0); }
+
+	void post(AssignStmtNode * node){ add(node, 0, 1); }
+	void post(PostDecStmtNode * node){ add(node, 0, 1); }
+	void post(PostIncStmtNode * node){ add(node, 0, 1); }
+	void post(FromConsoleStmtNode * node){ add(node, 0, 1); }
+	void post(ToConsoleStmtNode * node){ add(node, 0, 1); }
+
+	void post(IfStmtNode * node){ add(node, 0, 1 + node->body()->size()); }
+
+	void post(IfElseStmtNode * node){
+		size_t thens = node->thenBody()->size();
+		add(node, static_cast<uint32_t>(thens),
+			1 + thens + node->elseBody()->size());
+	}
+
+	void post(WhileStmtNode * node){
+		add(node, 0, 1 + node->body()->size());
+	}
+
+	void post(ReturnStmtNode * node){
+		add(node, 0, node->exp() == nullptr ? 0 : 1);
+	}
+
+	void post(CallStmtNode * node){ add(node, 0, 1); }
+	void post(AssignExpNode * node){ add(node, 0, 2); }
+
+	void post(CallExpNode * node){ add(node, 0, 1 + node->args()->size()); }
+
+	void post(BinaryExpNode * node){ add(node, 0, 2); }
+	void post(UnaryExpNode * node){ add(node, 0, 1); }
+
+	void post(NullPtrNode * node){ add(node, 0, 0); }
+
+	void post(IntLitNode * node){
+		add(node, static_cast<uint32_t>(node->value()), 0);
+	}
+
+	void post(StrLitNode * node){ add(node, myEnc.symbol(node->str()), 0); }
+
+	void post(CharLitNode * node){
+		add(node, static_cast<unsigned char>(node->value()), 0);
+	}
+
+	void post(TrueNode * node){ add(node, 0, 0); }
+	void post(FalseNode * node){ add(node, 0, 0); }
+	void post(LValNode * node){ add(node, 0, 1); }
+	void post(IndexNode * node){ add(node, 0, 2); }
+	void post(IDNode * node){ add(node, myEnc.symbol(node->sym()), 0); }
+
+	/** The record of the node last walked **/
+	uint32_t root(){ return myRecords.back(); }
+
+private:
+	void add(ASTNode * node, uint32_t value, size_t kids){
+		size_t first = myRecords.size() - kids;
+		uint32_t record = myEnc.add(node->kind(), node, value,
+			myRecords.data() + first, kids);
+		myRecords.resize(first);
+		myRecords.push_back(record);
+	}
+
+	AstEncoder& myEnc;
+	std::vector<uint32_t> myRecords;
+};
+
+uint32_t serialize(ASTNode * node, AstEncoder& enc){
+	Serializer serializer(enc);
+	serializer.walk(node);
+	return serializer.root();
+}
+
+} // End namespace holeyc
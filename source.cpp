@@ -0,0 +1,85 @@
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "source.hpp"
+#include "errors.hpp"
+
+namespace holeyc{
+
+static void badInput(const char * path){
+	std::string msg = "Bad input stream ";
+	msg += path;
+	throw new InternalError(msg.c_str());
+}
+
+static void tooLarge(const char * path){
+	std::string msg = "Input too large (4GiB or more) ";
+	msg += path;
+	throw new InternalError(msg.c_str());
+}
+
+SourceFile::SourceFile(const char * path)
+: myData(nullptr), mySize(0), myMapped(false){
+	if (strcmp(path, "-") == 0){
+		readAll(STDIN_FILENO, path);
+		return;
+	}
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0){ badInput(path); }
+
+	struct stat info;
+	if (fstat(fd, &info) != 0){
+		close(fd);
+		badInput(path);
+	}
+	if (!S_ISREG(info.st_mode)){
+		readAll(fd, path);
+		close(fd);
+		return;
+	}
+
+	mySize = static_cast<size_t>(info.st_size);
+	if (mySize > MAX_SIZE){
+		close(fd);
+		tooLarge(path);
+	}
+	if (mySize > 0){
+		void * mem = mmap(nullptr, mySize, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mem == MAP_FAILED){
+			close(fd);
+			badInput(path);
+		}
+		madvise(mem, mySize, MADV_SEQUENTIAL);
+		myData = static_cast<const char *>(mem);
+		myMapped = true;
+	}
+	close(fd);
+}
+
+SourceFile::~SourceFile(){
+	if (myMapped){
+		munmap(const_cast<char *>(myData), mySize);
+	}
+}
+
+void SourceFile::readAll(int fd, const char * path){
+	const size_t CHUNK = 64 * 1024;
+	size_t used = 0;
+	while (true){
+		myBuffer.resize(used + CHUNK);
+		ssize_t got = read(fd, myBuffer.data() + used, CHUNK);
+		if (got < 0){ badInput(path); }
+		if (got == 0){ break; }
+		used += static_cast<size_t>(got);
+		if (used > MAX_SIZE){ tooLarge(path); }
+	}
+	myBuffer.resize(used);
+	myData = myBuffer.data();
+	mySize = used;
+}
+
+} //End namespace holeyc
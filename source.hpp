@@ -0,0 +1,40 @@
+#ifndef HOLEYC_SOURCE_HPP
+#define HOLEYC_SOURCE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace holeyc{
+
+/**
+* The raw bytes of one input file. Regular files are mmapped so the
+* scanner can lex them in place and tokens can point straight into
+* the mapping; anything that cannot be mapped (stdin, pipes) is read
+* into memory once instead. An input larger than MAX_SIZE is refused
+* with an InternalError.
+**/
+class SourceFile{
+public:
+	SourceFile(const char * path);
+	SourceFile(const SourceFile&) = delete;
+	SourceFile& operator=(const SourceFile&) = delete;
+	~SourceFile();
+
+	/** The largest input; the tokens keep its offsets in 32 bits **/
+	static const size_t MAX_SIZE = UINT32_MAX;
+
+	const char * data() const { return myData; }
+	size_t size() const { return mySize; }
+private:
+	void readAll(int fd, const char * path);
+
+	const char * myData;
+	size_t mySize;
+	bool myMapped;
+	std::vector<char> myBuffer;
+};
+
+} //End namespace holeyc
+
+#endif
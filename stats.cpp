@@ -0,0 +1,183 @@
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <malloc.h>
+#include <sys/resource.h>
+#include "astfile.hpp"
+#include "stats.hpp"
+
+namespace holeyc{
+
+static const char * const PHASE_NAMES[Stats::NUM_PHASES] = {
+	"lex", "parse", "fold", "output", "unparse", "names", "types", "lower",
+	"codegen", "run"
+};
+
+static const char * const NODE_NAMES[] = {
+	"Program", "VarDecl", "FnDecl", "FormalDecl",
+	"IntType", "IntPtr", "BoolType", "BoolPtr", "CharType", "CharPtr",
+	"VoidType",
+	"AssignStmt", "PostDecStmt", "PostIncStmt", "FromConsoleStmt",
+	"ToConsoleStmt", "IfStmt", "IfElseStmt", "WhileStmt", "ReturnStmt",
+	"CallStmt",
+	"AssignExp", "CallExp",
+	"Minus", "Plus", "Times", "Divide", "And", "Or",
+	"Equals", "NotEquals", "Greater", "GreaterEq", "Less", "LessEq",
+	"Not", "Neg",
+	"NullPtr", "IntLit", "StrLit", "CharLit", "True", "False",
+	"LVal", "Index", "Deref", "Ref", "ID",
+};
+static_assert(sizeof(NODE_NAMES) / sizeof(NODE_NAMES[0])
+	== static_cast<size_t>(NodeKind::NumKinds), "a NodeKind has no name");
+
+static double wallTime(){
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration<double>(now).count();
+}
+
+/* The peak RSS of the process so far, in KB */
+static long peakRss(){
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+/* Bytes of heap in use, where the C library will say */
+static long long heapInUse(){
+#ifdef __GLIBC__
+#if __GLIBC__ > 2 || __GLIBC_MINOR__ >= 33
+	struct mallinfo2 info = mallinfo2();
+	return static_cast<long long>(info.uordblks + info.hblkhd);
+#else
+	return 0;
+#endif
+#else
+	return 0;
+#endif
+}
+
+Stats::Stats(bool perThread)
+: myPerThread(perThread), myInputs(0), myWall(), myCpu(), myHeap(),
+  myPeakRss(), myNodes(), myInstructions(0){
+}
+
+double Stats::cpuTime() const {
+	struct timespec now;
+	clock_gettime(myPerThread ? CLOCK_THREAD_CPUTIME_ID
+		: CLOCK_PROCESS_CPUTIME_ID, &now);
+	return static_cast<double>(now.tv_sec)
+		+ static_cast<double>(now.tv_nsec) / 1e9;
+}
+
+Stats::Timer::Timer(Stats * statsIn, Phase phaseIn)
+: myStats(statsIn), myPhase(phaseIn), myWall(0), myCpu(0), myHeap(0){
+	if (myStats == nullptr){ return; }
+	myHeap = heapInUse();
+	myCpu = myStats->cpuTime();
+	myWall = wallTime();
+}
+
+Stats::Timer::~Timer(){
+	if (myStats == nullptr){ return; }
+	myStats->myWall[myPhase] += wallTime() - myWall;
+	myStats->myCpu[myPhase] += myStats->cpuTime() - myCpu;
+	myStats->myHeap[myPhase] += heapInUse() - myHeap;
+	long rss = peakRss();
+	if (rss > myStats->myPeakRss[myPhase]){
+		myStats->myPeakRss[myPhase] = rss;
+	}
+}
+
+void Stats::countTokens(const TokenStream& tokens){
+	for (size_t i = 0; i < tokens.size(); i++){
+		myTokens[tokens.kind(i)]++;
+	}
+}
+
+void Stats::countNodes(ASTNode * ast){
+	AstEncoder enc;
+	serialize(ast, enc);
+	for (size_t k = 0; k < static_cast<size_t>(NodeKind::NumKinds); k++){
+		myNodes[k] += enc.count(static_cast<NodeKind>(k));
+	}
+}
+
+void Stats::merge(const Stats& other){
+	myInputs += other.myInputs;
+	for (int p = 0; p < NUM_PHASES; p++){
+		myWall[p] += other.myWall[p];
+		myCpu[p] += other.myCpu[p];
+		myHeap[p] += other.myHeap[p];
+		if (other.myPeakRss[p] > myPeakRss[p]){
+			myPeakRss[p] = other.myPeakRss[p];
+		}
+	}
+	for (const auto& count : other.myTokens){
+		myTokens[count.first] += count.second;
+	}
+	for (size_t k = 0; k < static_cast<size_t>(NodeKind::NumKinds); k++){
+		myNodes[k] += other.myNodes[k];
+	}
+	myInstructions += other.myInstructions;
+}
+
+void Stats::print(std::ostream& out) const {
+	char line[128];
+	snprintf(line, sizeof(line), "stats: %zu input(s) compiled\n",
+		myInputs);
+	out << line;
+	snprintf(line, sizeof(line), "%-10s %12s %12s %12s %12s\n",
+		"phase", "wall s", "cpu s", "heap KB", "peak RSS KB");
+	out << line;
+	double wallTotal = 0;
+	double cpuTotal = 0;
+	long long heapTotal = 0;
+	long rssPeak = 0;
+	for (int p = 0; p < NUM_PHASES; p++){
+		snprintf(line, sizeof(line), "%-10s %12.6f %12.6f %12lld %12ld\n",
+			PHASE_NAMES[p], myWall[p], myCpu[p], myHeap[p] / 1024,
+			myPeakRss[p]);
+		out << line;
+		wallTotal += myWall[p];
+		cpuTotal += myCpu[p];
+		heapTotal += myHeap[p];
+		if (myPeakRss[p] > rssPeak){ rssPeak = myPeakRss[p]; }
+	}
+	snprintf(line, sizeof(line), "%-10s %12.6f %12.6f %12lld %12ld\n",
+		"total", wallTotal, cpuTotal, heapTotal / 1024, rssPeak);
+	out << line;
+
+	size_t tokenTotal = 0;
+	for (const auto& count : myTokens){ tokenTotal += count.second; }
+	snprintf(line, sizeof(line), "tokens %zu\n", tokenTotal);
+	out << line;
+	for (const auto& count : myTokens){
+		snprintf(line, sizeof(line), "  %-12s %zu\n",
+			TokenStream::kindString(count.first), count.second);
+		out << line;
+	}
+
+	size_t nodeTotal = 0;
+	for (size_t count : myNodes){ nodeTotal += count; }
+	snprintf(line, sizeof(line), "nodes %zu\n", nodeTotal);
+	out << line;
+	for (size_t k = 0; k < static_cast<size_t>(NodeKind::NumKinds); k++){
+		if (myNodes[k] == 0){ continue; }
+		snprintf(line, sizeof(line), "  %-16s %zu\n",
+			NODE_NAMES[k], myNodes[k]);
+		out << line;
+	}
+
+	if (myInstructions != 0){
+		double wall = myWall[RUN];
+		snprintf(line, sizeof(line), "instructions %llu (%.1f M/s)\n",
+			myInstructions, wall > 0
+			? static_cast<double>(myInstructions) / wall / 1e6 : 0.0);
+		out << line;
+	}
+
+	snprintf(line, sizeof(line), "peak RSS %ld KB\n", peakRss());
+	out << line;
+}
+
+} //End namespace holeyc
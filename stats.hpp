@@ -0,0 +1,71 @@
+#ifndef HOLEYC_STATS_HPP
+#define HOLEYC_STATS_HPP
+
+#include <cstddef>
+#include <map>
+#include <ostream>
+#include "ast.hpp"
+#include "tokens.hpp"
+
+namespace holeyc{
+
+/**
+* What --stats reports: the time and heap each phase took, the peak
+* RSS by the end of it, and what the inputs were made of. A compilation without --stats has no
+* Stats at all and passes nullptr around instead, so all it pays
+* for the instrumentation is a few pointer tests.
+**/
+class Stats{
+public:
+	enum Phase{ LEX, PARSE, FOLD, OUTPUT, UNPARSE, NAMES, TYPES, LOWER,
+		CODEGEN, RUN, NUM_PHASES };
+
+	/**
+	* With perThread, CPU time is that of the calling thread only,
+	* for when other threads are busy with other inputs
+	**/
+	Stats(bool perThread);
+
+	/** Times one run of a phase, from construction to destruction **/
+	class Timer{
+	public:
+		Timer(Stats * statsIn, Phase phaseIn);
+		~Timer();
+		Timer(const Timer&) = delete;
+	private:
+		Stats * myStats;
+		Phase myPhase;
+		double myWall;
+		double myCpu;
+		long long myHeap;
+	};
+
+	void countTokens(const TokenStream& tokens);
+	void countNodes(ASTNode * ast);
+	void countInput(){ myInputs++; }
+	void countInstructions(unsigned long long count){
+		myInstructions += count;
+	}
+
+	/** Add in the counts and times of other **/
+	void merge(const Stats& other);
+
+	/** Write the summary, ending with the peak RSS so far **/
+	void print(std::ostream& out) const;
+private:
+	double cpuTime() const;
+
+	bool myPerThread;
+	size_t myInputs;
+	double myWall[NUM_PHASES];
+	double myCpu[NUM_PHASES];
+	long long myHeap[NUM_PHASES];
+	long myPeakRss[NUM_PHASES]; //KB, the process's high-water mark
+	std::map<int, size_t> myTokens;
+	size_t myNodes[static_cast<size_t>(NodeKind::NumKinds)];
+	unsigned long long myInstructions; //run by -r
+};
+
+} //End namespace holeyc
+
+#endif
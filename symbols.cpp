@@ -0,0 +1,107 @@
+#include <cstring>
+#include "symbols.hpp"
+#include "types.hpp"
+
+namespace holeyc{
+
+/* Write the spelling of type into out */
+static void writeTypeName(DataType type, Writer& out){
+	const char * name = typeName(type);
+	out.write(name, strlen(name));
+}
+
+void SemSymbol::writeType(Writer& out) const {
+	if (myKind == VAR){
+		writeTypeName(type(), out);
+		return;
+	}
+	FnDeclNode * fn = static_cast<FnDeclNode *>(myDecl);
+	bool first = true;
+	for (FormalDeclNode * formal : *fn->params()){
+		if (!first){ out << ','; }
+		writeTypeName(declaredType(formal->type()), out);
+		first = false;
+	}
+	out << "->";
+	writeTypeName(declaredType(fn->type()), out);
+}
+
+SymbolTable::SymbolTable() : mySlots(256, 0), myShift(24){}
+
+void SymbolTable::enterScope(){
+	myScopes.push_back(myLog.size());
+}
+
+void SymbolTable::exitScope(){
+	size_t start = myScopes.back();
+	myScopes.pop_back();
+	while (myLog.size() > start){
+		const Undo& undo = myLog.back();
+		Binding& binding = myBindings[undo.binding];
+		binding.depth = undo.depth;
+		binding.sym = undo.sym;
+		myLog.pop_back();
+	}
+}
+
+/* Fibonacci hashing: the top bits of the name times 2^32/phi */
+size_t SymbolTable::slot(uint32_t name) const {
+	return (name * 2654435769u) >> myShift;
+}
+
+const SymbolTable::Binding * SymbolTable::find(uint32_t name) const {
+	size_t mask = mySlots.size() - 1;
+	for (size_t idx = slot(name); mySlots[idx] != 0; idx = (idx + 1) & mask){
+		const Binding& binding = myBindings[mySlots[idx] - 1];
+		if (binding.name == name){ return &binding; }
+	}
+	return nullptr;
+}
+
+SemSymbol * SymbolTable::lookup(Symbol name) const {
+	const Binding * binding = find(name.id());
+	return binding == nullptr ? nullptr : binding->sym;
+}
+
+bool SymbolTable::inCurrentScope(Symbol name) const {
+	const Binding * binding = find(name.id());
+	return binding != nullptr && binding->sym != nullptr
+		&& binding->depth == myScopes.size();
+}
+
+void SymbolTable::declare(Symbol name, SemSymbol * sym){
+	uint32_t depth = static_cast<uint32_t>(myScopes.size());
+	size_t mask = mySlots.size() - 1;
+	size_t idx = slot(name.id());
+	while (mySlots[idx] != 0){
+		uint32_t index = mySlots[idx] - 1;
+		Binding& binding = myBindings[index];
+		if (binding.name == name.id()){
+			myLog.push_back(Undo{index, binding.depth, binding.sym});
+			binding.depth = depth;
+			binding.sym = sym;
+			return;
+		}
+		idx = (idx + 1) & mask;
+	}
+
+	uint32_t index = static_cast<uint32_t>(myBindings.size());
+	myBindings.push_back(Binding{name.id(), depth, sym});
+	myLog.push_back(Undo{index, 0, nullptr});
+	mySlots[idx] = index + 1;
+	if (myBindings.size() * 2 > mySlots.size()){ grow(); }
+}
+
+void SymbolTable::grow(){
+	std::vector<uint32_t> slots(mySlots.size() * 2, 0);
+	mySlots.swap(slots);
+	myShift--;
+	size_t mask = mySlots.size() - 1;
+	for (size_t k = 0; k < myBindings.size(); k++){
+		size_t idx = slot(myBindings[k].name);
+		while (mySlots[idx] != 0){ idx = (idx + 1) & mask; }
+		mySlots[idx] = static_cast<uint32_t>(k) + 1;
+	}
+}
+
+} //End namespace holeyc
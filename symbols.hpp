@@ -0,0 +1,106 @@
+#ifndef HOLEYC_SYMBOLS_HPP
+#define HOLEYC_SYMBOLS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "arena.hpp"
+#include "ast.hpp"
+#include "intern.hpp"
+#include "writer.hpp"
+
+namespace holeyc{
+
+/**
+* What a name was declared as: a variable (global, local or formal)
+* or a function. Name analysis makes one per declaration, in the
+* program's arena, and attaches it to the declaration's IDNode and
+* to every IDNode that refers to it.
+**/
+class SemSymbol{
+public:
+	enum Kind{ VAR, FN };
+
+	/**
+	* declIn is a VarDeclNode or FormalDeclNode for a VAR, and typeIn
+	* its declared type; a FN's type is Fn
+	**/
+	SemSymbol(Kind kindIn, DeclNode * declIn, DataType typeIn)
+	: myKind(kindIn), myType(typeIn), myDecl(declIn){}
+
+	Kind kind() const { return myKind; }
+	DeclNode * decl() const { return myDecl; }
+	DataType type() const { return myType; }
+
+	/**
+	* Write the type as -n shows it: e.g. int for a variable, or
+	* int,bool->void for a function
+	**/
+	void writeType(Writer& out) const;
+private:
+	Kind myKind;
+	DataType myType;
+	DeclNode * myDecl;
+};
+
+/**
+* The names in scope at one point of a walk over the program. There
+* is a single open-addressing hash table from name to its innermost
+* declaration, rather than a table per scope, so a lookup is one
+* probe sequence however deep the scopes nest. Each declaration that
+* hides another logs what it hid, and leaving a scope replays its
+* part of the log backwards, so that costs only as much as the scope
+* declared.
+**/
+class SymbolTable{
+public:
+	SymbolTable();
+
+	void enterScope();
+	void exitScope();
+
+	/** The innermost declaration of name, or null if there is none **/
+	SemSymbol * lookup(Symbol name) const;
+
+	/** Whether name is declared in the innermost scope **/
+	bool inCurrentScope(Symbol name) const;
+
+	/** Declare name as sym in the innermost scope **/
+	void declare(Symbol name, SemSymbol * sym);
+private:
+	//One per name ever declared; sym is null once out of scope
+	struct Binding{
+		uint32_t name;
+		uint32_t depth;
+		SemSymbol * sym;
+	};
+
+	//What a declaration replaced, to be put back on leaving its scope
+	struct Undo{
+		uint32_t binding;
+		uint32_t depth;
+		SemSymbol * sym;
+	};
+
+	size_t slot(uint32_t name) const;
+	const Binding * find(uint32_t name) const;
+	void grow();
+
+	std::vector<uint32_t> mySlots; //a binding's index + 1, or 0
+	size_t myShift;
+	std::vector<Binding> myBindings;
+	std::vector<Undo> myLog;
+	std::vector<size_t> myScopes; //where each open scope's log starts
+};
+
+/**
+* Link every IDNode in program to its declaration, reporting names
+* declared twice in a scope, names used but not declared, and
+* variables declared void (see names.cpp). Symbols are made in
+* arena. Returns whether there were no errors.
+**/
+bool nameAnalysis(ProgramNode * program, Arena& arena);
+
+} //End namespace holeyc
+
+#endif
@@ -1,12 +1,14 @@
+#include <algorithm>
+#include <cstring>
+#include "errors.hpp"
 #include "tokens.hpp" // Get the class declarations
 #include "grammar.hh" // Get the TokenKind definitions
 
 namespace holeyc{
 
 using TokenKind = holeyc::Parser::token;
-using Lexeme = holeyc::Parser::semantic_type;
 
-static std::string tokenKindString(int tokKind){
+const char * TokenStream::kindString(int tokKind){
 	switch(tokKind){
 		case TokenKind::END: return "EOF";
 		case TokenKind::AND: return "AND";
@@ -60,92 +62,66 @@ static std::string tokenKindString(int tokKind){
 	
 }
 
-Token::Token(size_t lineIn, size_t columnIn, int kindIn)
-  : myLine(lineIn), myCol(columnIn), myKind(kindIn){
-}
-
-std::string Token::toString(){
-	return tokenKindString(kind())
-	+ " [" + std::to_string(line()) 
-	+ "," + std::to_string(col()) + "]";
-}
-
-size_t Token::line() const { 
-	return this->myLine; 
-}
-
-size_t Token::col() const { 
-	return this->myCol; 
-}
-
-int Token::kind() const { 
-	return this->myKind; 
-}
-
-IDToken::IDToken(size_t lIn, size_t cIn, std::string vIn)
-  : Token(lIn, cIn, TokenKind::ID), myValue(vIn){ 
-}
-
-std::string IDToken::toString(){
-	return tokenKindString(kind()) + ":"
-	+ this->myValue
-	+ " [" + std::to_string(line()) 
-	+ "," + std::to_string(col()) + "]";
-}
-
-const std::string IDToken::value() const { 
-	return this->myValue; 
-}
-
-StrToken::StrToken(size_t lIn, size_t cIn, std::string sIn)
-  : Token(lIn, cIn, TokenKind::STRLITERAL), myStr(sIn){
-}
-
-std::string StrToken::toString(){
-	return tokenKindString(kind()) + ":"
-	+ this->myStr
-	+ " [" + std::to_string(line()) 
-	+ "," + std::to_string(col()) + "]";
-}
-
-const std::string StrToken::str() const {
-	return this->myStr;
-}
-
-CharLitToken::CharLitToken(size_t lIn, size_t cIn, char valIn)
-  : Token(lIn, cIn, TokenKind::CHARLIT), myVal(valIn){
-}
-
-std::string CharLitToken::toString() {
-	std::string res = tokenKindString(kind()) + ":";
-
-	char v = this->val();
-	if (v == '\n'){ res += "newline"; }
-	else if (v == '\t'){ res += "tab"; }
-	else { res += std::string(1, v); }
-
-	res += " [" + std::to_string(line()) 
-	+ "," + std::to_string(col()) + "]";
-
-	return res;
-}
-
-char CharLitToken::val() const {
-	return this->myVal;
-}
-
-IntLitToken::IntLitToken(size_t lIn, size_t cIn, int numIn)
-  : Token(lIn, cIn, TokenKind::INTLITERAL), myNum(numIn){}
+size_t TokenStream::lineIndex(size_t i) const {
+	//The last line start at or before the token
+	auto after = std::upper_bound(myLineStarts.begin(), 
+		myLineStarts.end(), myOffsets[i]);
+	return static_cast<size_t>(after - myLineStarts.begin()) - 1;
+}
+
+void TokenReader::syntaxError(const std::string& msg){
+	myErrors++;
+	size_t at = myAtEnd ? myEnd : myPos - 1;
+
+	//The statement starts after the last ; { or } before the token
+	size_t fromL = 0;
+	size_t fromC = 0;
+	for (size_t i = at; i > myBegin; i--){
+		int kind = myStream.kind(i - 1);
+		if (kind == TokenKind::SEMICOLON || kind == TokenKind::LCURLY
+			|| kind == TokenKind::RCURLY){
+			fromL = line(i - 1);
+			fromC = col(i - 1);
+			break;
+		}
+	}
 
-std::string IntLitToken::toString(){
-	return tokenKindString(kind()) + ":"
-	+ std::to_string(this->myNum)
-	+ " [" + std::to_string(line()) 
-	+ "," + std::to_string(col()) + "]";
+	if (at < myStream.size()){
+		Diagnostics::reportSyntax(line(at), col(at), fromL, fromC, msg);
+	} else {
+		Diagnostics::reportSyntax(myStream.eofLine(), myStream.eofCol(),
+			fromL, fromC, msg);
+	}
 }
 
-int IntLitToken::num() const {
-	return this->myNum;
+void TokenStream::outputTokens(Writer& out) const {
+	for (size_t i = 0; i < size(); i++){
+		const char * kindStr = kindString(kind(i));
+		out.write(kindStr, strlen(kindStr));
+		switch (kind(i)){
+		case TokenKind::ID:
+		case TokenKind::STRLITERAL:
+			out << ":" << sym(i).text();
+			break;
+		case TokenKind::INTLITERAL:
+			out << ":" << intVal(i);
+			break;
+		case TokenKind::CHARLIT: {
+			char v = charVal(i);
+			out << ":";
+			if (v == '\n'){ out << "newline"; }
+			else if (v == '\t'){ out << "tab"; }
+			else { out << v; }
+			break;
+		}
+		default:
+			break;
+		}
+		out << " [" << line(i) << "," << col(i) << "]\n";
+	}
+	out << "EOF" 
+	  << " [" << myEOFLine
+	  << "," << myEOFCol << "]\n";
 }
 
 } //End namespace holeyc
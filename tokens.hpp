@@ -1,58 +1,144 @@
 #ifndef HOLEYC_TOKEN_H
 #define HOLEYC_TOKEN_H
 
+#include <cstdint>
 #include <string>
+#include <vector>
+#include "intern.hpp"
+#include "writer.hpp"
 
 namespace holeyc{
 
-class Token{
+/**
+* The tokens of one input file, lexed once and then replayed to
+* every consumer (the token dump, the syntax check and the AST
+* build).
+*
+* Tokens are plain data kept in parallel arrays: token i is a
+* kind, a byte offset into the source and a 32-bit payload. The
+* payload is the Symbol id of an ID or STRLITERAL, the value of an
+* INTLITERAL or CHARLIT, and unused for every other kind. Lines and
+* columns are not stored per token; they are recovered from the
+* offset and a table of the offsets at which the scanner restarted
+* its column count.
+**/
+class TokenStream{
 public:
-	Token(size_t lineIn, size_t columnIn, int kindIn);
-	virtual std::string toString();
-	size_t line() const;
-	size_t col() const;
-	int kind() const;
-private:
-	const size_t myLine;
-	const size_t myCol;
-	const int myKind;
-};
+	TokenStream() : myEOFLine(1), myEOFCol(1){
+		myLineStarts.push_back(0);
+		myLineNums.push_back(1);
+	}
 
-class IDToken : public Token{
-public:
-	IDToken(size_t lIn, size_t cIn, std::string valIn);
-	const std::string value() const;
-	virtual std::string toString() override;
-private:
-	const std::string myValue;
-	
-};
+	/** offset is at most SourceFile::MAX_SIZE, so it fits 32 bits **/
+	void push(int kind, size_t offset, uint32_t payload){
+		myKinds.push_back(static_cast<uint16_t>(kind));
+		myOffsets.push_back(static_cast<uint32_t>(offset));
+		myPayloads.push_back(payload);
+	}
 
-class StrToken : public Token{
-public:
-	StrToken(size_t lIn, size_t cIn, std::string valIn);
-	virtual std::string toString() override;
-	const std::string str() const;
-private:
-	const std::string myStr;
-};
+	/** Column 1 of line lineNum starts at byte offset **/
+	void markLine(size_t offset, size_t lineNum){
+		myLineStarts.push_back(static_cast<uint32_t>(offset));
+		myLineNums.push_back(static_cast<uint32_t>(lineNum));
+	}
+
+	void setEOF(size_t l, size_t c){
+		myEOFLine = l;
+		myEOFCol = c;
+	}
+
+	size_t size() const { return myKinds.size(); }
+	int kind(size_t i) const { return myKinds[i]; }
+	size_t offset(size_t i) const { return myOffsets[i]; }
+	size_t line(size_t i) const { return myLineNums[lineIndex(i)]; }
+	size_t col(size_t i) const {
+		return myOffsets[i] - myLineStarts[lineIndex(i)] + 1;
+	}
+	Symbol sym(size_t i) const { return Symbol(myPayloads[i]); }
+	int intVal(size_t i) const { return static_cast<int>(myPayloads[i]); }
+	char charVal(size_t i) const { return static_cast<char>(myPayloads[i]); }
+
+	/** The column restart marks, for saving the stream **/
+	size_t lineMarks() const { return myLineStarts.size(); }
+	size_t markOffset(size_t k) const { return myLineStarts[k]; }
+	size_t markLineNum(size_t k) const { return myLineNums[k]; }
+	size_t eofLine() const { return myEOFLine; }
+	size_t eofCol() const { return myEOFCol; }
+
+	/** The text dump written by -t **/
+	void outputTokens(Writer& out) const;
+
+	/** The name of a token kind, as written by -t **/
+	static const char * kindString(int tokKind);
 
-class CharLitToken : public Token{
-public:
-	CharLitToken(size_t lIn, size_t cIn, char valIn);
-	virtual std::string toString() override;
-	char val() const;
 private:
-	const char myVal;
+	size_t lineIndex(size_t i) const;
+
+	std::vector<uint16_t> myKinds;
+	std::vector<uint32_t> myOffsets;
+	std::vector<uint32_t> myPayloads;
+	std::vector<uint32_t> myLineStarts;
+	std::vector<uint32_t> myLineNums;
+	size_t myEOFLine;
+	size_t myEOFCol;
 };
 
-class IntLitToken : public Token{
+/**
+* Hands the tokens [begin, end) of a stream to a parser, in the style
+* of yylex, followed by the end-of-file token. A token's semantic 
+* value is its index in the stream. Several readers can share one
+* stream, e.g. to parse separate parts of it at the same time.
+*
+* The parser reports its syntax errors back through the reader, 
+* which knows where the parser is and counts them.
+**/
+class TokenReader{
 public:
-	IntLitToken(size_t lIn, size_t cIn, int numIn);
-	virtual std::string toString() override;
-	int num() const;
+	TokenReader(const TokenStream& streamIn)
+	: myStream(streamIn), myBegin(0), myPos(0), myEnd(streamIn.size()),
+	  myAtEnd(false), myErrors(0){}
+	TokenReader(const TokenStream& streamIn, size_t begin, size_t end)
+	: myStream(streamIn), myBegin(begin), myPos(begin), myEnd(end), 
+	  myAtEnd(false), myErrors(0){}
+
+	int next(size_t * index){
+		if (myPos == myEnd){ 
+			myAtEnd = true;
+			return 0; 
+		}
+		*index = myPos;
+		return myStream.kind(myPos++);
+	}
+
+	/** The next token's kind alone, for a parser with no values **/
+	int next(){
+		if (myPos == myEnd){ 
+			myAtEnd = true;
+			return 0; 
+		}
+		return myStream.kind(myPos++);
+	}
+
+	/** 
+	* Report a syntax error at the token last handed out, which is
+	* the one the parser could not take, as part of the statement
+	* that token is in (see Diagnostics::reportSyntax)
+	**/
+	void syntaxError(const std::string& msg);
+	size_t errors() const { return myErrors; }
+
+	size_t line(size_t i) const { return myStream.line(i); }
+	size_t col(size_t i) const { return myStream.col(i); }
+	Symbol sym(size_t i) const { return myStream.sym(i); }
+	int intVal(size_t i) const { return myStream.intVal(i); }
+	char charVal(size_t i) const { return myStream.charVal(i); }
 private:
-	const int myNum;
+	const TokenStream& myStream;
+	size_t myBegin;
+	size_t myPos;
+	size_t myEnd;
+	bool myAtEnd;
+	size_t myErrors;
 };
 
 }
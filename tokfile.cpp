@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include "tokfile.hpp"
+#include "errors.hpp"
+#include "grammar.hh"
+
+namespace holeyc{
+
+using TokenKind = holeyc::Parser::token;
+
+static const size_t HEADER_WORDS = 8;
+
+static bool hasSymbol(int kind){
+	return kind == TokenKind::ID || kind == TokenKind::STRLITERAL;
+}
+
+/* Bytes taken by count elements of size each, padded to 4 bytes */
+static size_t padded(size_t count, size_t size){
+	return (count * size + 3) & ~static_cast<size_t>(3);
+}
+
+template <typename T>
+static void writeArray(Writer& out, const std::vector<T>& vals){
+	size_t bytes = vals.size() * sizeof(T);
+	out.write(reinterpret_cast<const char *>(vals.data()), bytes);
+	static const char zeros[4] = {0, 0, 0, 0};
+	out.write(zeros, padded(vals.size(), sizeof(T)) - bytes);
+}
+
+static void badTokenFile(){
+	throw new InternalError("Bad token file");
+}
+
+bool TokenFile::isTokenFile(const char * data, size_t size){
+	uint32_t magic;
+	if (size < sizeof(magic)){ return false; }
+	memcpy(&magic, data, sizeof(magic));
+	return magic == MAGIC;
+}
+
+void TokenFile::write(const TokenStream& tokens, Writer& out){
+	std::vector<uint16_t> kinds(tokens.size());
+	std::vector<uint32_t> offsets(tokens.size());
+	std::vector<uint32_t> payloads(tokens.size());
+	std::vector<uint32_t> symStarts;
+	std::string strings;
+
+	//Renumber the symbols in order of first use
+	std::unordered_map<uint32_t, uint32_t> symNums;
+	for (size_t i = 0; i < tokens.size(); i++){
+		int kind = tokens.kind(i);
+		kinds[i] = static_cast<uint16_t>(kind);
+		offsets[i] = static_cast<uint32_t>(tokens.offset(i));
+		if (hasSymbol(kind)){
+			Symbol sym = tokens.sym(i);
+			uint32_t next = static_cast<uint32_t>(symStarts.size());
+			auto found = symNums.emplace(sym.id(), next);
+			if (found.second){
+				symStarts.push_back(static_cast<uint32_t>(strings.size()));
+				strings += sym.text();
+			}
+			payloads[i] = found.first->second;
+		} else {
+			payloads[i] = static_cast<uint32_t>(tokens.intVal(i));
+		}
+	}
+	size_t numSyms = symStarts.size();
+	symStarts.push_back(static_cast<uint32_t>(strings.size()));
+
+	std::vector<uint32_t> markStarts(tokens.lineMarks());
+	std::vector<uint32_t> markLines(tokens.lineMarks());
+	for (size_t k = 0; k < tokens.lineMarks(); k++){
+		markStarts[k] = static_cast<uint32_t>(tokens.markOffset(k));
+		markLines[k] = static_cast<uint32_t>(tokens.markLineNum(k));
+	}
+
+	std::vector<uint32_t> header = {
+		MAGIC,
+		VERSION,
+		static_cast<uint32_t>(tokens.size()),
+		static_cast<uint32_t>(tokens.lineMarks()),
+		static_cast<uint32_t>(numSyms),
+		static_cast<uint32_t>(strings.size()),
+		static_cast<uint32_t>(tokens.eofLine()),
+		static_cast<uint32_t>(tokens.eofCol()),
+	};
+	writeArray(out, header);
+	writeArray(out, kinds);
+	writeArray(out, offsets);
+	writeArray(out, payloads);
+	writeArray(out, markStarts);
+	writeArray(out, markLines);
+	writeArray(out, symStarts);
+	out << strings;
+}
+
+TokenFile::TokenFile(const char * data, size_t size){
+	uint32_t header[HEADER_WORDS];
+	if (size < sizeof(header)){ badTokenFile(); }
+	memcpy(header, data, sizeof(header));
+	if (header[0] != MAGIC || header[1] != VERSION){ badTokenFile(); }
+	myCount = header[2];
+	myMarks = header[3];
+	mySymbols = header[4];
+	size_t stringBytes = header[5];
+	myEOFLine = header[6];
+	myEOFCol = header[7];
+
+	size_t need = sizeof(header) + padded(myCount, sizeof(uint16_t))
+		+ padded(myCount, sizeof(uint32_t)) * 2
+		+ padded(myMarks, sizeof(uint32_t)) * 2
+		+ padded(mySymbols + 1, sizeof(uint32_t))
+		+ stringBytes;
+	if (size < need || myMarks == 0){ badTokenFile(); }
+
+	//Arrays start 4-byte aligned relative to data, which is a mapping
+	const char * pos = data + sizeof(header);
+	myKinds = reinterpret_cast<const uint16_t *>(pos);
+	pos += padded(myCount, sizeof(uint16_t));
+	myOffsets = reinterpret_cast<const uint32_t *>(pos);
+	pos += padded(myCount, sizeof(uint32_t));
+	myPayloads = reinterpret_cast<const uint32_t *>(pos);
+	pos += padded(myCount, sizeof(uint32_t));
+	myMarkStarts = reinterpret_cast<const uint32_t *>(pos);
+	pos += padded(myMarks, sizeof(uint32_t));
+	myMarkLines = reinterpret_cast<const uint32_t *>(pos);
+	pos += padded(myMarks, sizeof(uint32_t));
+	mySymStarts = reinterpret_cast<const uint32_t *>(pos);
+	pos += padded(mySymbols + 1, sizeof(uint32_t));
+	myStrings = pos;
+
+	//Check everything the accessors will trust
+	for (size_t s = 0; s < mySymbols; s++){
+		if (mySymStarts[s] > mySymStarts[s + 1]){ badTokenFile(); }
+	}
+	if (mySymStarts[mySymbols] != stringBytes){ badTokenFile(); }
+	for (size_t i = 0; i < myCount; i++){
+		if (hasSymbol(myKinds[i]) && myPayloads[i] >= mySymbols){
+			badTokenFile();
+		}
+	}
+}
+
+size_t TokenFile::markIndex(size_t i) const {
+	//The last line mark at or before the token
+	const uint32_t * after = std::upper_bound(myMarkStarts, 
+		myMarkStarts + myMarks, myOffsets[i]);
+	if (after == myMarkStarts){ return 0; }
+	return static_cast<size_t>(after - myMarkStarts) - 1;
+}
+
+const char * TokenFile::text(size_t i, size_t * len) const {
+	uint32_t sym = myPayloads[i];
+	*len = mySymStarts[sym + 1] - mySymStarts[sym];
+	return myStrings + mySymStarts[sym];
+}
+
+void TokenFile::load(TokenStream& stream) const {
+	//The first mark (line 1 at offset 0) is in every stream already
+	for (size_t k = 1; k < myMarks; k++){
+		stream.markLine(myMarkStarts[k], myMarkLines[k]);
+	}
+	std::vector<uint32_t> symIds(mySymbols);
+	for (size_t s = 0; s < mySymbols; s++){
+		size_t len = mySymStarts[s + 1] - mySymStarts[s];
+		const char * spelling = myStrings + mySymStarts[s];
+		symIds[s] = Symbol::intern(spelling, len).id();
+	}
+	for (size_t i = 0; i < myCount; i++){
+		uint32_t payload = myPayloads[i];
+		if (hasSymbol(myKinds[i])){ payload = symIds[payload]; }
+		stream.push(myKinds[i], myOffsets[i], payload);
+	}
+	stream.setEOF(myEOFLine, myEOFCol);
+}
+
+} //End namespace holeyc
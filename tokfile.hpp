@@ -0,0 +1,81 @@
+#ifndef HOLEYC_TOKFILE_HPP
+#define HOLEYC_TOKFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "tokens.hpp"
+#include "writer.hpp"
+
+namespace holeyc{
+
+/**
+* A token stream saved in binary (written by -T), read in place from
+* a buffer such as an mmapped file. All fields are native-endian.
+* The layout, each array starting on a 4-byte boundary, is:
+*
+*   header     8 x u32: magic "HCTK", version, tokens, line marks,
+*              symbols, string bytes, EOF line, EOF column
+*   kinds      u16 per token
+*   offsets    u32 per token: byte offset in the source
+*   payloads   u32 per token: the value of an INTLIT or CHARLIT, or
+*              the symbol number of an ID or STRINGLIT
+*   markStarts u32 per line mark: offset where column 1 restarts
+*   markLines  u32 per line mark: the line number from there on
+*   symStarts  u32 per symbol, plus one: where its text begins in
+*              the string bytes
+*   strings    the spelling of every symbol, back to back
+*
+* Symbols are numbered by the file itself, so a file means the same
+* thing to every process that reads it.
+**/
+class TokenFile{
+public:
+	static const uint32_t MAGIC = 0x4b544348; //"HCTK"
+	static const uint32_t VERSION = 1;
+
+	/** Whether the size bytes at data start like a token file **/
+	static bool isTokenFile(const char * data, size_t size);
+
+	/** Write tokens in this format **/
+	static void write(const TokenStream& tokens, Writer& out);
+
+	/** A view of a token file. Throws if it is malformed **/
+	TokenFile(const char * data, size_t size);
+
+	size_t size() const { return myCount; }
+	int kind(size_t i) const { return myKinds[i]; }
+	size_t offset(size_t i) const { return myOffsets[i]; }
+	size_t line(size_t i) const { return myMarkLines[markIndex(i)]; }
+	size_t col(size_t i) const {
+		return myOffsets[i] - myMarkStarts[markIndex(i)] + 1;
+	}
+	int intVal(size_t i) const { return static_cast<int>(myPayloads[i]); }
+	char charVal(size_t i) const { return static_cast<char>(myPayloads[i]); }
+	/** The spelling of the ID or STRINGLIT token i **/
+	const char * text(size_t i, size_t * len) const;
+	size_t eofLine() const { return myEOFLine; }
+	size_t eofCol() const { return myEOFCol; }
+
+	/** Append the tokens to stream, interning their symbols **/
+	void load(TokenStream& stream) const;
+
+private:
+	size_t markIndex(size_t i) const;
+
+	size_t myCount;
+	size_t myMarks;
+	size_t mySymbols;
+	size_t myEOFLine;
+	size_t myEOFCol;
+	const uint16_t * myKinds;
+	const uint32_t * myOffsets;
+	const uint32_t * myPayloads;
+	const uint32_t * myMarkStarts;
+	const uint32_t * myMarkLines;
+	const uint32_t * mySymStarts;
+	const char * myStrings;
+};
+
+} //End namespace holeyc
+
+#endif
@@ -0,0 +1,353 @@
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "errors.hpp"
+#include "symbols.hpp"
+#include "types.hpp"
+#include "visitor.hpp"
+
+namespace holeyc{
+
+/* Don't share out the bodies of fewer functions than this */
+static const size_t MIN_PARALLEL_FNS = 64;
+
+DataType declaredType(TypeNode * node){
+	switch (node->kind()){
+	case NodeKind::IntType: return DataType::Int;
+	case NodeKind::IntPtr: return DataType::IntPtr;
+	case NodeKind::BoolType: return DataType::Bool;
+	case NodeKind::BoolPtr: return DataType::BoolPtr;
+	case NodeKind::CharType: return DataType::Char;
+	case NodeKind::CharPtr: return DataType::CharPtr;
+	case NodeKind::VoidType: return DataType::Void;
+	default: break;
+	}
+	throw new InternalError("Bad type node");
+}
+
+const char * typeName(DataType type){
+	switch (type){
+	case DataType::Unchecked: return "unchecked";
+	case DataType::Error: return "error";
+	case DataType::Void: return "void";
+	case DataType::Int: return "int";
+	case DataType::Bool: return "bool";
+	case DataType::Char: return "char";
+	case DataType::IntPtr: return "intptr";
+	case DataType::BoolPtr: return "boolptr";
+	case DataType::CharPtr: return "charptr";
+	case DataType::Null: return "NULLPTR";
+	case DataType::Fn: return "function";
+	}
+	return "unknown";
+}
+
+DataType pointee(DataType type){
+	switch (type){
+	case DataType::IntPtr: return DataType::Int;
+	case DataType::BoolPtr: return DataType::Bool;
+	case DataType::CharPtr: return DataType::Char;
+	default: return DataType::Error;
+	}
+}
+
+DataType pointerTo(DataType type){
+	switch (type){
+	case DataType::Int: return DataType::IntPtr;
+	case DataType::Bool: return DataType::BoolPtr;
+	case DataType::Char: return DataType::CharPtr;
+	default: return DataType::Error;
+	}
+}
+
+/* Whether a value of type from can be used where to is wanted */
+static bool compatible(DataType to, DataType from){
+	return to == from || (isPtr(to) && from == DataType::Null);
+}
+
+/*
+Gives every expression in one function's body its type, bottom up,
+and checks each statement once its expressions have theirs. An
+operand of type Error has been reported already, so whatever it is
+part of becomes Error too, without a report of its own.
+*/
+class TypeChecker : public AstVisitor<TypeChecker>{
+public:
+	TypeChecker(FnDeclNode * fnIn)
+	: myFn(fnIn), myReturn(declaredType(fnIn->type())), myOk(true){}
+
+	using AstVisitor<TypeChecker>::post;
+
+	void check(){
+		for (StmtNode * stmt : *myFn->body()){ walk(stmt); }
+	}
+
+	bool ok(){ return myOk; }
+
+	void post(IntLitNode * node){ node->setDataType(DataType::Int); }
+	void post(StrLitNode * node){ node->setDataType(DataType::CharPtr); }
+	void post(CharLitNode * node){ node->setDataType(DataType::Char); }
+	void post(TrueNode * node){ node->setDataType(DataType::Bool); }
+	void post(FalseNode * node){ node->setDataType(DataType::Bool); }
+	void post(NullPtrNode * node){ node->setDataType(DataType::Null); }
+
+	void post(IDNode * node){
+		node->setDataType(node->semSymbol()->type());
+	}
+
+	void post(LValNode * node){ node->setDataType(node->id()->dataType()); }
+
+	void post(DerefNode * node){
+		DataType type = pointee(node->id()->dataType());
+		if (type == DataType::Error){
+			error(node->id(), "Invalid dereference operand");
+		}
+		node->setDataType(type);
+	}
+
+	void post(RefNode * node){
+		DataType type = pointerTo(node->id()->dataType());
+		if (type == DataType::Error){
+			error(node->id(), "Invalid ref operand");
+		}
+		node->setDataType(type);
+	}
+
+	void post(IndexNode * node){
+		DataType type = pointee(node->id()->dataType());
+		if (type == DataType::Error){
+			error(node->id(), "Attempt to index a non-pointer");
+		}
+		if (!operand(node->exp(), DataType::Int, "Non-integer index")){
+			type = DataType::Error;
+		}
+		node->setDataType(type);
+	}
+
+	void post(AssignExpNode * node){
+		const char * msg = "Invalid assignment operand";
+		bool ok = isValue(node->lval(), msg);
+		ok = isValue(node->exp(), msg) && ok;
+		DataType type = node->lval()->dataType();
+		if (ok && !compatible(type, node->exp()->dataType())){
+			error(node, "Invalid assignment operation");
+			ok = false;
+		}
+		node->setDataType(ok ? type : DataType::Error);
+	}
+
+	void post(CallExpNode * node){
+		SemSymbol * sym = node->id()->semSymbol();
+		if (sym->kind() != SemSymbol::FN){
+			error(node->id(), "Attempt to call a non-function");
+			node->setDataType(DataType::Error);
+			return;
+		}
+		FnDeclNode * fn = static_cast<FnDeclNode *>(sym->decl());
+		ArenaVector<FormalDeclNode *>& params = *fn->params();
+		ArenaVector<ExpNode *>& args = *node->args();
+		if (params.size() != args.size()){
+			error(node->id(), "Function call with wrong number of args");
+		} else {
+			for (size_t k = 0; k < args.size(); k++){
+				DataType arg = args[k]->dataType();
+				DataType want = declaredType(params[k]->type());
+				if (arg != DataType::Error && !compatible(want, arg)){
+					error(args[k],
+						"Type of actual does not match type of formal");
+				}
+			}
+		}
+		node->setDataType(declaredType(fn->type()));
+	}
+
+	void post(BinaryExpNode * node){
+		switch (node->kind()){
+		case NodeKind::Minus: case NodeKind::Plus:
+		case NodeKind::Times: case NodeKind::Divide:
+			operands(node, DataType::Int, DataType::Int,
+				"Arithmetic operator applied to invalid operand");
+			return;
+		case NodeKind::And: case NodeKind::Or:
+			operands(node, DataType::Bool, DataType::Bool,
+				"Logical operator applied to non-bool operand");
+			return;
+		case NodeKind::Equals: case NodeKind::NotEquals:
+			equality(node);
+			return;
+		default:
+			operands(node, DataType::Int, DataType::Bool,
+				"Relational operator applied to non-numeric operand");
+			return;
+		}
+	}
+
+	void post(NotNode * node){
+		bool ok = operand(node->exp(), DataType::Bool,
+			"Logical operator applied to non-bool operand");
+		node->setDataType(ok ? DataType::Bool : DataType::Error);
+	}
+
+	void post(NegNode * node){
+		bool ok = operand(node->exp(), DataType::Int,
+			"Arithmetic operator applied to invalid operand");
+		node->setDataType(ok ? DataType::Int : DataType::Error);
+	}
+
+	void post(PostDecStmtNode * node){
+		operand(node->exp(), DataType::Int,
+			"Arithmetic operator applied to invalid operand");
+	}
+
+	void post(PostIncStmtNode * node){
+		operand(node->exp(), DataType::Int,
+			"Arithmetic operator applied to invalid operand");
+	}
+
+	void post(FromConsoleStmtNode * node){
+		DataType type = node->lval()->dataType();
+		if (type == DataType::Fn){
+			error(node->lval(), "Attempt to assign user input to function");
+		} else if (isPtr(type)){
+			error(node->lval(), "Attempt to assign user input to pointer");
+		}
+	}
+
+	void post(ToConsoleStmtNode * node){
+		DataType type = node->exp()->dataType();
+		if (type == DataType::Fn){
+			error(node->exp(), "Attempt to output a function");
+		} else if (type == DataType::Void){
+			error(node->exp(), "Attempt to output void");
+		} else if (type == DataType::Null
+		  || (isPtr(type) && type != DataType::CharPtr)){
+			//A charptr is output as the string it points to
+			error(node->exp(), "Attempt to output a pointer");
+		}
+	}
+
+	void post(IfStmtNode * node){
+		operand(node->exp(), DataType::Bool,
+			"Non-bool expression used as an if condition");
+	}
+
+	void post(IfElseStmtNode * node){
+		operand(node->exp(), DataType::Bool,
+			"Non-bool expression used as an if condition");
+	}
+
+	void post(WhileStmtNode * node){
+		operand(node->exp(), DataType::Bool,
+			"Non-bool expression used as a while condition");
+	}
+
+	void post(ReturnStmtNode * node){
+		ExpNode * exp = node->exp();
+		if (exp == nullptr){
+			if (myReturn != DataType::Void){
+				error(node, "Missing return value");
+			}
+		} else if (myReturn == DataType::Void){
+			error(exp, "Return with a value in void function");
+		} else if (exp->dataType() != DataType::Error
+		  && !compatible(myReturn, exp->dataType())){
+			error(exp, "Bad return value");
+		}
+	}
+
+private:
+	/* Whether exp is of type want, reporting msg if it is not */
+	bool operand(ExpNode * exp, DataType want, const char * msg){
+		DataType type = exp->dataType();
+		if (type == want){ return true; }
+		if (type != DataType::Error){ error(exp, msg); }
+		return false;
+	}
+
+	/* Both operands of node should be want, and make it result */
+	void operands(BinaryExpNode * node, DataType want, DataType result,
+		const char * msg
+	){
+		bool ok = operand(node->lhs(), want, msg);
+		ok = operand(node->rhs(), want, msg) && ok;
+		node->setDataType(ok ? result : DataType::Error);
+	}
+
+	/*
+	Whether exp is something that can be compared or assigned: not
+	a function or void, reporting msg if it is, nor already in error
+	*/
+	bool isValue(ExpNode * exp, const char * msg){
+		DataType type = exp->dataType();
+		if (type == DataType::Error){ return false; }
+		if (type == DataType::Fn || type == DataType::Void){
+			error(exp, msg);
+			return false;
+		}
+		return true;
+	}
+
+	void equality(BinaryExpNode * node){
+		const char * msg = "Invalid equality operand";
+		bool ok = isValue(node->lhs(), msg);
+		ok = isValue(node->rhs(), msg) && ok;
+		DataType lhs = node->lhs()->dataType();
+		DataType rhs = node->rhs()->dataType();
+		if (ok && !compatible(lhs, rhs) && !compatible(rhs, lhs)){
+			error(node, "Invalid equality operation");
+			ok = false;
+		}
+		node->setDataType(ok ? DataType::Bool : DataType::Error);
+	}
+
+	void error(ASTNode * node, const char * msg){
+		Report::fatal(node->line(), node->col(), msg);
+		myOk = false;
+	}
+
+	FnDeclNode * myFn;
+	DataType myReturn;
+	bool myOk;
+};
+
+bool typeCheck(ProgramNode * program, WorkerPool * pool){
+	//Name analysis has already checked every declaration, so the
+	//signatures need only be gathered before the bodies can be
+	//checked independently
+	std::vector<FnDeclNode *> fns;
+	for (DeclNode * decl : *program->globals()){
+		if (decl->kind() == NodeKind::FnDecl){
+			fns.push_back(static_cast<FnDeclNode *>(decl));
+		}
+	}
+
+	Diagnostics * into = Diagnostics::current();
+	if (pool == nullptr || into == nullptr
+	  || fns.size() < MIN_PARALLEL_FNS){
+		bool ok = true;
+		for (FnDeclNode * fn : fns){
+			TypeChecker checker(fn);
+			checker.check();
+			ok = checker.ok() && ok;
+		}
+		return ok;
+	}
+
+	std::atomic<bool> ok(true);
+	std::mutex lock;
+	pool->run(fns.size(), [&](size_t i){
+		//Positions in different bodies never coincide, so however
+		//the threads interleave, the sort by position on flush puts
+		//every diagnostic back in source order
+		Diagnostics local(nullptr, 0);
+		TypeChecker checker(fns[i]);
+		checker.check();
+		if (checker.ok()){ return; }
+		ok = false;
+		std::lock_guard<std::mutex> hold(lock);
+		local.moveTo(*into);
+	});
+	return ok;
+}
+
+} // End namespace holeyc
@@ -0,0 +1,37 @@
+#ifndef HOLEYC_TYPES_HPP
+#define HOLEYC_TYPES_HPP
+
+#include "ast.hpp"
+#include "pool.hpp"
+
+namespace holeyc{
+
+/** The type that a declaration's type node stands for **/
+DataType declaredType(TypeNode * node);
+
+/** How the type is spelled in source, e.g. charptr **/
+const char * typeName(DataType type);
+
+inline bool isPtr(DataType type){
+	return type == DataType::IntPtr || type == DataType::BoolPtr
+		|| type == DataType::CharPtr;
+}
+
+/** What a pointer of type points to; Error if it is no pointer **/
+DataType pointee(DataType type);
+
+/** The pointer to type; Error if there is no such pointer **/
+DataType pointerTo(DataType type);
+
+/**
+* Check the types in program, whose names have all been resolved,
+* giving every expression its type (see typecheck.cpp). Function
+* bodies are checked on pool, if there is one, with the diagnostics
+* they report collected in source order all the same. Returns
+* whether there were no errors.
+**/
+bool typeCheck(ProgramNode * program, WorkerPool * pool);
+
+} //End namespace holeyc
+
+#endif
@@ -1,386 +1,278 @@
 #include "ast.hpp"
+#include "symbols.hpp"
+#include "visitor.hpp"
 
 namespace holeyc{
 
 /*
-doIndent is declared static, which means that it can 
-only be called in this file (its symbol is not exported).
+Writes the tree back out as source. Statements and declarations
+start at the current indent, and the statements of a body go one
+level deeper; expressions are never indented. A visit writes what
+comes before a node's first child, and schedules the rest as steps.
 */
-static void doIndent(std::ostream& out, int indent){
-	for (int k = 0 ; k < indent; k++){ out << "\t"; }
-}
-
-/*
-In this code, the intention is that functions are grouped 
-into files by purpose, rather than by class.
-If you're used to having all of the functions of a class 
-defined in the same file, this style may be a bit disorienting,
-though it is legal. Thus, we can have
-ProgramNode::unparse, which is the unparse method of ProgramNodes
-defined in the same file as DeclNode::unparse, the unparse method
-of DeclNodes.
-*/
-
-
-void ProgramNode::unparse(std::ostream& out, int indent){
-	/* Oh, hey it's a for-each loop in C++!
-	   The loop iterates over each element in a collection
-	   without that gross i++ nonsense. 
-	 */
-	for (auto global : *myGlobals){
-		/* The auto keyword tells the compiler
-		   to (try to) figure out what the
-		   type of a variable should be from 
-		   context. here, since we're iterating
-		   over a list of DeclNode *s, it's 
-		   pretty clear that global is of 
-		   type DeclNode *.
-		*/
-		global->unparse(out, indent);
+class Unparser : public AstVisitor<Unparser>{
+public:
+	Unparser(Writer& outIn, bool namesIn) 
+	: myOut(outIn), myIndent(0), myNames(namesIn){}
+
+	using AstVisitor<Unparser>::visit;
+
+	//Each visit writes, then only schedules
+	static const bool EAGER = true;
+
+	void visit(VarDeclNode * node){
+		startLine();
+		later(node->type());
+		later(node, SPACE);
+		later(node->id());
+		later(node, END_STMT);
 	}
-}
-
-void VarDeclNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	this->myType->unparse(out, 0);
-	out << " ";
-	this->myId->unparse(out, 0);
-	out << ";\n";
-}
-
-void IDNode::unparse(std::ostream& out, int indent){
-	out << this->myStrVal;
-}
-
-void IntTypeNode::unparse(std::ostream& out, int indent){
-	out << "int";
-}
-
-void IntPtrNode::unparse(std::ostream& out, int indent){
-	out << "intptr";
-}
-
-void BoolTypeNode::unparse(std::ostream& out, int indent){
-	out << "bool";
-}
-
-void BoolPtrNode::unparse(std::ostream& out, int indent){
-	out << "boolptr";
-}
-
-void CharTypeNode::unparse(std::ostream& out, int indent){
-	out << "char";
-}
 
-void CharPtrNode::unparse(std::ostream& out, int indent){
-	out << "charptr";
-}
-
-void VoidTypeNode::unparse(std::ostream& out, int indent){
-	out << "void";
-}
-
-void FnDeclNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	this->myType->unparse(out, 0);
-	out << " ";
-	this->myId->unparse(out, 0);
-	out << "(";
-	for (auto param: *myParams)
-		param->unparse(out, 0);
-	out << ") {\n";
-	for (auto line: *myBody){
-		line->unparse(out, indent + 1);
+	void visit(FnDeclNode * node){
+		startLine();
+		later(node->type());
+		later(node, SPACE);
+		later(node->id());
+		later(node, OPEN);
+		later(node->params());
+		later(node, OPEN_BODY);
+		later(node->body());
+		later(node, CLOSE_FN);
 	}
-	out << "}\n";
-}
-
-void AssignStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	this->myAssign->unparse(out, 0);
-	out<< ";\n";
-}
-
-void PostDecStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	this->myExp->unparse(out, 0);
-	out<<"--;\n";
-}
-
-void PostIncStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	this->myExp->unparse(out, 0);
-	out<<"++;\n";
-}
-
-void FromConsoleStmtNode::unparse(std::ostream& out, int indent){         
-	doIndent(out, indent);
-	out<<"FROMCONSOLE ";
-	this->myLVal->unparse(out, 0);
-	out<<";\n";
-}
-
-void ToConsoleStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out<<"TOCONSOLE ";
-	this->myExp->unparse(out, 0);
-	out<<";\n";
-}
 
-void IfStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out<<"if (";
-	this->myExp->unparse(out, 0);
-	out<<") {\n";
-	for (auto stmt: *myStmtList)
-		stmt->unparse(out, indent+1);
-	doIndent(out, indent);
-	out<<"}\n";
-}
-
-void IfElseStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out<<"if (";
-	this->myExp->unparse(out, 0);
-	out<<") {\n";
-	for (auto stmt: *myTList)
-		stmt->unparse(out, indent+1);
-	doIndent(out, indent);
-	out<<"} else {\n";
-	for (auto stmt: *myFList)
-		stmt->unparse(out, indent+1);
-	doIndent(out, indent);
-	out<<"}\n";
-}
-
-void WhileStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out<<"while (";
-	this->myExp->unparse(out, 0);
-	out<<") {\n";
-	for (auto stmt: *myStmtList)
-		stmt->unparse(out, indent+1);
-	doIndent(out, indent);
-	out<<"}\n";
-}
-
-void ReturnStmtNode::unparse(std::ostream& out, int indent){				// cant figure out how to get this working with no return arguments
-	doIndent(out, indent);																						// the issue is that in the constructor for return stmt node
-	out<<"return";
-	if(!this->empty){
-		out<<" ";
-		this->myExp->unparse(out, 0);
+	void visit(FormalDeclNode * node){
+		later(node->type());
+		later(node, SPACE);
+		later(node->id());
 	}
-	out<<";\n";
-}
-
-void CallStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	this->myCall->unparse(out, 0);
-	out<<";\n";
-}
-
-void AssignExpNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	this->myLVal->unparse(out, 0);
-	out << " = ";
-	this->myExp->unparse(out, 0);
-}
 
-void MinusNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "(";
-	this->myLhs->unparse(out, 0);
-	out << " - ";
-	this->myRhs->unparse(out, 0);
-	out << ")";
-}
-
-void PlusNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "(";
-	this->myLhs->unparse(out, 0);
-	out << " + ";
-	this->myRhs->unparse(out, 0);
-	out << ")";
-}
-
-void TimesNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "(";
-	this->myLhs->unparse(out, 0);
-	out << " * ";
-	this->myRhs->unparse(out, 0);
-	out << ")";
-}
+	void visit(IntTypeNode * node){ myOut << "int"; }
+	void visit(IntPtrNode * node){ myOut << "intptr"; }
+	void visit(BoolTypeNode * node){ myOut << "bool"; }
+	void visit(BoolPtrNode * node){ myOut << "boolptr"; }
+	void visit(CharTypeNode * node){ myOut << "char"; }
+	void visit(CharPtrNode * node){ myOut << "charptr"; }
+	void visit(VoidTypeNode * node){ myOut << "void"; }
+
+	void visit(AssignStmtNode * node){
+		startLine();
+		later(node->assign());
+		later(node, END_STMT);
+	}
 
-void DivideNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "(";
-	this->myLhs->unparse(out, 0);
-	out << " / ";
-	this->myRhs->unparse(out, 0);
-	out << ")";
-}
+	void visit(PostDecStmtNode * node){
+		startLine();
+		later(node->exp());
+		later(node, DEC);
+	}
 
-void AndNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "(";
-	this->myLhs->unparse(out, 0);
-	out << " && ";
-	this->myRhs->unparse(out, 0);
-	out << ")";
-}
+	void visit(PostIncStmtNode * node){
+		startLine();
+		later(node->exp());
+		later(node, INC);
+	}
 
-void OrNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "(";
-	this->myLhs->unparse(out, 0);
-	out << " || ";
-	this->myRhs->unparse(out, 0);
-	out << ")";
-}
+	void visit(FromConsoleStmtNode * node){
+		startLine();
+		myOut << "FROMCONSOLE ";
+		later(node->lval());
+		later(node, END_STMT);
+	}
 
-void EqualsNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "(";
-	this->myLhs->unparse(out, 0);
-	out << " == ";
-	this->myRhs->unparse(out, 0);
-	out << ")";
-}
+	void visit(ToConsoleStmtNode * node){
+		startLine();
+		myOut << "TOCONSOLE ";
+		later(node->exp());
+		later(node, END_STMT);
+	}
 
-void NotEqualsNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "(";
-	this->myLhs->unparse(out, 0);
-	out << " != ";
-	this->myRhs->unparse(out, 0);
-	out << ")";
-}
+	void visit(IfStmtNode * node){
+		startLine();
+		myOut << "if (";
+		later(node->exp());
+		later(node, OPEN_BODY);
+		later(node->body());
+		later(node, CLOSE_BODY);
+	}
 
-void GreaterNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "(";
-	this->myLhs->unparse(out, 0);
-	out << " > ";
-	this->myRhs->unparse(out, 0);
-	out << ")";
-}
+	void visit(IfElseStmtNode * node){
+		startLine();
+		myOut << "if (";
+		later(node->exp());
+		later(node, OPEN_BODY);
+		later(node->thenBody());
+		later(node, ELSE);
+		later(node->elseBody());
+		later(node, CLOSE_BODY);
+	}
 
-void GreaterEqNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "(";
-	this->myLhs->unparse(out, 0);
-	out << " >= ";
-	this->myRhs->unparse(out, 0);
-	out << ")";
-}
+	void visit(WhileStmtNode * node){
+		startLine();
+		myOut << "while (";
+		later(node->exp());
+		later(node, OPEN_BODY);
+		later(node->body());
+		later(node, CLOSE_BODY);
+	}
 
-void LessNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "(";
-	this->myLhs->unparse(out, 0);
-	out << " < ";
-	this->myRhs->unparse(out, 0);
-	out << ")";
-}
+	void visit(ReturnStmtNode * node){
+		startLine();
+		if (node->exp() == nullptr){
+			myOut << "return;\n";
+			return;
+		}
+		myOut << "return ";
+		later(node->exp());
+		later(node, END_STMT);
+	}
 
-void LessEqNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "(";
-	this->myLhs->unparse(out, 0);
-	out << " <= ";
-	this->myRhs->unparse(out, 0);
-	out << ")";
-}
+	void visit(CallStmtNode * node){
+		startLine();
+		later(node->call());
+		later(node, END_STMT);
+	}
 
-void NotNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "(";
-	out << "!";
-	this->myExp->unparse(out, 0);
-	out << ")";
-}
+	void visit(AssignExpNode * node){
+		later(node->lval());
+		later(node, ASSIGN);
+		later(node->exp());
+	}
 
-void NegNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "(";
-	out << "-";
-	this->myExp->unparse(out, 0);
-	out << ")";
-}
+	void visit(CallExpNode * node){
+		later(node->id());
+		later(node, OPEN);
+		later(node->args());
+		later(node, CLOSE);
+	}
 
-void FormalDeclNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	this->myType->unparse(out, 0);
-	out << " ";
-	this->myId->unparse(out, 0);
-}
+	void visit(MinusNode * node){ binary(node, MINUS); }
+	void visit(PlusNode * node){ binary(node, PLUS); }
+	void visit(TimesNode * node){ binary(node, TIMES); }
+	void visit(DivideNode * node){ binary(node, DIVIDE); }
+	void visit(AndNode * node){ binary(node, AND); }
+	void visit(OrNode * node){ binary(node, OR); }
+	void visit(EqualsNode * node){ binary(node, EQUALS); }
+	void visit(NotEqualsNode * node){ binary(node, NOT_EQUALS); }
+	void visit(GreaterNode * node){ binary(node, GREATER); }
+	void visit(GreaterEqNode * node){ binary(node, GREATER_EQ); }
+	void visit(LessNode * node){ binary(node, LESS); }
+	void visit(LessEqNode * node){ binary(node, LESS_EQ); }
+
+	void visit(NotNode * node){
+		myOut << "(!";
+		later(node->exp());
+		later(node, CLOSE);
+	}
 
-void NullPtrNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out<<"NULLPTR";
-}
+	void visit(NegNode * node){
+		myOut << "(-";
+		later(node->exp());
+		later(node, CLOSE);
+	}
 
-void IntLitNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << myInt;
-}
+	void visit(NullPtrNode * node){ myOut << "NULLPTR"; }
+	void visit(IntLitNode * node){ myOut << node->value(); }
+	void visit(StrLitNode * node){ myOut << node->str().text(); }
+	void visit(CharLitNode * node){ myOut << node->value(); }
+	void visit(TrueNode * node){ myOut << "True"; }
+	void visit(FalseNode * node){ myOut << "False"; }
 
-void StrLitNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << myStr;
-}
+	void visit(LValNode * node){ later(node->id()); }
 
-void CharLitNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << myChar;
-}
+	void visit(IndexNode * node){
+		later(node->id());
+		later(node, OPEN_INDEX);
+		later(node->exp());
+		later(node, CLOSE_INDEX);
+	}
 
-void TrueNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "True";
-	
-}
+	void visit(DerefNode * node){
+		myOut << "@";
+		later(node->id());
+	}
 
-void FalseNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "False";
-}
+	void visit(RefNode * node){
+		myOut << "^";
+		later(node->id());
+	}
 
-void LValNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	this->myId->unparse(out, 0);
-}
+	void visit(IDNode * node){
+		myOut << node->sym().text();
+		SemSymbol * sym = node->semSymbol();
+		if (myNames && sym != nullptr){
+			myOut << '{';
+			sym->writeType(myOut);
+			myOut << '}';
+		}
+	}
 
-void IndexNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	this->myId->unparse(out, 0);
-	out<<"[";
-	this->myExp->unparse(out, 0);
-	out<<"]";
-}
+	/* The text between the children of a node */
+	void resume(ASTNode * node, uint32_t step){
+		//Most steps only write text, which is looked up rather than
+		//switched on, as there is a step for almost every node
+		struct Text{ const char * text; size_t len; };
+		static const Text TEXTS[NUM_TEXTS] = {
+			{" ", 1}, {";\n", 2}, {"(", 1}, {")", 1},
+			{"--;\n", 4}, {"++;\n", 4}, {" = ", 3}, {"[", 1}, {"]", 1},
+			{" - ", 3}, {" + ", 3}, {" * ", 3}, {" / ", 3},
+			{" && ", 4}, {" || ", 4}, {" == ", 4}, {" != ", 4},
+			{" > ", 3}, {" >= ", 4}, {" < ", 3}, {" <= ", 4},
+		};
+		if (step < NUM_TEXTS){
+			myOut.write(TEXTS[step].text, TEXTS[step].len);
+			return;
+		}
+		switch (step){
+		case OPEN_BODY:
+			myOut << ") {\n";
+			myIndent++;
+			return;
+		case CLOSE_BODY:
+			myIndent--;
+			startLine();
+			myOut << "}\n";
+			return;
+		case CLOSE_FN:
+			myIndent--;
+			myOut << "}\n";
+			return;
+		case ELSE:
+			myIndent--;
+			startLine();
+			myOut << "} else {\n";
+			myIndent++;
+			return;
+		}
+	}
 
-void DerefNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "@";
-	this->myId->unparse(out, 0);
-}
+private:
+	enum Step : uint32_t {
+		SPACE, END_STMT, OPEN, CLOSE,
+		DEC, INC, ASSIGN, OPEN_INDEX, CLOSE_INDEX,
+		MINUS, PLUS, TIMES, DIVIDE, AND, OR, 
+		EQUALS, NOT_EQUALS, GREATER, GREATER_EQ, LESS, LESS_EQ,
+		NUM_TEXTS,
+		OPEN_BODY = NUM_TEXTS, CLOSE_BODY, CLOSE_FN, ELSE
+	};
+
+	void startLine(){ myOut.indent(static_cast<int>(myIndent)); }
+
+	void binary(BinaryExpNode * node, Step op){
+		myOut << "(";
+		later(node->lhs());
+		later(node, op);
+		later(node->rhs());
+		later(node, CLOSE);
+	}
 
-void RefNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "^";
-	this->myId->unparse(out, 0);
-}
+	Writer& myOut;
+	size_t myIndent;
+	bool myNames;
+};
 
-void CallExpNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	this->myId->unparse(out, 0);
-	out << "(";
-	for (auto param : *myParams)
-		param->unparse(out, 0);
-	out << ")";
+void unparse(ASTNode * node, Writer& out, bool names){
+	Unparser unparser(out, names);
+	unparser.walk(node);
 }
 
 } // End namespace holeyc
@@ -0,0 +1,329 @@
+#ifndef HOLEYC_VISITOR_HPP
+#define HOLEYC_VISITOR_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "ast.hpp"
+#include "errors.hpp"
+
+namespace holeyc{
+
+/**
+* A pass over the AST, dispatched on each node's kind() with a switch
+* rather than with a virtual call per node. Derived (which inherits
+* from AstVisitor<Derived>) provides any of these for a node class X,
+* and they are found statically, so they inline into the walk:
+*
+*   void visit(X * node)  the whole visit of node. By default pre,
+*                         then node's children in source order, then
+*                         post
+*   bool pre(X * node)    before node's children; return false to
+*                         skip them
+*   void post(X * node)   after node's children
+*   void resume(X * node, uint32_t step)
+*                         a step of node's visit (see later)
+*
+* X may be an abstract class too (e.g. pre(StmtNode *) for every
+* statement); the closest match is used. Derived must bring in the
+* defaults of whichever it hides, with e.g.
+* "using AstVisitor<Derived>::visit;"
+*
+* The walk does not recurse: a visit does not visit children itself,
+* but schedules them with later(), as well as any steps of its own
+* to be taken between them. What a visit schedules is done, in the
+* order it was scheduled, once the visit returns, so that a tree of
+* any depth can be walked on a work stack of its own.
+*
+* A Derived whose visits, pre and post do nothing after they first
+* schedule (e.g. Unparser) can declare
+* "static const bool EAGER = true;". Then as long as the walk is not
+* deep, what it schedules is done right away instead, as a call, so
+* the same order costs no trip through the work stack.
+**/
+template <typename Derived>
+class AstVisitor{
+public:
+	AstVisitor() : myMark(0), myDepth(0){}
+
+	/** Visit node and everything under it **/
+	void walk(ASTNode * node){
+		size_t base = myWork.size();
+		size_t outerMark = myMark;
+		myMark = base;
+		later(node);
+		runScheduled(base);
+		myMark = outerMark;
+	}
+
+	template <typename NodeT>
+	void visit(NodeT * node){
+		Derived& self = derived();
+		if (!self.pre(node)){
+			self.post(node);
+			return;
+		}
+		laterChildren(node);
+		schedule(Task{node, POST});
+	}
+
+	static const bool EAGER = false;
+
+	bool pre(ASTNode * node){ return true; }
+	void post(ASTNode * node){}
+	void resume(ASTNode * node, uint32_t step){}
+
+protected:
+	/** Visit node, once the current visit is done **/
+	void later(ASTNode * node){ schedule(Task{node, VISIT}); }
+
+	/** Visit each node of list in order **/
+	template <typename NodeT>
+	void later(ArenaVector<NodeT *> * list){
+		for (NodeT * node : *list){
+			later(node);
+		}
+	}
+
+	/** Call resume(node, step), once what is before it is done **/
+	void later(ASTNode * node, uint32_t step){
+		schedule(Task{node, step});
+	}
+
+	/** Schedule the children of node in source order **/
+	void laterChildren(ProgramNode * node){ later(node->globals()); }
+	void laterChildren(VarDeclNode * node){
+		later(node->type());
+		later(node->id());
+	}
+	void laterChildren(FnDeclNode * node){
+		later(node->type());
+		later(node->id());
+		later(node->params());
+		later(node->body());
+	}
+	void laterChildren(FormalDeclNode * node){
+		later(node->type());
+		later(node->id());
+	}
+	void laterChildren(TypeNode * node){}
+	void laterChildren(AssignStmtNode * node){ later(node->assign()); }
+	void laterChildren(PostDecStmtNode * node){ later(node->exp()); }
+	void laterChildren(PostIncStmtNode * node){ later(node->exp()); }
+	void laterChildren(FromConsoleStmtNode * node){ later(node->lval()); }
+	void laterChildren(ToConsoleStmtNode * node){ later(node->exp()); }
+	void laterChildren(IfStmtNode * node){
+		later(node->exp());
+		later(node->body());
+	}
+	void laterChildren(IfElseStmtNode * node){
+		later(node->exp());
+		later(node->thenBody());
+		later(node->elseBody());
+	}
+	void laterChildren(WhileStmtNode * node){
+		later(node->exp());
+		later(node->body());
+	}
+	void laterChildren(ReturnStmtNode * node){
+		if (node->exp() != nullptr){ later(node->exp()); }
+	}
+	void laterChildren(CallStmtNode * node){ later(node->call()); }
+	void laterChildren(AssignExpNode * node){
+		later(node->lval());
+		later(node->exp());
+	}
+	void laterChildren(CallExpNode * node){
+		later(node->id());
+		later(node->args());
+	}
+	void laterChildren(BinaryExpNode * node){
+		later(node->lhs());
+		later(node->rhs());
+	}
+	void laterChildren(UnaryExpNode * node){ later(node->exp()); }
+	void laterChildren(LValNode * node){ later(node->id()); }
+	void laterChildren(IndexNode * node){
+		later(node->id());
+		later(node->exp());
+	}
+	void laterChildren(NullPtrNode * node){}
+	void laterChildren(IntLitNode * node){}
+	void laterChildren(StrLitNode * node){}
+	void laterChildren(CharLitNode * node){}
+	void laterChildren(TrueNode * node){}
+	void laterChildren(FalseNode * node){}
+	void laterChildren(IDNode * node){}
+
+private:
+	static const uint32_t VISIT = UINT32_MAX;
+	static const uint32_t POST = UINT32_MAX - 1;
+	//How deep the walk recurses before it uses the work stack
+	static const unsigned MAX_DEPTH = 512;
+
+	struct Task{
+		ASTNode * node;
+		uint32_t step; //VISIT, POST, or a step for resume
+	};
+
+	Derived& derived(){ return *static_cast<Derived *>(this); }
+
+	/*
+	Whether Derived has just the one resume, for any node, so that a
+	step needs no dispatch on the node's kind
+	*/
+	template <typename D>
+	static constexpr bool oneResume(decltype(&D::resume)){
+		return std::is_same<decltype(&D::resume),
+			void (D::*)(ASTNode *, uint32_t)>::value;
+	}
+	template <typename D>
+	static constexpr bool oneResume(...){ return false; }
+
+	/*
+	Do task once what the current visit has already scheduled is
+	done: for an EAGER Derived with nothing scheduled yet, that is
+	now, unless the walk is too deep
+	*/
+	void schedule(Task task){
+		if (Derived::EAGER && myWork.size() == myMark
+			&& myDepth < MAX_DEPTH){
+			size_t mark = myMark;
+			myDepth++;
+			run(task);
+			//Anything it had to leave on the work stack, first
+			if (myWork.size() != mark){ runScheduled(mark); }
+			myDepth--;
+			myMark = mark;
+			return;
+		}
+		myWork.push_back(task);
+	}
+
+	/*
+	Run the tasks scheduled from mark on, in order, each followed at
+	once by what it schedules in turn, and then drop them. Most trees
+	are shallow enough for this to recurse, which is cheaper than
+	reordering every task onto the work stack; deeper down, the rest
+	of the walk is done with runStacked.
+	*/
+	void runScheduled(size_t mark){
+		size_t end = myWork.size();
+		for (size_t i = mark; i < end; i++){
+			myMark = end;
+			run(myWork[i]);
+			if (myWork.size() == end){ continue; }
+			if (myDepth < MAX_DEPTH){
+				myDepth++;
+				runScheduled(end);
+				myDepth--;
+			} else {
+				runStacked(end);
+			}
+		}
+		myWork.resize(mark);
+	}
+
+	/* Run the tasks scheduled from base on, and all that follows */
+	void runStacked(size_t base){
+		//The work stack is last in, first out
+		std::reverse(myWork.begin() + static_cast<long>(base),
+			myWork.end());
+		while (myWork.size() > base){
+			Task task = myWork.back();
+			myWork.pop_back();
+			myMark = myWork.size();
+			run(task);
+			std::reverse(myWork.begin() + static_cast<long>(myMark),
+				myWork.end());
+		}
+	}
+
+	void run(Task task){
+		if (oneResume<Derived>(nullptr) && task.step < POST){
+			derived().resume(task.node, task.step);
+			return;
+		}
+		switch (task.node->kind()){
+		case NodeKind::Program: runAs<ProgramNode>(task); return;
+		case NodeKind::VarDecl: runAs<VarDeclNode>(task); return;
+		case NodeKind::FnDecl: runAs<FnDeclNode>(task); return;
+		case NodeKind::FormalDecl: runAs<FormalDeclNode>(task); return;
+		case NodeKind::IntType: runAs<IntTypeNode>(task); return;
+		case NodeKind::IntPtr: runAs<IntPtrNode>(task); return;
+		case NodeKind::BoolType: runAs<BoolTypeNode>(task); return;
+		case NodeKind::BoolPtr: runAs<BoolPtrNode>(task); return;
+		case NodeKind::CharType: runAs<CharTypeNode>(task); return;
+		case NodeKind::CharPtr: runAs<CharPtrNode>(task); return;
+		case NodeKind::VoidType: runAs<VoidTypeNode>(task); return;
+		case NodeKind::AssignStmt: runAs<AssignStmtNode>(task); return;
+		case NodeKind::PostDecStmt: runAs<PostDecStmtNode>(task); return;
+		case NodeKind::PostIncStmt: runAs<PostIncStmtNode>(task); return;
+		case NodeKind::FromConsoleStmt:
+			runAs<FromConsoleStmtNode>(task); return;
+		case NodeKind::ToConsoleStmt:
+			runAs<ToConsoleStmtNode>(task); return;
+		case NodeKind::IfStmt: runAs<IfStmtNode>(task); return;
+		case NodeKind::IfElseStmt: runAs<IfElseStmtNode>(task); return;
+		case NodeKind::WhileStmt: runAs<WhileStmtNode>(task); return;
+		case NodeKind::ReturnStmt: runAs<ReturnStmtNode>(task); return;
+		case NodeKind::CallStmt: runAs<CallStmtNode>(task); return;
+		case NodeKind::AssignExp: runAs<AssignExpNode>(task); return;
+		case NodeKind::CallExp: runAs<CallExpNode>(task); return;
+		case NodeKind::Minus: runAs<MinusNode>(task); return;
+		case NodeKind::Plus: runAs<PlusNode>(task); return;
+		case NodeKind::Times: runAs<TimesNode>(task); return;
+		case NodeKind::Divide: runAs<DivideNode>(task); return;
+		case NodeKind::And: runAs<AndNode>(task); return;
+		case NodeKind::Or: runAs<OrNode>(task); return;
+		case NodeKind::Equals: runAs<EqualsNode>(task); return;
+		case NodeKind::NotEquals: runAs<NotEqualsNode>(task); return;
+		case NodeKind::Greater: runAs<GreaterNode>(task); return;
+		case NodeKind::GreaterEq: runAs<GreaterEqNode>(task); return;
+		case NodeKind::Less: runAs<LessNode>(task); return;
+		case NodeKind::LessEq: runAs<LessEqNode>(task); return;
+		case NodeKind::Not: runAs<NotNode>(task); return;
+		case NodeKind::Neg: runAs<NegNode>(task); return;
+		case NodeKind::NullPtr: runAs<NullPtrNode>(task); return;
+		case NodeKind::IntLit: runAs<IntLitNode>(task); return;
+		case NodeKind::StrLit: runAs<StrLitNode>(task); return;
+		case NodeKind::CharLit: runAs<CharLitNode>(task); return;
+		case NodeKind::True: runAs<TrueNode>(task); return;
+		case NodeKind::False: runAs<FalseNode>(task); return;
+		case NodeKind::LVal: runAs<LValNode>(task); return;
+		case NodeKind::Index: runAs<IndexNode>(task); return;
+		case NodeKind::Deref: runAs<DerefNode>(task); return;
+		case NodeKind::Ref: runAs<RefNode>(task); return;
+		case NodeKind::ID: runAs<IDNode>(task); return;
+		case NodeKind::NumKinds: break;
+		}
+		throw new InternalError("Bad AST node kind");
+	}
+
+	/*
+	One small function per class, which the hooks inline into, so
+	that run itself is only a jump table: inlining every hook into
+	run would make each task pay for the registers that the largest
+	of them needs.
+	*/
+	template <typename NodeT>
+	__attribute__((noinline)) void runAs(Task task){
+		NodeT * node = static_cast<NodeT *>(task.node);
+		if (task.step == VISIT){
+			derived().visit(node);
+		} else if (task.step == POST){
+			derived().post(node);
+		} else {
+			derived().resume(node, task.step);
+		}
+	}
+
+	std::vector<Task> myWork;
+	size_t myMark; //where what the current visit schedules starts
+	unsigned myDepth;
+};
+
+} //End namespace holeyc
+
+#endif
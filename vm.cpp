@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "bytecode.hpp"
+#include "errors.hpp"
+
+namespace holeyc{
+
+/* Registers for all of a run's frames, and memory for their locals */
+static const size_t REG_STACK = size_t(1) << 23;
+static const size_t MEM_STACK = size_t(1) << 22;
+
+/* Output is written out once this much is waiting */
+static const size_t OUT_CHUNK = size_t(1) << 16;
+
+static int64_t wrap(int64_t val){
+	return static_cast<int32_t>(static_cast<uint32_t>(val));
+}
+
+/*
+The console of one run, buffered both ways. Output is flushed
+before each read (so that a prompt is seen before the program
+waits) and at the end. Inputs compiled side by side share stdin,
+so each fill of the input buffer holds a lock.
+*/
+class Console{
+public:
+	Console(std::istream& inIn) : myIn(inIn), myPos(0), myEnd(0){}
+	~Console(){ flush(); }
+	Console(const Console&) = delete;
+
+	void writeInt(int64_t val){
+		char text[16];
+		int len = snprintf(text, sizeof(text), "%lld",
+			static_cast<long long>(val));
+		myOut.append(text, static_cast<size_t>(len));
+		written();
+	}
+
+	void writeBool(int64_t val){
+		myOut.append(val != 0 ? "true" : "false");
+		written();
+	}
+
+	void writeChar(int64_t val){
+		myOut.push_back(static_cast<char>(val));
+		written();
+	}
+
+	void flush(){
+		if (myOut.empty()){ return; }
+		Report::out().write(myOut.data(),
+			static_cast<std::streamsize>(myOut.size()));
+		Report::out().flush();
+		myOut.clear();
+	}
+
+	/* An optional '-' and at least one digit, after any space */
+	bool readInt(int64_t& val){
+		flush();
+		skipSpace();
+		bool negative = peek() == '-';
+		if (negative){ myPos++; }
+		if (!isDigit(peek())){ return false; }
+		int64_t magnitude = 0;
+		while (isDigit(peek())){
+			magnitude = wrap(magnitude * 10 + (myBuf[myPos++] - '0'));
+		}
+		val = wrap(negative ? -magnitude : magnitude);
+		return true;
+	}
+
+	/* true, false, 1 or 0 */
+	bool readBool(int64_t& val){
+		flush();
+		skipSpace();
+		std::string word;
+		while (peek() != EOF && !isSpace(peek())){
+			word.push_back(myBuf[myPos++]);
+		}
+		if (word == "true" || word == "1"){ val = 1; return true; }
+		if (word == "false" || word == "0"){ val = 0; return true; }
+		return false;
+	}
+
+	/* The next char that is not a space */
+	bool readChar(int64_t& val){
+		flush();
+		skipSpace();
+		if (peek() == EOF){ return false; }
+		val = static_cast<unsigned char>(myBuf[myPos++]);
+		return true;
+	}
+
+private:
+	static bool isDigit(int ch){ return ch >= '0' && ch <= '9'; }
+
+	static bool isSpace(int ch){
+		return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+	}
+
+	void written(){ if (myOut.size() >= OUT_CHUNK){ flush(); } }
+
+	int peek(){
+		if (myPos == myEnd && !fill()){ return EOF; }
+		return static_cast<unsigned char>(myBuf[myPos]);
+	}
+
+	void skipSpace(){ while (isSpace(peek())){ myPos++; } }
+
+	bool fill(){
+		static std::mutex lock;
+		std::lock_guard<std::mutex> guard(lock);
+		std::streamsize got = myIn.rdbuf()->sgetn(myBuf, sizeof(myBuf));
+		myPos = 0;
+		myEnd = got > 0 ? static_cast<size_t>(got) : 0;
+		return myEnd != 0;
+	}
+
+	std::istream& myIn;
+	std::string myOut;
+	char myBuf[4096];
+	size_t myPos;
+	size_t myEnd;
+};
+
+/* Where to go back to when a function returns */
+struct Frame{
+	const Instr * ret;
+	int64_t * regs;
+	int64_t fp;
+};
+
+/*
+Each instruction's code ends by jumping straight to the code of the
+next one, through a table of the addresses of their labels (a GNU
+extension), so that each has its own branch to predict.
+*/
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+int runBytecode(const Bytecode& bc, std::istream& in, uint64_t& executed){
+#define HOLEYC_OP_LABEL(name) &&do_##name,
+	static const void * const labels[] = { HOLEYC_OPS(HOLEYC_OP_LABEL) };
+#undef HOLEYC_OP_LABEL
+#define DISPATCH() do { \
+		count++; \
+		goto *labels[static_cast<size_t>(pc->op)]; \
+	} while (0)
+#define NEXT() do { pc++; DISPATCH(); } while (0)
+#define JUMP_IF(cond) do { \
+		if (cond){ pc = code + pc->a; DISPATCH(); } \
+		NEXT(); \
+	} while (0)
+#define CHECK(addr) do { \
+		if (static_cast<uint64_t>(addr) - 1 \
+		  >= static_cast<uint64_t>(memTop) - 1){ \
+			fault = addr == 0 ? "Null pointer dereference" \
+				: "Pointer out of bounds"; \
+			goto failed; \
+		} \
+	} while (0)
+
+	Console console(in);
+	std::unique_ptr<int64_t[]> regStack(new int64_t[REG_STACK]);
+	const int64_t memEnd = static_cast<int64_t>(bc.statics.size()
+		+ MEM_STACK);
+	std::unique_ptr<int64_t[]> memory(
+		new int64_t[static_cast<size_t>(memEnd)]);
+	std::copy(bc.statics.begin(), bc.statics.end(), memory.get());
+	std::vector<Frame> frames;
+
+	const Instr * const code = bc.code.data();
+	const Bytecode::Function * const fns = bc.fns.data();
+	int64_t * const mem = memory.get();
+	int64_t * const regEnd = regStack.get() + REG_STACK;
+	int64_t memTop = static_cast<int64_t>(bc.statics.size());
+	int64_t fp = memTop;
+	int64_t * r = regStack.get();
+	const char * fault = nullptr;
+	uint64_t count = 0;
+	int64_t value = 0;
+
+	const Instr * pc = code + bc.fns[bc.main].entry;
+	{
+		const Bytecode::Function& fn = fns[bc.main];
+		std::fill(r, r + fn.locals, 0);
+		std::fill(mem + fp, mem + fp + fn.cells, 0);
+		memTop += fn.cells;
+	}
+	DISPATCH();
+
+do_MOVE: r[pc->a] = r[pc->b]; NEXT();
+do_LOADK: r[pc->a] = pc->b; NEXT();
+do_LOADA: r[pc->a] = pc->b; NEXT();
+do_LOADG: r[pc->a] = mem[pc->b]; NEXT();
+do_STOREG: mem[pc->a] = r[pc->b]; NEXT();
+do_LOADF: r[pc->a] = mem[fp + pc->b]; NEXT();
+do_STOREF: mem[fp + pc->a] = r[pc->b]; NEXT();
+do_ADDRF: r[pc->a] = fp + pc->b; NEXT();
+do_LOADP: {
+	int64_t addr = r[pc->b];
+	CHECK(addr);
+	r[pc->a] = mem[addr];
+	NEXT();
+}
+do_STOREP: {
+	int64_t addr = r[pc->a];
+	CHECK(addr);
+	mem[addr] = r[pc->b];
+	NEXT();
+}
+do_LOADX: {
+	int64_t addr = r[pc->b] + r[pc->c];
+	CHECK(addr);
+	r[pc->a] = mem[addr];
+	NEXT();
+}
+do_STOREX: {
+	int64_t addr = r[pc->a] + r[pc->b];
+	CHECK(addr);
+	mem[addr] = r[pc->c];
+	NEXT();
+}
+do_ADD: r[pc->a] = wrap(r[pc->b] + r[pc->c]); NEXT();
+do_SUB: r[pc->a] = wrap(r[pc->b] - r[pc->c]); NEXT();
+do_MUL: r[pc->a] = wrap(r[pc->b] * r[pc->c]); NEXT();
+do_DIV:
+	if (r[pc->c] == 0){ fault = "Division by zero"; goto failed; }
+	r[pc->a] = wrap(r[pc->b] / r[pc->c]);
+	NEXT();
+do_ADDK: r[pc->a] = wrap(r[pc->b] + pc->c); NEXT();
+do_MULK: r[pc->a] = wrap(r[pc->b] * pc->c); NEXT();
+do_DIVK:
+	if (pc->c == 0){ fault = "Division by zero"; goto failed; }
+	r[pc->a] = wrap(r[pc->b] / pc->c);
+	NEXT();
+do_RSUBK: r[pc->a] = wrap(pc->c - r[pc->b]); NEXT();
+do_NEG: r[pc->a] = wrap(-r[pc->b]); NEXT();
+do_NOT: r[pc->a] = r[pc->b] == 0; NEXT();
+do_INC: r[pc->a] = wrap(r[pc->a] + 1); NEXT();
+do_DEC: r[pc->a] = wrap(r[pc->a] - 1); NEXT();
+do_EQ: r[pc->a] = r[pc->b] == r[pc->c]; NEXT();
+do_NE: r[pc->a] = r[pc->b] != r[pc->c]; NEXT();
+do_LT: r[pc->a] = r[pc->b] < r[pc->c]; NEXT();
+do_LE: r[pc->a] = r[pc->b] <= r[pc->c]; NEXT();
+do_EQK: r[pc->a] = r[pc->b] == pc->c; NEXT();
+do_NEK: r[pc->a] = r[pc->b] != pc->c; NEXT();
+do_LTK: r[pc->a] = r[pc->b] < pc->c; NEXT();
+do_LEK: r[pc->a] = r[pc->b] <= pc->c; NEXT();
+do_GTK: r[pc->a] = r[pc->b] > pc->c; NEXT();
+do_GEK: r[pc->a] = r[pc->b] >= pc->c; NEXT();
+do_JMP: pc = code + pc->a; DISPATCH();
+do_JT: JUMP_IF(r[pc->b] != 0);
+do_JF: JUMP_IF(r[pc->b] == 0);
+do_JEQ: JUMP_IF(r[pc->b] == r[pc->c]);
+do_JNE: JUMP_IF(r[pc->b] != r[pc->c]);
+do_JLT: JUMP_IF(r[pc->b] < r[pc->c]);
+do_JLE: JUMP_IF(r[pc->b] <= r[pc->c]);
+do_JEQK: JUMP_IF(r[pc->b] == pc->c);
+do_JNEK: JUMP_IF(r[pc->b] != pc->c);
+do_JLTK: JUMP_IF(r[pc->b] < pc->c);
+do_JLEK: JUMP_IF(r[pc->b] <= pc->c);
+do_JGTK: JUMP_IF(r[pc->b] > pc->c);
+do_JGEK: JUMP_IF(r[pc->b] >= pc->c);
+do_CALL: {
+	const Bytecode::Function& fn = fns[pc->a];
+	int64_t * regs = r + pc->b;
+	if (regs + fn.regs > regEnd || memTop + fn.cells > memEnd){
+		fault = "Stack overflow";
+		goto failed;
+	}
+	frames.push_back(Frame{pc + 1, r, fp});
+	std::fill(regs + fn.params, regs + fn.locals, 0);
+	fp = memTop;
+	std::fill(mem + fp, mem + fp + fn.cells, 0);
+	memTop += fn.cells;
+	r = regs;
+	pc = code + fn.entry;
+	DISPATCH();
+}
+do_RET: value = r[pc->a]; goto leave;
+do_RETV: value = 0; goto leave;
+leave: {
+	if (frames.empty()){ goto finished; }
+	//The callee's first register is where its caller wants the value
+	r[0] = value;
+	const Frame& frame = frames.back();
+	memTop = fp;
+	fp = frame.fp;
+	r = frame.regs;
+	pc = frame.ret;
+	frames.pop_back();
+	DISPATCH();
+}
+do_WRITEI: console.writeInt(r[pc->a]); NEXT();
+do_WRITEB: console.writeBool(r[pc->a]); NEXT();
+do_WRITEC: console.writeChar(r[pc->a]); NEXT();
+do_WRITES: {
+	for (int64_t addr = r[pc->a]; ; addr++){
+		CHECK(addr);
+		if (mem[addr] == 0){ break; }
+		console.writeChar(mem[addr]);
+	}
+	NEXT();
+}
+do_READI:
+	if (!console.readInt(r[pc->a])){
+		fault = "Expected an int as input";
+		goto failed;
+	}
+	NEXT();
+do_READB:
+	if (!console.readBool(r[pc->a])){
+		fault = "Expected a bool as input";
+		goto failed;
+	}
+	NEXT();
+do_READC:
+	if (!console.readChar(r[pc->a])){
+		fault = "Expected a char as input";
+		goto failed;
+	}
+	NEXT();
+
+failed: {
+	size_t at = static_cast<size_t>(pc - code);
+	console.flush();
+	Report::err() << "Runtime error [" << bc.lines[at] << ","
+		<< bc.cols[at] << "]: " << fault << std::endl;
+	executed += count;
+	return 1;
+}
+finished:
+	executed += count;
+	return static_cast<int>(value);
+
+#undef DISPATCH
+#undef NEXT
+#undef JUMP_IF
+#undef CHECK
+}
+
+#pragma GCC diagnostic pop
+
+} // End namespace holeyc
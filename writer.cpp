@@ -0,0 +1,105 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "writer.hpp"
+#include "errors.hpp"
+
+namespace holeyc{
+
+const char Writer::TABS[MAX_INDENT + 1] =
+	"\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t"
+	"\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+
+Writer::Writer(const char * path)
+: myBuffer(new char[BUFFER_SIZE]), myUsed(0), myFd(-1), myOwnsFd(true),
+  myStream(nullptr){
+	myFd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (myFd < 0){
+		delete[] myBuffer;
+		std::string msg = "Bad output file ";
+		msg += path;
+		throw new InternalError(msg.c_str());
+	}
+}
+
+Writer::Writer(int fd)
+: myBuffer(new char[BUFFER_SIZE]), myUsed(0), myFd(fd), myOwnsFd(false),
+  myStream(nullptr){
+}
+
+Writer::Writer(std::ostream& stream)
+: myBuffer(new char[BUFFER_SIZE]), myUsed(0), myFd(-1), myOwnsFd(false),
+  myStream(&stream){
+}
+
+Writer::~Writer(){
+	try {
+		flush();
+	} catch (InternalError * e){
+		//Nowhere left to report it
+		delete e;
+	}
+	if (myOwnsFd){ close(myFd); }
+	delete[] myBuffer;
+}
+
+Writer& Writer::operator<<(int val){
+	//Digits are produced backwards, from the end of digits
+	char digits[16];
+	char * pos = digits + sizeof(digits);
+	unsigned int mag = static_cast<unsigned int>(val);
+	if (val < 0){ mag = 0u - mag; }
+	do {
+		*--pos = static_cast<char>('0' + mag % 10);
+		mag /= 10;
+	} while (mag != 0);
+	if (val < 0){ *--pos = '-'; }
+	write(pos, static_cast<size_t>(digits + sizeof(digits) - pos));
+	return *this;
+}
+
+Writer& Writer::operator<<(size_t val){
+	char digits[24];
+	char * pos = digits + sizeof(digits);
+	do {
+		*--pos = static_cast<char>('0' + val % 10);
+		val /= 10;
+	} while (val != 0);
+	write(pos, static_cast<size_t>(digits + sizeof(digits) - pos));
+	return *this;
+}
+
+void Writer::flush(){
+	size_t len = myUsed;
+	myUsed = 0;
+	drain(myBuffer, len);
+}
+
+void Writer::spill(const char * data, size_t len){
+	flush();
+	if (len >= BUFFER_SIZE){
+		//No use copying it through the buffer
+		drain(data, len);
+	} else {
+		memcpy(myBuffer, data, len);
+		myUsed = len;
+	}
+}
+
+void Writer::drain(const char * data, size_t len){
+	if (myStream != nullptr){
+		myStream->write(data, static_cast<std::streamsize>(len));
+		return;
+	}
+	while (len > 0){
+		ssize_t done = ::write(myFd, data, len);
+		if (done < 0){
+			if (errno == EINTR){ continue; }
+			throw new InternalError("Write to output failed");
+		}
+		data += done;
+		len -= static_cast<size_t>(done);
+	}
+}
+
+} //End namespace holeyc
@@ -0,0 +1,92 @@
+#ifndef HOLEYC_WRITER_HPP
+#define HOLEYC_WRITER_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace holeyc{
+
+/**
+* An output sink for the compiler's bulk text output (e.g. the 
+* unparser). Text is appended to one large buffer, which is handed 
+* on with a single big write() whenever it fills up, rather than 
+* going through an ostream a few characters at a time.
+**/
+class Writer{
+public:
+	/** Write to the file at path, replacing its contents **/
+	explicit Writer(const char * path);
+	/** Write to an open file descriptor, which is left open **/
+	explicit Writer(int fd);
+	/** Write to an ostream, e.g. one collecting a batch's output **/
+	explicit Writer(std::ostream& stream);
+	Writer(const Writer&) = delete;
+	Writer& operator=(const Writer&) = delete;
+	~Writer();
+
+	void write(const char * data, size_t len){
+		if (len > BUFFER_SIZE - myUsed){
+			spill(data, len);
+			return;
+		}
+		memcpy(myBuffer + myUsed, data, len);
+		myUsed += len;
+	}
+
+	void put(char c){
+		if (myUsed == BUFFER_SIZE){ flush(); }
+		myBuffer[myUsed++] = c;
+	}
+
+	/** Write depth tabs **/
+	void indent(int depth){
+		while (depth > MAX_INDENT){
+			write(TABS, MAX_INDENT);
+			depth -= MAX_INDENT;
+		}
+		if (depth > 0){ write(TABS, static_cast<size_t>(depth)); }
+	}
+
+	/** Literals: the length is known at compile time **/
+	template <size_t N>
+	Writer& operator<<(const char (&str)[N]){
+		write(str, N - 1);
+		return *this;
+	}
+
+	Writer& operator<<(const std::string& str){
+		write(str.data(), str.size());
+		return *this;
+	}
+
+	Writer& operator<<(char c){
+		put(c);
+		return *this;
+	}
+
+	Writer& operator<<(int val);
+	Writer& operator<<(size_t val);
+
+	/** Hand everything buffered so far to the output **/
+	void flush();
+
+private:
+	static const size_t BUFFER_SIZE = 256 * 1024;
+	static const int MAX_INDENT = 64;
+	static const char TABS[MAX_INDENT + 1];
+
+	void spill(const char * data, size_t len);
+	void drain(const char * data, size_t len);
+
+	char * myBuffer;
+	size_t myUsed;
+	int myFd;
+	bool myOwnsFd;
+	std::ostream * myStream;
+};
+
+} //End namespace holeyc
+
+#endif